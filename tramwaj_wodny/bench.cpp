@@ -0,0 +1,378 @@
+// Runner scenariuszy z README (sekcja 8) z porownaniem do zapisanych baseline'ow.
+// Kazdy scenariusz uruchamia ./tramwaj, zbiera metryki (wait4 + log) i porownuje
+// je z baseline'em z tolerancja. Wynik: tabela na stdout + JSON do pliku.
+
+#include "runner.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum { MAX_METRICS = 24, MAX_BASELINES = 256 };
+
+typedef struct {
+    const char* name;
+    const char* args[RUNNER_MAX_ARGS];
+    int kill_after_ms;       // >0 scenariusz guardian
+    int in_all;              // czy wchodzi w "all"
+    const char* script;      // komendy dyspozytora (--control-script), NULL = brak
+    int want_trips;          // >0: oczekiwana liczba rejsow zamiast --R
+} scenario_t;
+
+static const scenario_t g_scenarios[] = {
+    { "stress",
+      { "--N", "500", "--M", "0", "--K", "100", "--T1", "5000", "--T2", "1500",
+        "--R", "3", "--P", "5000", "--bike-prob", "0",
+        "--seed", "1", NULL }, 0, 1 },
+    { "bikes",
+      { "--N", "20", "--M", "10", "--K", "1", "--T1", "1500", "--T2", "1000",
+        "--R", "2", "--P", "1000", "--bike-prob", "0.8",
+        "--seed", "1", NULL }, 0, 1 },
+    { "statemachine",
+      { "--N", "100", "--M", "15", "--K", "30", "--T1", "600", "--T2", "400",
+        "--R", "100", "--P", "5000", "--bike-prob", "0.25",
+        "--seed", "1", NULL }, 0, 1 },
+    { "guardian",
+      { "--N", "20", "--M", "5", "--K", "8", "--T1", "5000", "--T2", "3000",
+        "--R", "10", "--P", "50", "--bike-prob", "0.2",
+        "--seed", "1", NULL }, 100, 1 },
+    // szybki przebieg do sprawdzenia samego narzedzia (nie wchodzi w "all")
+    { "smoke",
+      { "--N", "10", "--M", "2", "--K", "4", "--T1", "300", "--T2", "200",
+        "--R", "2", "--P", "20", "--bike-prob", "0.3",
+        "--seed", "1", NULL }, 0, 0 },
+    // depart i stop w trakcie rejsu 1: STOP wyprzedza odlozony DEPART, drugiego rejsu nie ma
+    { "ctlstop",
+      { "--N", "10", "--M", "2", "--K", "4", "--T1", "300", "--T2", "1500",
+        "--R", "3", "--P", "20", "--bike-prob", "0.3",
+        "--seed", "1", NULL }, 0, 0, "600 depart 0\n600 stop 0\n", 1 },
+};
+static const int g_nscenarios = (int)(sizeof(g_scenarios) / sizeof(g_scenarios[0]));
+
+typedef struct {
+    const char* name;
+    double value;
+    int higher_is_better;
+    double min_abs;          // prog szumu w jednostce metryki (metric_min_abs)
+} metric_t;
+
+typedef struct {
+    const char* scenario;
+    metric_t m[MAX_METRICS];
+    int nm;
+    int checks_ok;           // poprawnosc scenariusza (wg kryteriow z README)
+    char check_msg[160];
+    int regressions;
+} scenario_result_t;
+
+typedef struct {
+    char scenario[32];
+    char metric[32];
+    double value;
+    double tol;              // <0: uzyj globalnej
+} baseline_t;
+
+static baseline_t g_base[MAX_BASELINES];
+static int g_nbase = 0;
+static double g_min_abs = 5.0;   // ms / liczniki: ponizej tej roznicy bezwzglednej nie zglaszamy regresji (szum)
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage:\n"
+        "  bench [--scenario <name|all>] [--bin-dir <dir>] [--baseline <file>] [--save-baseline <file>]\n"
+        "        [--tol <frac>] [--min-abs <v>] [--json <file>] [--verbose]\n"
+        "  bench --self-test   (porownanie z syntetycznym baseline'em, bez uruchamiania symulacji)\n"
+        "Scenarios: stress, bikes, statemachine, guardian (all), smoke, ctlstop\n"
+        "Baseline file: lines '<scenario> <metric> <value> [tol]', '#' = comment\n");
+}
+
+// Prog szumu zalezy od jednostki: --min-abs jest w ms / sztukach, wiec dla metryk ulamkowych
+// (rejsy/s ~ 0.1-2) bylby wiekszy od samej wartosci i wylaczal porownanie
+static double metric_min_abs(const char* name) {
+    const size_t n = strlen(name);
+    if (n >= 8 && strcmp(name + n - 8, "_per_sec") == 0) return 0.0;   // tylko tolerancja wzgledna
+    if (n >= 4 && strcmp(name + n - 4, "_pct") == 0) return 1.0;       // punkty procentowe
+    return g_min_abs;
+}
+
+static void add_metric(scenario_result_t* r, const char* name, double v, int hib) {
+    if (r->nm >= MAX_METRICS) return;
+    r->m[r->nm].name = name;
+    r->m[r->nm].value = v;
+    r->m[r->nm].higher_is_better = hib;
+    r->m[r->nm].min_abs = metric_min_abs(name);
+    r->nm++;
+}
+
+static int load_baseline(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) { perror("fopen(baseline)"); return -1; }
+    char line[256];
+    while (fgets(line, sizeof(line), f) && g_nbase < MAX_BASELINES) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        baseline_t b;
+        memset(&b, 0, sizeof(b));
+        b.tol = -1.0;
+        int n = sscanf(line, "%31s %31s %lf %lf", b.scenario, b.metric, &b.value, &b.tol);
+        if (n < 3) continue;
+        g_base[g_nbase++] = b;
+    }
+    fclose(f);
+    return 0;
+}
+
+static const baseline_t* find_baseline(const char* scenario, const char* metric) {
+    for (int i = 0; i < g_nbase; i++) {
+        if (strcmp(g_base[i].scenario, scenario) == 0 && strcmp(g_base[i].metric, metric) == 0) return &g_base[i];
+    }
+    return NULL;
+}
+
+static void run_scenario(const scenario_t* sc, const char* bin_dir, int verbose, scenario_result_t* r) {
+    memset(r, 0, sizeof(*r));
+    r->scenario = sc->name;
+
+    char log_path[128];
+    snprintf(log_path, sizeof(log_path), "bench_%s.log", sc->name);
+
+    run_spec_t spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.bin_dir = bin_dir;
+    spec.log_path = log_path;
+    int na = 0;
+    for (; sc->args[na] && na < RUNNER_MAX_ARGS - 1; na++) spec.argv[na] = sc->args[na];
+    char script_path[128];
+    if (sc->script && na + 2 < RUNNER_MAX_ARGS) {
+        snprintf(script_path, sizeof(script_path), "bench_%s.script", sc->name);
+        FILE* f = fopen(script_path, "w");
+        if (!f || fputs(sc->script, f) < 0) {
+            if (f) fclose(f);
+            snprintf(r->check_msg, sizeof(r->check_msg), "failed to write %s", script_path);
+            return;
+        }
+        fclose(f);
+        spec.argv[na++] = "--control-script";
+        spec.argv[na++] = script_path;
+    }
+    spec.kill_after_ms = sc->kill_after_ms;
+    spec.quiet = verbose ? 0 : 1;
+
+    run_result_t rr;
+    if (runner_run(&spec, &rr) != 0) {
+        snprintf(r->check_msg, sizeof(r->check_msg), "failed to run tramwaj");
+        return;
+    }
+
+    add_metric(r, "wall_ms", (double)rr.wall_ms, 0);
+    add_metric(r, "cpu_user_ms", (double)rr.cpu_user_ms, 0);
+    add_metric(r, "cpu_sys_ms", (double)rr.cpu_sys_ms, 0);
+    add_metric(r, "cpu_total_ms", (double)(rr.cpu_user_ms + rr.cpu_sys_ms), 0);
+    add_metric(r, "nvcsw", (double)rr.nvcsw, 0);
+    add_metric(r, "nivcsw", (double)rr.nivcsw, 0);
+    add_metric(r, "maxrss_kb", (double)rr.maxrss_kb, 0);
+
+    if (sc->kill_after_ms > 0) {
+        // guardian: czekaj az zniknie SHM/semafory i grupa procesow launchera
+        int64_t t0 = now_ms_monotonic();
+        int clean = 0;
+        while (now_ms_monotonic() - t0 < 5000) {
+            if (runner_ipc_clean(rr.launcher_pid)) { clean = 1; break; }
+            sleep_ms(10);
+        }
+        add_metric(r, "cleanup_ms", (double)(now_ms_monotonic() - t0), 0);
+        r->checks_ok = clean;
+        snprintf(r->check_msg, sizeof(r->check_msg), clean ? "ipc+group cleaned" : "leftover IPC or processes");
+        return;
+    }
+
+    int32_t want_p = 0, want_r = 0;
+    for (int i = 0; sc->args[i]; i++) {
+        if (strcmp(sc->args[i], "--P") == 0) parse_i32(sc->args[i + 1], &want_p);
+        if (strcmp(sc->args[i], "--R") == 0) parse_i32(sc->args[i + 1], &want_r);
+    }
+    if (sc->want_trips > 0) want_r = sc->want_trips;
+
+    add_metric(r, "cpu_captain_ms", (double)rr.cpu_captain_ms, 0);
+    add_metric(r, "cpu_dispatcher_ms", (double)rr.cpu_dispatcher_ms, 0);
+    add_metric(r, "cpu_passenger_ms", (double)rr.cpu_passenger_ms, 0);
+    add_metric(r, "lock_contend_pct", rr.lock_contended_pct, 0);
+    add_metric(r, "lock_wait_ms", rr.lock_wait_ms, 0);
+
+    double ttfb = (rr.first_board_ms >= 0) ? (double)(rr.first_board_ms - rr.first_log_ms) : -1.0;
+    add_metric(r, "first_board_ms", ttfb, 0);
+    add_metric(r, "trips_per_sec", rr.wall_ms > 0 ? (double)rr.trips * 1000.0 / (double)rr.wall_ms : 0.0, 1);
+
+    r->checks_ok = (rr.boarded == rr.left_ship) && (rr.passenger_exits == want_p) && (rr.trips == want_r);
+    if (strcmp(sc->name, "bikes") == 0 && rr.bike_trip_violations != 0) r->checks_ok = 0;
+    snprintf(r->check_msg, sizeof(r->check_msg),
+        "trips=%d/%d boarded=%d left=%d exits=%d/%d",
+        rr.trips, want_r, rr.boarded, rr.left_ship, rr.passenger_exits, want_p);
+}
+
+static int is_regression(const metric_t* m, const baseline_t* b, double global_tol) {
+    double tol = (b->tol >= 0.0) ? b->tol : global_tol;
+    double diff = m->value - b->value;
+    if (m->higher_is_better) diff = -diff;
+    if (diff <= m->min_abs) return 0;
+    return diff > b->value * tol;
+}
+
+static void compare(scenario_result_t* r, double global_tol) {
+    for (int i = 0; i < r->nm; i++) {
+        const baseline_t* b = find_baseline(r->scenario, r->m[i].name);
+        if (!b || b->value <= 0.0) continue;
+        if (is_regression(&r->m[i], b, global_tol)) r->regressions++;
+    }
+}
+
+static void print_table(const scenario_result_t* res, int n, double global_tol) {
+    printf("%-13s %-17s %14s %14s %9s  %s\n", "scenario", "metric", "value", "baseline", "delta", "status");
+    for (int s = 0; s < n; s++) {
+        const scenario_result_t* r = &res[s];
+        for (int i = 0; i < r->nm; i++) {
+            const baseline_t* b = find_baseline(r->scenario, r->m[i].name);
+            if (!b || b->value <= 0.0) {
+                printf("%-13s %-17s %14.2f %14s %9s  %s\n", r->scenario, r->m[i].name, r->m[i].value, "-", "-", "-");
+                continue;
+            }
+            double delta = (r->m[i].value - b->value) / b->value;
+            int bad = is_regression(&r->m[i], b, global_tol);
+            printf("%-13s %-17s %14.2f %14.2f %+8.1f%%  %s\n", r->scenario, r->m[i].name,
+                r->m[i].value, b->value, delta * 100.0, bad ? "REGRESSION" : "ok");
+        }
+        printf("%-13s %-17s %s (%s)\n", r->scenario, "checks", r->checks_ok ? "PASS" : "FAIL", r->check_msg);
+    }
+}
+
+static int write_json(const char* path, const scenario_result_t* res, int n, double global_tol) {
+    FILE* f = fopen(path, "w");
+    if (!f) { perror("fopen(json)"); return -1; }
+    fprintf(f, "{\n  \"tolerance\": %.4f,\n  \"scenarios\": [\n", global_tol);
+    for (int s = 0; s < n; s++) {
+        const scenario_result_t* r = &res[s];
+        fprintf(f, "    {\"name\": \"%s\", \"checks_ok\": %s, \"checks\": \"%s\", \"regressions\": %d, \"metrics\": {",
+            r->scenario, r->checks_ok ? "true" : "false", r->check_msg, r->regressions);
+        for (int i = 0; i < r->nm; i++) {
+            const baseline_t* b = find_baseline(r->scenario, r->m[i].name);
+            fprintf(f, "%s\"%s\": {\"value\": %.3f", i ? ", " : "", r->m[i].name, r->m[i].value);
+            if (b) fprintf(f, ", \"baseline\": %.3f", b->value);
+            fprintf(f, "}");
+        }
+        fprintf(f, "}}%s\n", (s + 1 < n) ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return 0;
+}
+
+static int save_baseline(const char* path, const scenario_result_t* res, int n) {
+    FILE* f = fopen(path, "w");
+    if (!f) { perror("fopen(save-baseline)"); return -1; }
+    fprintf(f, "# scenario metric value [tol]\n");
+    for (int s = 0; s < n; s++) {
+        for (int i = 0; i < res[s].nm; i++) {
+            fprintf(f, "%s %s %.3f\n", res[s].scenario, res[s].m[i].name, res[s].m[i].value);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+// Sprawdzenie samego porownania: syntetyczny baseline i wyniki, bez uruchamiania ./tramwaj
+typedef struct {
+    const char* metric;
+    double base, value;
+    int hib;
+    int want_regression;
+} selftest_case_t;
+
+static int self_test(double tol) {
+    static const selftest_case_t cases[] = {
+        { "trips_per_sec", 2.00, 1.00, 1, 1 },     // spadek o polowe (roznica ponizej --min-abs)
+        { "trips_per_sec", 0.12, 0.06, 1, 1 },     // stress: wartosci rzedu 0.1
+        { "trips_per_sec", 2.00, 1.80, 1, 0 },     // -10% w tolerancji
+        { "trips_per_sec", 2.00, 3.00, 1, 0 },     // poprawa
+        { "wall_ms", 1000.0, 2000.0, 0, 1 },
+        { "wall_ms", 10.0, 14.0, 0, 0 },           // +40%, ale 4 ms to szum (--min-abs)
+        { "lock_contend_pct", 0.5, 1.2, 0, 0 },    // ponizej 1 punktu procentowego
+        { "lock_contend_pct", 2.0, 10.0, 0, 1 },
+    };
+    const int n = (int)(sizeof(cases) / sizeof(cases[0]));
+    int failed = 0;
+    for (int i = 0; i < n; i++) {
+        const selftest_case_t* c = &cases[i];
+        scenario_result_t r;
+        memset(&r, 0, sizeof(r));
+        r.scenario = "selftest";
+        add_metric(&r, c->metric, c->value, c->hib);
+        baseline_t b;
+        memset(&b, 0, sizeof(b));
+        b.value = c->base;
+        b.tol = -1.0;
+        const int got = is_regression(&r.m[0], &b, tol);
+        if (got != c->want_regression) failed++;
+        printf("selftest %-17s %10.2f -> %10.2f  want=%-10s got=%-10s %s\n", c->metric, c->base, c->value,
+            c->want_regression ? "REGRESSION" : "ok", got ? "REGRESSION" : "ok", got == c->want_regression ? "PASS" : "FAIL");
+    }
+    printf("selftest %s (%d/%d)\n", failed ? "FAIL" : "PASS", n - failed, n);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    const char* which = "all";
+    const char* bin_dir = NULL;
+    const char* baseline_path = NULL;
+    const char* save_path = NULL;
+    const char* json_path = "bench.json";
+    double tol = 0.25;
+    int verbose = 0;
+    int selftest = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* k = argv[i];
+        int has_val = (i + 1) < argc;
+        if (strcmp(k, "--scenario") == 0 && has_val) which = argv[++i];
+        else if (strcmp(k, "--bin-dir") == 0 && has_val) bin_dir = argv[++i];
+        else if (strcmp(k, "--baseline") == 0 && has_val) baseline_path = argv[++i];
+        else if (strcmp(k, "--save-baseline") == 0 && has_val) save_path = argv[++i];
+        else if (strcmp(k, "--json") == 0 && has_val) json_path = argv[++i];
+        else if (strcmp(k, "--tol") == 0 && has_val) {
+            if (parse_double(argv[++i], &tol) != 0 || tol < 0.0) { usage(); return 2; }
+        }
+        else if (strcmp(k, "--min-abs") == 0 && has_val) {
+            if (parse_double(argv[++i], &g_min_abs) != 0 || g_min_abs < 0.0) { usage(); return 2; }
+        }
+        else if (strcmp(k, "--verbose") == 0) verbose = 1;
+        else if (strcmp(k, "--self-test") == 0) selftest = 1;
+        else if (strcmp(k, "--help") == 0) { usage(); return 0; }
+        else { fprintf(stderr, "Unknown arg: %s\n", k); usage(); return 2; }
+    }
+
+    if (selftest) return self_test(tol);
+    if (baseline_path && load_baseline(baseline_path) != 0) return 2;
+
+    scenario_result_t results[sizeof(g_scenarios) / sizeof(g_scenarios[0])];
+    int nres = 0;
+    for (int i = 0; i < g_nscenarios; i++) {
+        const scenario_t* sc = &g_scenarios[i];
+        int selected = (strcmp(which, "all") == 0) ? sc->in_all : (strcmp(which, sc->name) == 0);
+        if (!selected) continue;
+        fprintf(stderr, "bench: running %s...\n", sc->name);
+        run_scenario(sc, bin_dir, verbose, &results[nres]);
+        compare(&results[nres], tol);
+        nres++;
+    }
+    if (nres == 0) { fprintf(stderr, "Unknown scenario: %s\n", which); usage(); return 2; }
+
+    print_table(results, nres, tol);
+    if (json_path) (void)write_json(json_path, results, nres, tol);
+    if (save_path) (void)save_baseline(save_path, results, nres);
+
+    int bad = 0;
+    for (int i = 0; i < nres; i++) {
+        if (!results[i].checks_ok || results[i].regressions > 0) bad = 1;
+    }
+    return bad ? 1 : 0;
+}
@@ -1,15 +1,19 @@
 #include "common.h"
+#include "control.h"
+#include "events.h"
 #include "ipc.h"
 #include "cli.h"
 #include "logging.h"
+#include "results.h"
+#include "timerwheel.h"
 #include "util.h"
 
 #include <errno.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <sys/msg.h>
 #include <unistd.h>
 
 static volatile sig_atomic_t g_early_depart = 0;
@@ -37,88 +41,587 @@ static void install_handlers(void) {
     if (sigaction(SIGHUP, &sa, NULL) != 0) die_perror("sigaction(SIGHUP)");
 }
 
-static int sem_wait_nointr(sem_t* s) {
-    while (sem_wait(s) != 0) {
-        if (errno == EINTR) return -1;
-        die_perror("sem_wait");
-    }
-    return 0;
-}
-static void sem_post_chk(sem_t* s) { if (sem_post(s) != 0) die_perror("sem_post"); }
-
 static const char* dir_str(int d) {
     return (d == DIR_KRAKOW_TO_TYNIEC) ? "KRAKOW->TYNIEC" : "TYNIEC->KRAKOW";
 }
 
-// Kapitan wymusza zejscie od konca kolejki (LIFO) poprzez:
-// - ustawienie phase=DEPARTING i boarding_open=0
-// - ustawienie bridge.dir = OUT
-// - petla: wybierz back, oznacz evicting, wyslij CMD_EVICT(pid), czekaj na ACK
-// Dodatkowo: zliczamy ile osob zeszlo z mostka (ile evictow).
-static int captain_clear_bridge(ipc_handles_t* ipc, logger_t* lg, int* out_left_bridge_people) {
+// Termin na ACK minal: jesli pasazer wciaz jest na koncu trapu, zdejmij go sila
+// i oddaj jego zasoby wg ksiegi w slocie (zywy pasazer zobaczy SLOT_LEFT i wyjdzie sam).
+// 1 = wymuszono, 0 = zdazyl zejsc sam
+static int captain_force_evict(ipc_handles_t* ipc, logger_t* lg, int32_t ship, int32_t gw, pid_t target,
+    int32_t target_slot, int waited_ms) {
+    // kill(pid,0): ESRCH -> proces juz nie istnieje (zombie jeszcze "zyje")
+    int alive = (kill(target, 0) == 0 || errno != ESRCH);
+
+    if (state_lock(ipc) != 0) return 0;
+    passenger_slot_t* sl = slot_get(ipc->shm, target_slot);
+    if (!sl || sl->pid != target || sl->ring_idx < 0 || !bridge_is_back(ipc->shm, ship, gw, target_slot)) {
+        state_unlock(ipc);
+        return 0;
+    }
+    int units = sl->held_units, seat = sl->held_seat, bike = sl->held_bike;
+    (void)slot_reclaim_locked(ipc->shm, target_slot);
+    if (!alive) ipc->shm->reclaimed_slots++;
+    bridge_state_t* b = &ipc->shm->ships[ship].bridge[gw];
+    if (b->count == 0) b->dir = BRIDGE_DIR_NONE;
+    state_unlock(ipc);
+    slot_wake(ipc->shm, target_slot);
+
+    // niedoreczony CMD_EVICT nie moze zostac w skrzynce
+    mbox_drop_cmd(ipc, target_slot, target);
+    ev_publish(ipc->shm, ship, EV_EVICT_FORCED, target_slot, alive, 0);
+
+    logf(lg, "captain", "EVICT TIMEOUT pid=%d slot=%d gangway=%d waited_ms=%d alive=%d units=%d seat=%d bike=%d -> forced off bridge",
+        (int)target, (int)target_slot, (int)gw, waited_ms, alive, units, seat, bike);
+    return 1;
+}
+
+// Ewakuacja w toku na jednym trapie (pid = 0: brak)
+typedef struct {
+    pid_t pid;
+    int32_t slot;
+    int64_t t_sent_ms;
+} evict_pending_t;
+
+// Kapitan wymusza zejscie od konca kolejki (LIFO) na wszystkich trapach naraz:
+// - phase=DEPARTING, boarding_open=0 i dir = OUT na trapach ustawia wolajacy
+// - runda: na kazdym trapie bez ewakuacji w toku wybierz back, oznacz evicting, wyslij CMD_EVICT(pid)
+// - ACK (skrzynka statku) dopasowany po PID zwalnia trap na kolejna runde
+// - brak ACK w evict_timeout_ms: sprawdz zywotnosc i zdejmij wezel sila (captain_force_evict)
+// Trapy czyszcza sie rownolegle: czas odplywu to najdluzsza kolejka, a nie suma kolejek.
+// Dodatkowo: zliczamy ile osob zeszlo z trapow (ile evictow).
+static int captain_clear_bridge(ipc_handles_t* ipc, logger_t* lg, int32_t ship, int* out_left_bridge_people) {
     int left_cnt = 0;
+    ship_state_t* sh = &ipc->shm->ships[ship];
+    const int32_t G = ipc->shm->G;
+    const int timeout_ms = ipc->shm->evict_timeout_ms;
+    evict_pending_t pend[MAX_G];
+    memset(pend, 0, sizeof(pend));
 
     for (;;) {
-        if (sem_wait_nointr(ipc->sem_state) != 0) return -1;
+        if (g_exit) return -1;
+
+        // runda: nowe cele na trapach bez ewakuacji w toku
+        int fresh[MAX_G];
+        int busy = 0;
+        if (state_lock(ipc) != 0) return -1;
+        const int trip = sh->trip_no;
+        for (int32_t g = 0; g < G; g++) {
+            fresh[g] = 0;
+            if (pend[g].pid > 0) { busy = 1; continue; }
+            if (sh->bridge[g].count == 0) {
+                sh->bridge[g].dir = BRIDGE_DIR_NONE;
+                continue;
+            }
+            bridge_node_t* last = bridge_back(ipc->shm, ship, g);
+            last->evicting = 1;
+            passenger_slot_t* sl = slot_get(ipc->shm, last->slot);
+            if (sl) sl->state = SLOT_EVICTING;
+            pend[g].pid = last->pid;
+            pend[g].slot = last->slot;
+            fresh[g] = 1;
+            busy = 1;
+        }
+        state_unlock(ipc);
 
-        if (ipc->shm->bridge.count == 0) {
-            ipc->shm->bridge.dir = BRIDGE_DIR_NONE;
-            sem_post_chk(ipc->sem_state);
+        if (!busy) {
             logf(lg, "captain", "bridge empty -> ok to depart");
             if (out_left_bridge_people) *out_left_bridge_people = left_cnt;
             return 0;
         }
 
-        bridge_node_t* last = bridge_back(ipc->shm);
-        if (!last) {
-            sem_post_chk(ipc->sem_state);
-            continue;
+        // wyslij polecenia ewakuacji do konkretnych pasazerow (slot + PID)
+        for (int32_t g = 0; g < G; g++) {
+            if (!fresh[g]) continue;
+            msg_cmd_t cmd;
+            cmd.mtype = (long)pend[g].pid;
+            cmd.cmd = CMD_EVICT;
+            cmd.trip_no = trip;
+            if (mbox_send_cmd(ipc, pend[g].slot, &cmd) == 0) {
+                ev_publish(ipc->shm, ship, EV_EVICT_REQ, pend[g].slot, g, 0);
+                logf(lg, "captain", "evict request sent to pid=%d gangway=%d", (int)pend[g].pid, (int)g);
+            }
+            pend[g].t_sent_ms = now_ms_monotonic();
+            slot_wake(ipc->shm, pend[g].slot);
         }
 
-        pid_t target = last->pid;
-        last->evicting = 1;
-        int trip = ipc->shm->trip_no;
+        // ACK od dowolnego trapu statku; spozniony ACK po wymuszeniu nie pasuje do zadnego - ignorujemy
+        int progress = 0;
+        msg_ack_t ack;
+        while (mbox_recv_ack(ipc, ship, &ack)) {
+            for (int32_t g = 0; g < G; g++) {
+                if (pend[g].pid != ack.pid) continue;
+                left_cnt++;
+                ev_publish(ipc->shm, ship, EV_EVICT_ACK, pend[g].slot, g, 0);
+                logf(lg, "captain", "ack from pid=%d gangway=%d (left_bridge=%d)", (int)ack.pid, (int)g, left_cnt);
+                pend[g].pid = 0;
+                progress = 1;
+                break;
+            }
+        }
 
-        sem_post_chk(ipc->sem_state);
+        // terminy na ACK (kazdy trap osobno)
+        const int64_t now = now_ms_monotonic();
+        for (int32_t g = 0; g < G; g++) {
+            if (pend[g].pid <= 0 || now - pend[g].t_sent_ms < timeout_ms) continue;
+            if (captain_force_evict(ipc, lg, ship, g, pend[g].pid, pend[g].slot, (int)(now - pend[g].t_sent_ms))) left_cnt++;
+            pend[g].pid = 0;
+            progress = 1;
+        }
+        if (!progress) sleep_ms(1);
+    }
+}
+
+// ======= Polityki odplywu =======
+// Kazda polityka to funkcja wolana co tick petli LOADING; zwraca powod odplywu albo NULL (czekaj).
+typedef struct {
+    int32_t policy;         // depart_policy_t
+    int32_t N;
+    int32_t T1_ms;
+    int32_t idle_ms;        // DEPART_IDLE
+    int64_t start_ms;       // poczatek LOADING
+    int64_t last_tick_ms;
+    int64_t last_board_ms;  // ostatnia zmiana onboard_passengers
+    int32_t last_onboard;
+    int32_t onboard;        // biezacy odczyt z SHM
+    double rate;            // EWMA tempa wejsc (pasazerowie / ms)
+    int32_t tau_ms;         // stala czasowa EWMA
+    int64_t cycle_ms;       // szacowany czas DEPARTING+SAILING+UNLOADING (z poprzedniego rejsu)
+} depart_ctx_t;
+
+typedef const char* (*depart_fn)(depart_ctx_t* dc, int64_t elapsed);
+
+static const char* depart_fixed(depart_ctx_t* dc, int64_t elapsed) {
+    return (elapsed >= dc->T1_ms) ? "T1 elapsed" : NULL;
+}
+
+static const char* depart_full(depart_ctx_t* dc, int64_t elapsed) {
+    if (dc->onboard >= dc->N) return "ship full";
+    return depart_fixed(dc, elapsed);
+}
+
+static const char* depart_idle(depart_ctx_t* dc, int64_t elapsed) {
+    if (dc->onboard >= dc->N) return "ship full";
+    if (dc->onboard > 0 && dc->last_tick_ms - dc->last_board_ms >= dc->idle_ms) return "idle";
+    return depart_fixed(dc, elapsed);
+}
+
+// Przepustowosc rejsu = onboard / (elapsed + cycle_ms). Czekanie oplaca sie, dopoki
+// biezace tempo wejsc jest wyzsze niz ta srednia; przy fali pasazerow trzymamy statek do 2*T1.
+static const char* depart_adaptive(depart_ctx_t* dc, int64_t elapsed) {
+    if (dc->onboard >= dc->N) return "ship full";
+    if (elapsed >= 2 * (int64_t)dc->T1_ms) return "2*T1 elapsed";
+    if (dc->onboard == 0 || elapsed < dc->tau_ms) return NULL;
+    double avg = (double)dc->onboard / (double)(elapsed + dc->cycle_ms);
+    if (dc->rate < avg) return "arrival rate below trip throughput";
+    return NULL;
+}
+
+static const depart_fn k_depart_policies[] = { depart_fixed, depart_full, depart_idle, depart_adaptive };
+
+static void depart_begin(depart_ctx_t* dc, const shm_state_t* s, int32_t ship, int64_t now, int64_t cycle_ms) {
+    memset(dc, 0, sizeof(*dc));
+    dc->policy = (s->depart_policy >= DEPART_FIXED && s->depart_policy <= DEPART_ADAPTIVE) ? s->depart_policy : DEPART_FIXED;
+    dc->N = s->ships[ship].N;
+    dc->T1_ms = s->T1_ms;
+    dc->idle_ms = s->depart_idle_ms;
+    dc->start_ms = dc->last_tick_ms = dc->last_board_ms = now;
+    dc->tau_ms = (s->T1_ms / 10 > 50) ? s->T1_ms / 10 : 50;
+    dc->cycle_ms = cycle_ms;
+}
+
+static const char* depart_check(depart_ctx_t* dc, int onboard, int64_t now) {
+    int64_t dt = now - dc->last_tick_ms;
+    if (dt > 0) {
+        double inst = (double)(onboard - dc->last_onboard) / (double)dt;
+        double alpha = (double)dt / (double)dc->tau_ms;
+        if (alpha > 1.0) alpha = 1.0;
+        dc->rate += alpha * (inst - dc->rate);
+    }
+    if (onboard != dc->last_onboard) dc->last_board_ms = now;
+    dc->last_onboard = onboard;
+    dc->onboard = onboard;
+    dc->last_tick_ms = now;
+    return k_depart_policies[dc->policy](dc, now - dc->start_ms);
+}
 
-        // wyslij polecenie ewakuacji do konkretnego PID (mtype=PID)
-        msg_cmd_t cmd;
-        cmd.mtype = (long)target;
-        cmd.cmd = CMD_EVICT;
-        cmd.trip_no = trip;
-        if (msgsnd(ipc->msqid, &cmd, sizeof(cmd) - sizeof(long), 0) != 0) {
-            perror("msgsnd(CMD_EVICT)");
+// Wpuszczanie grupowe (--board-batch B): do B wezlow z frontow trapow w jednej sekcji krytycznej
+// (po kolei z kazdego trapu w kierunku IN), liczniki onboard_* aktualizowane raz, jednostki trapow
+// oddawane za pasazerow (wg ksiegi), wpuszczeni budzeni po wyjsciu z sekcji krytycznej.
+// Zwraca liczbe wpuszczonych.
+static int captain_admit_batch(ipc_handles_t* ipc, int32_t ship, bridge_node_t* buf, int B) {
+    if (state_lock(ipc) != 0) return -1;
+    shm_state_t* s = ipc->shm;
+    ship_state_t* sh = &s->ships[ship];
+    if (sh->phase != PHASE_LOADING || sh->boarding_open == 0) {
+        state_unlock(ipc);
+        return 0;
+    }
+    int n = 0, bikes = 0;
+    int units[MAX_G];
+    for (int32_t g = 0; g < s->G; g++) {
+        units[g] = 0;
+        if (sh->bridge[g].dir != BRIDGE_DIR_IN) continue;
+        const int got = bridge_pop_front_batch(s, ship, g, buf + n, B - n);
+        for (int i = n; i < n + got; i++) {
+            passenger_slot_t* sl = slot_get(s, buf[i].slot);
+            if (!sl) continue;
+            sl->state = SLOT_ONBOARD;
+            sl->onboard = 1;
+            units[g] += sl->held_units;
+            sl->held_units = 0;
+            bikes += sl->bike;
         }
-        else {
-            logf(lg, "captain", "evict request sent to pid=%d", (int)target);
+        n += got;
+        if (sh->bridge[g].count == 0) sh->bridge[g].dir = BRIDGE_DIR_NONE;
+    }
+    sh->onboard_passengers += n;
+    sh->onboard_bikes += bikes;
+    const int onboard = sh->onboard_passengers, onboard_bikes = sh->onboard_bikes;
+    state_unlock(ipc);
+
+    for (int32_t g = 0; g < s->G; g++) {
+        for (int u = 0; u < units[g]; u++) {
+            sync_count_post(&sh->sync.bridge[g]);
         }
+    }
+    for (int i = 0; i < n; i++) {
+        slot_wake(s, buf[i].slot);
+        ev_publish(s, ship, EV_BOARD, buf[i].slot, onboard, onboard_bikes);
+    }
+    return n;
+}
 
-        // czekaj na ACK (mtype=1)
-        msg_ack_t ack;
-        for (;;) {
-            ssize_t n = msgrcv(ipc->msqid, &ack, sizeof(ack) - sizeof(long), 1, 0);
-            if (n < 0) {
-                if (errno == EINTR && !g_exit) continue;
-                if (errno == EINTR) return -1;
-                perror("msgrcv(ACK)");
-                break;
-            }
-            if (ack.pid == target) {
-                left_cnt++;
-                logf(lg, "captain", "ack from pid=%d (left_bridge=%d)", (int)target, left_cnt);
-                break;
+// Planer przydzialu (--admission planner): kapitan widzi cala pule oczekujacych (sloty WAITING)
+// i wydaje bilety (SLOT_ADMITTED) tak, zeby nikt nie rezerwowal miejsc, ktorych nie dostanie.
+// Kolejnosc: zaglodzeni rowerzysci (skipped >= ADMIT_FAIR_TRIPS), piesi FIFO, reszta rowerzystow FIFO.
+// Pieszy zajmuje 1 jednostke mostka na miejsce, rowerzysta 2 - piesi pierwsi daja wiecej miejsc na jednostke.
+typedef struct {
+    int32_t arrival;
+    int32_t id;
+} plan_cand_t;
+
+typedef struct {
+    plan_cand_t* cand;   // kandydaci ticka (bufor na P slotow)
+    int32_t* granted;    // bilety wydane w biezacym rejsie
+    int n_granted;
+} planner_t;
+
+static int cmp_plan_cand(const void* a, const void* b) {
+    const plan_cand_t* x = (const plan_cand_t*)a;
+    const plan_cand_t* y = (const plan_cand_t*)b;
+    return (x->arrival > y->arrival) - (x->arrival < y->arrival);
+}
+
+static int slot_pending(const passenger_slot_t* sl) {
+    return sl->state == SLOT_ADMITTED || sl->state == SLOT_ON_BRIDGE || sl->state == SLOT_EVICTING;
+}
+
+// Jeden tick planera: zwraca liczbe wydanych biletow
+static int planner_tick(ipc_handles_t* ipc, int32_t ship, planner_t* pl) {
+    if (state_lock(ipc) != 0) return -1;
+    shm_state_t* s = ipc->shm;
+    ship_state_t* sh = &s->ships[ship];
+    if (sh->phase != PHASE_LOADING || sh->boarding_open == 0) {
+        state_unlock(ipc);
+        return 0;
+    }
+
+    // wolne zasoby = pojemnosc - na statku - bilety jeszcze w drodze (ADMITTED / na mostku)
+    int seats = sh->N - sh->onboard_passengers;
+    int bikes = sh->M - sh->onboard_bikes;
+    int units = s->K * s->G;
+    for (int i = 0; i < pl->n_granted; i++) {
+        const passenger_slot_t* sl = slot_get(s, pl->granted[i]);
+        if (!slot_pending(sl)) continue;
+        seats--;
+        bikes -= sl->bike;
+        units -= sl->bike ? 2 : 1;
+    }
+    if (seats <= 0 || units <= 0) {
+        state_unlock(ipc);
+        return 0;
+    }
+
+    int nc = 0;
+    for (uint32_t i = 0; i < s->layout.slots_cap; i++) {
+        const passenger_slot_t* sl = slot_get(s, (int32_t)i);
+        if (sl->state != SLOT_WAITING || sl->pid <= 0) continue;
+        if (sl->dir != SLOT_DIR_ANY && sl->dir != (uint8_t)sh->direction) continue;
+        if (sl->bike && s->K < 2) continue;   // rower nigdy nie zmiesci sie na mostku
+        pl->cand[nc].arrival = sl->arrival;
+        pl->cand[nc].id = (int32_t)i;
+        nc++;
+    }
+    qsort(pl->cand, (size_t)nc, sizeof(plan_cand_t), cmp_plan_cand);
+
+    const int first = pl->n_granted;
+    for (int pass = 0; pass < 3 && seats > 0 && units > 0; pass++) {
+        for (int c = 0; c < nc && seats > 0 && units > 0; c++) {
+            passenger_slot_t* sl = slot_get(s, pl->cand[c].id);
+            if (sl->state != SLOT_WAITING) continue;
+            const int starving = sl->bike && sl->skipped >= ADMIT_FAIR_TRIPS;
+            if (pass == 0 && !starving) continue;
+            if (pass == 1 && sl->bike) continue;
+            if (pass == 2 && !sl->bike) continue;
+            const int need = sl->bike ? 2 : 1;
+            if (need > units || (sl->bike && bikes <= 0)) continue;
+            sl->state = SLOT_ADMITTED;
+            sl->ship = (uint8_t)ship;   // bilet na ten statek: pasazer rezerwuje jego semafory
+            sl->skipped = 0;
+            pl->granted[pl->n_granted++] = pl->cand[c].id;
+            seats--;
+            bikes -= sl->bike;
+            units -= need;
+        }
+    }
+    state_unlock(ipc);
+
+    for (int i = first; i < pl->n_granted; i++) {
+        slot_wake(s, pl->granted[i]);
+        ev_publish(s, ship, EV_ADMIT, pl->granted[i], slot_get(s, pl->granted[i])->bike, 0);
+    }
+    return pl->n_granted - first;
+}
+
+// Koniec LOADING: niewykorzystane bilety wracaja do puli, pominieci rowerzysci zbieraja "skipped"
+static void planner_close(ipc_handles_t* ipc, int32_t ship, planner_t* pl) {
+    if (state_lock(ipc) != 0) return;
+    shm_state_t* s = ipc->shm;
+    const ship_state_t* sh = &s->ships[ship];
+    for (int i = 0; i < pl->n_granted; i++) {
+        passenger_slot_t* sl = slot_get(s, pl->granted[i]);
+        if (sl->state == SLOT_ADMITTED) sl->state = SLOT_WAITING;
+    }
+    for (uint32_t i = 0; i < s->layout.slots_cap; i++) {
+        passenger_slot_t* sl = slot_get(s, (int32_t)i);
+        if (sl->state != SLOT_WAITING || !sl->bike || sl->pid <= 0) continue;
+        if (sl->dir != SLOT_DIR_ANY && sl->dir != (uint8_t)sh->direction) continue;
+        sl->skipped++;
+    }
+    state_unlock(ipc);
+    pl->n_granted = 0;
+}
+
+// ======= Cierpliwosc pasazerow (--patience / --patience-trips) =======
+// Terminy wszystkich czekajacych na ladzie leza w kolach czasowych (timerwheel.h): uzbrajane
+// i rozbrajane z szyny zdarzen, wygaszane O(1) zamortyzowane przy kazdym obrocie petli kapitana,
+// zamiast budzenia kazdego pasazera co chwile. Kolo ms liczy od EV_PASSENGER_START; kola odplywow
+// maja tick = jeden odplyw (osobno kierunek 0, 1 i pasazerowie bez kierunku - im przepada kazdy).
+// Pule na przystaniach sa wspolne dla floty, wiec cierpliwosc prowadzi tylko kapitan statku 0,
+// a odplywy wszystkich statkow zna z szyny (EV_TRIP_START niesie kierunek, EV_DEPART go zamyka).
+enum { PAT_WHEEL_ANY = 2, PAT_RECHECK_MS = 50 };
+
+typedef struct {
+    int enabled;
+    int32_t limit_ms, limit_trips;
+    int32_t slots;
+    ipc_handles_t* ipc;
+    logger_t* lg;
+    ev_cursor_t cur;
+    uint64_t lost_seen;
+    tw_wheel_t ms;
+    tw_wheel_t trips[3];
+    tw_timer_t* t_ms;        // timer slotu w kole ms
+    tw_timer_t* t_trips;     // timer slotu w kole odplywow (tag = indeks kola)
+    int64_t* t_wait;         // poczatek czekania slotu (ms)
+    int32_t gave_up[2];      // wg powodu: 0 czas, 1 odplywy
+    int32_t ship_dir[MAX_F]; // kierunek biezacego rejsu statku (z EV_TRIP_START)
+} patience_t;
+
+static void patience_arm(patience_t* pt, int32_t slot, int dir, int64_t t_ms) {
+    if (slot < 0 || slot >= pt->slots) return;
+    pt->t_wait[slot] = t_ms;
+    if (pt->limit_ms > 0) tw_add(&pt->ms, &pt->t_ms[slot], (uint64_t)(t_ms + pt->limit_ms));
+    if (pt->limit_trips > 0) {
+        const int wi = (dir == 0 || dir == 1) ? dir : PAT_WHEEL_ANY;
+        pt->t_trips[slot].tag = wi;
+        tw_add(&pt->trips[wi], &pt->t_trips[slot], pt->trips[wi].now + (uint64_t)pt->limit_trips);
+    }
+}
+
+static void patience_disarm(patience_t* pt, int32_t slot) {
+    if (slot < 0 || slot >= pt->slots) return;
+    tw_cancel(&pt->ms, &pt->t_ms[slot]);
+    tw_cancel(&pt->trips[pt->t_trips[slot].tag], &pt->t_trips[slot]);
+}
+
+// Czekajacy bez uzbrojonych timerow (start przed subskrypcja albo zgubione zdarzenia): licz od teraz
+static void patience_rescan(patience_t* pt) {
+    const int64_t now = now_ms_monotonic();
+    if (state_lock(pt->ipc) != 0) return;
+    for (int32_t i = 0; i < pt->slots; i++) {
+        const passenger_slot_t* sl = slot_get(pt->ipc->shm, i);
+        if (sl->state != SLOT_WAITING || sl->pid <= 0) continue;
+        if (tw_armed(&pt->t_ms[i]) || tw_armed(&pt->t_trips[i])) continue;
+        patience_arm(pt, i, sl->dir == SLOT_DIR_ANY ? -1 : sl->dir, now);
+    }
+    state_unlock(pt->ipc);
+}
+
+// Rezygnacja tylko z SLOT_WAITING pod mutexem: kto zdazyl wejsc na mostek, juz nie rezygnuje
+static void patience_expire(tw_timer_t* t, void* arg) {
+    patience_t* pt = (patience_t*)arg;
+    const int32_t id = t->id;
+    const int by_trips = (t == &pt->t_trips[id]);
+    shm_state_t* s = pt->ipc->shm;
+
+    if (state_lock(pt->ipc) != 0) return;
+    passenger_slot_t* sl = slot_get(s, id);
+    const int32_t st = sl->state;
+    if (st == SLOT_WAITING) sl->state = SLOT_GAVE_UP;
+    state_unlock(pt->ipc);
+
+    if (st == SLOT_ADMITTED) {
+        // bilet planera: niewykorzystany wraca do puli po LOADING, wtedy sprawdzimy ponownie
+        tw_wheel_t* w = by_trips ? &pt->trips[t->tag] : &pt->ms;
+        tw_add(w, t, w->now + (by_trips ? 1 : PAT_RECHECK_MS));
+        return;
+    }
+    if (st != SLOT_WAITING) return;
+
+    patience_disarm(pt, id);
+    const int waited = (int)(now_ms_monotonic() - pt->t_wait[id]);
+    pt->gave_up[by_trips]++;
+    ev_publish(s, -1, EV_GAVE_UP, id, by_trips, waited);
+    // pasazer spi na fazie (z bitem slotu) albo na wlasnym slocie (planer)
+    phase_poke_slot(s, id);
+    slot_wake(s, id);
+    logf(pt->lg, "captain", "GAVE UP slot=%d reason=%s waited_ms=%d", (int)id, by_trips ? "trips" : "time", waited);
+}
+
+static void patience_init(patience_t* pt, ipc_handles_t* ipc, logger_t* lg, int32_t ship) {
+    memset(pt, 0, sizeof(*pt));
+    if (ship != 0) return;
+    pt->limit_ms = ipc->shm->patience_ms;
+    pt->limit_trips = ipc->shm->patience_trips;
+    pt->enabled = pt->limit_ms > 0 || pt->limit_trips > 0;
+    if (!pt->enabled) return;
+
+    pt->ipc = ipc;
+    pt->lg = lg;
+    pt->slots = (int32_t)ipc->shm->layout.slots_cap;
+    const size_t n = pt->slots > 0 ? (size_t)pt->slots : 1;
+    pt->t_ms = (tw_timer_t*)calloc(n, sizeof(tw_timer_t));
+    pt->t_trips = (tw_timer_t*)calloc(n, sizeof(tw_timer_t));
+    pt->t_wait = (int64_t*)calloc(n, sizeof(int64_t));
+    if (!pt->t_ms || !pt->t_trips || !pt->t_wait) die_perror("calloc(patience)");
+    for (int32_t i = 0; i < pt->slots; i++) {
+        tw_timer_init(&pt->t_ms[i], i, 0);
+        tw_timer_init(&pt->t_trips[i], i, 0);
+    }
+    tw_init(&pt->ms, (uint64_t)now_ms_monotonic());
+    for (int i = 0; i < 3; i++) tw_init(&pt->trips[i], 0);
+
+    // szyna numeruje dalej miedzy przebiegami demona: od biezacego head + jednorazowy przeglad slotow
+    ev_subscribe(ipc->shm, &pt->cur, 0);
+    patience_rescan(pt);
+}
+
+// Odplyw w kierunku dir: jeden tick kola tego kierunku i kola pasazerow bez kierunku.
+// Zdarzenia statku sprzed EV_DEPART (wejscia na mostek) sa juz przetworzone - kolejnosc szyny.
+static void patience_depart(patience_t* pt, int dir) {
+    if (pt->limit_trips <= 0) return;
+    tw_wheel_t* w = &pt->trips[dir & 1];
+    (void)tw_advance(w, w->now + 1, patience_expire, pt);
+    w = &pt->trips[PAT_WHEEL_ANY];
+    (void)tw_advance(w, w->now + 1, patience_expire, pt);
+}
+
+static void patience_poll(patience_t* pt) {
+    if (!pt->enabled) return;
+    event_t ev;
+    while (ev_next(pt->ipc->shm, &pt->cur, &ev)) {
+        switch (ev.type) {
+        case EV_PASSENGER_START:
+            patience_arm(pt, ev.slot, ev.a, ev.t_ns / 1000000);
+            break;
+        case EV_BRIDGE_ENTER:
+            if (ev.a == BRIDGE_DIR_IN) patience_disarm(pt, ev.slot);
+            break;
+        case EV_PASSENGER_EXIT:
+            patience_disarm(pt, ev.slot);
+            break;
+        case EV_TRIP_START:
+            if (ev.ship >= 0 && ev.ship < MAX_F) pt->ship_dir[ev.ship] = ev.a;
+            break;
+        case EV_DEPART:
+            if (ev.ship >= 0 && ev.ship < MAX_F) patience_depart(pt, pt->ship_dir[ev.ship]);
+            break;
+        default:
+            break;
+        }
+    }
+    if (pt->cur.lost != pt->lost_seen) {
+        pt->lost_seen = pt->cur.lost;
+        patience_rescan(pt);
+    }
+    (void)tw_advance(&pt->ms, (uint64_t)now_ms_monotonic(), patience_expire, pt);
+}
+
+// Termin oczekiwania petli kapitana: nie dluzej niz do najblizszego terminu cierpliwosci
+static int patience_cap(const patience_t* pt, int timeout_ms) {
+    if (!pt->enabled) return timeout_ms;
+    const int64_t n = tw_next(&pt->ms);
+    if (n < 0) return timeout_ms;
+    const int64_t left = (int64_t)pt->ms.now + n - now_ms_monotonic();
+    if (left >= timeout_ms) return timeout_ms;
+    return left > 0 ? (int)left : 0;
+}
+
+static void patience_free(patience_t* pt) {
+    free(pt->t_ms);
+    free(pt->t_trips);
+    free(pt->t_wait);
+}
+
+// 1 = za odlozonymi DEPART czeka STOP (skrzynka jest FIFO, wiec bez tego STOP stalby do nastepnego LOADING)
+static int ctl_stop_queued(shm_state_t* s, int32_t ship) {
+    ctl_slot_t c;
+    for (uint32_t n = 1; ctl_peek_nth(s, ship, n, &c); n++) {
+        if (c.cmd == CTL_STOP) return 1;
+    }
+    return 0;
+}
+
+// Komendy dyspozytora ze skrzynki (control.h): STOP przyjmowany zawsze, DEPART tylko w LOADING
+// i najwyzej jeden na zaladunek - kolejny czeka na nastepne LOADING (dwie komendy = dwa odplywy).
+// DEPART z for_trip, ktorego zaladunek juz minal, jest potwierdzany jako STALE (bez efektu),
+// podobnie odlozony DEPART, za ktorym stoi STOP - STOP go wyprzedza i nastepnego zaladunku nie bedzie.
+static void captain_poll_commands(ipc_handles_t* ipc, logger_t* lg, int32_t ship, int loading, int trip) {
+    ctl_slot_t c;
+    while (ctl_peek(ipc->shm, ship, &c)) {
+        if (c.cmd == CTL_DEPART && c.for_trip >= 0 &&
+            (c.for_trip < trip || (c.for_trip == trip && !loading))) {
+            ctl_ack(ipc->shm, ship, trip, CTL_STALE);
+            logf(lg, "captain", "command depart seq=%u stale (for trip=%d, now trip=%d)", c.seq, c.for_trip, trip);
+            continue;
+        }
+        if (c.cmd == CTL_DEPART) {
+            if (!loading || g_early_depart) {
+                if (!ctl_stop_queued(ipc->shm, ship)) break;
+                ctl_ack(ipc->shm, ship, trip, CTL_STALE);
+                logf(lg, "captain", "command depart seq=%u stale (overtaken by stop, trip=%d)", c.seq, trip);
+                continue;
             }
-            // Jesli przyjdzie inny ack, ignorujemy (w praktyce rzadkie przy sekwencyjnym evict).
+            g_early_depart = 1;
         }
+        else if (c.cmd == CTL_STOP) {
+            g_stop = 1;
+        }
+        ctl_ack(ipc->shm, ship, trip, CTL_DONE);
+        logf(lg, "captain", "command %s seq=%u accepted (trip=%d)", ctl_cmd_str(c.cmd), c.seq, trip);
     }
 }
 
-static int set_phase(ipc_handles_t* ipc, logger_t* lg, phase_t ph, int boarding_open) {
-    if (sem_wait_nointr(ipc->sem_state) != 0) return -1;
-    ipc->shm->phase = ph;
-    ipc->shm->boarding_open = boarding_open;
-    sem_post_chk(ipc->sem_state);
-    logf(lg, "captain", "phase=%d boarding_open=%d", (int)ph, boarding_open);
+static int set_phase(ipc_handles_t* ipc, logger_t* lg, int32_t ship, phase_t ph, int boarding_open) {
+    if (state_lock(ipc) != 0) return -1;
+    ipc->shm->ships[ship].phase = ph;
+    ipc->shm->ships[ship].boarding_open = boarding_open;
+    state_unlock(ipc);
+    phase_publish(ipc->shm);
+    ev_publish(ipc->shm, ship, EV_PHASE, -1, (int32_t)ph, boarding_open);
+    logf(lg, "captain", "ship=%d phase=%d boarding_open=%d", (int)ship, (int)ph, boarding_open);
     return 0;
 }
 
@@ -131,52 +634,133 @@ int main(int argc, char** argv) {
     install_handlers();
 
     ipc_handles_t ipc;
-    if (ipc_open(&ipc, a.shm_name, a.sem_prefix, a.msqid) != 0) {
+    if (ipc_open(&ipc, a.shm_name, a.shm_fd, a.msqid) != 0) {
         fprintf(stderr, "captain: ipc_open failed\n");
         return 1;
     }
 
     logger_t lg;
-    if (logger_open(&lg, a.log_path, ipc.sem_log) != 0) {
+    int lr = (a.log_fd >= 0) ? logger_attach(&lg, a.log_fd, ipc.mtx_log)
+        : logger_open(&lg, a.log_path, ipc.mtx_log);
+    if (lr != 0) {
         fprintf(stderr, "captain: logger_open failed\n");
         ipc_close(&ipc);
         return 1;
     }
 
-    logf(&lg, "captain", "started; shm=%s msqid=%d", a.shm_name, ipc.msqid);
+    results_writer_t res;
+    if (results_attach(&res, a.results_fd) != 0) {
+        fprintf(stderr, "captain: results_attach failed\n");
+        logger_close(&lg);
+        ipc_close(&ipc);
+        return 1;
+    }
+
+    ship_state_t* sh = ship_get(ipc.shm, a.ship);
+    if (!sh) {
+        fprintf(stderr, "captain: --ship %d outside fleet (F=%d)\n", (int)a.ship, (int)ipc.shm->F);
+        results_detach(&res);
+        logger_close(&lg);
+        ipc_close(&ipc);
+        return 2;
+    }
+    const int32_t ship = a.ship;
+
+    logf(&lg, "captain", "started; ship=%d N=%d M=%d offset_ms=%d shm=%s msqid=%d",
+        (int)ship, (int)sh->N, (int)sh->M, (int)sh->offset_ms, a.shm_name, ipc.msqid);
 
     int trips_done = 0;
+    const char* policy_name = cli_depart_policy_str(ipc.shm->depart_policy);
+    int64_t run_start = now_ms_monotonic();
+    int64_t cycle_ms = ipc.shm->T2_ms;   // pierwsze przyblizenie czasu rejsu poza LOADING
+    int64_t depart_ms = -1;
+    int64_t total_pax = 0;
+    double util_sum = 0.0;
+
+    const int board_batch = ipc.shm->board_batch;
+    bridge_node_t* admit_buf = NULL;
+    if (board_batch > 0) {
+        admit_buf = (bridge_node_t*)calloc((size_t)board_batch, sizeof(bridge_node_t));
+        if (!admit_buf) die_perror("calloc(admit_buf)");
+    }
+
+    planner_t plan;
+    memset(&plan, 0, sizeof(plan));
+    const int use_planner = ipc.shm->admission == ADMIT_PLANNER;
+    if (use_planner) {
+        const size_t cap = ipc.shm->layout.slots_cap;
+        plan.cand = (plan_cand_t*)calloc(cap ? cap : 1, sizeof(plan_cand_t));
+        plan.granted = (int32_t*)calloc(cap ? cap : 1, sizeof(int32_t));
+        if (!plan.cand || !plan.granted) die_perror("calloc(planner)");
+    }
+
+    patience_t pat;
+    patience_init(&pat, &ipc, &lg, ship);
+    if (pat.enabled) {
+        logf(&lg, "captain", "patience ms=%d trips=%d (timer wheel)", pat.limit_ms, pat.limit_trips);
+    }
+
+    // przesuniecie rozkladu: statki floty nie odbijaja naraz; kierunek startowy z konfiguracji
+    if (state_lock(&ipc) != 0) g_exit = 1;
+    else {
+        sh->direction = sh->start_dir;
+        state_unlock(&ipc);
+    }
+    const int64_t offset_end = now_ms_monotonic() + sh->offset_ms;
+    while (!g_exit && !__atomic_load_n(&ipc.shm->shutdown, __ATOMIC_RELAXED) && now_ms_monotonic() < offset_end) {
+        patience_poll(&pat);
+        const int64_t left = offset_end - now_ms_monotonic();
+        sleep_ms(patience_cap(&pat, left < 20 ? (int)left : 20));
+    }
 
     while (!g_exit) {
         // Sprawdz shutdown z launchera
-        if (sem_wait_nointr(ipc.sem_state) != 0) break;
+        if (state_lock(&ipc) != 0) break;
         int shutdown = ipc.shm->shutdown;
-        sem_post_chk(ipc.sem_state);
+        state_unlock(&ipc);
         if (shutdown) {
             logf(&lg, "captain", "shutdown flag set -> END");
-            if (set_phase(&ipc, &lg, PHASE_END, 0) != 0) break;
+            if (set_phase(&ipc, &lg, ship, PHASE_END, 0) != 0) break;
             break;
         }
 
         // reset jednorazowego sygnalu "early depart" na start tripu
         g_early_depart = 0;
 
-        if (set_phase(&ipc, &lg, PHASE_LOADING, 1) != 0) break;
+        if (set_phase(&ipc, &lg, ship, PHASE_LOADING, 1) != 0) break;
 
-        if (sem_wait_nointr(ipc.sem_state) != 0) break;
-        ipc.shm->trip_no += 1;
-        int my_trip = ipc.shm->trip_no;
+        if (state_lock(&ipc) != 0) break;
+        sh->trip_no += 1;
+        int my_trip = sh->trip_no;
 
         // snapshot kierunku dla statystyk tej podrozy
-        int trip_dir = (int)ipc.shm->direction;
+        int trip_dir = (int)sh->direction;
 
-        ipc.shm->bridge.dir = BRIDGE_DIR_NONE;
-        sem_post_chk(ipc.sem_state);
+        // zaladunek jest juz otwarty (set_phase): zerujemy tylko puste trapy (OUT po rozladunku),
+        // kolejka, ktora zdazyla wejsc, zostaje IN - inaczej captain_admit_batch pominie ten trap
+        for (int32_t g = 0; g < ipc.shm->G; g++) {
+            if (sh->bridge[g].count == 0) sh->bridge[g].dir = BRIDGE_DIR_NONE;
+        }
+        state_unlock(&ipc);
 
         // sleep(100);
-        logf(&lg, "captain", "trip=%d direction=%d LOADING", my_trip, trip_dir);
-        int64_t start = now_ms_monotonic();
+        ev_publish(ipc.shm, ship, EV_TRIP_START, -1, trip_dir, 0);
+        logf(&lg, "captain", "ship=%d trip=%d direction=%d LOADING", (int)ship, my_trip, trip_dir);
+        const int64_t start_ns = now_ns_monotonic();
+        int64_t start = start_ns / 1000000;
+        if (depart_ms >= 0) cycle_ms = start - depart_ms;
+        trip_rec_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.trip = my_trip;
+        rec.ship = ship;
+        rec.dir = trip_dir;
+        rec.t_loading = start_ns;
+        depart_ctx_t dc;
+        depart_begin(&dc, ipc.shm, ship, start, cycle_ms);
         while (!g_exit) {
+            const uint32_t cseq = captain_seq(ipc.shm, ship);
+            captain_poll_commands(&ipc, &lg, ship, 1, my_trip);
+            patience_poll(&pat);
             // jesli sygnal2 dotarl w trakcie zaladunku: statek nie wyplywa, pasazerowie opuszczaja statek
             if (g_stop) {
                 logf(&lg, "captain", "stop during LOADING -> cancel trip and UNLOADING");
@@ -186,111 +770,181 @@ int main(int argc, char** argv) {
                 logf(&lg, "captain", "early depart signal received");
                 break;
             }
-            int64_t now = now_ms_monotonic();
-            if (now - start >= ipc.shm->T1_ms) {
-                logf(&lg, "captain", "T1 elapsed -> depart");
+            if (use_planner && planner_tick(&ipc, ship, &plan) < 0) break;
+            int admitted = 0;
+            if (admit_buf) admitted = captain_admit_batch(&ipc, ship, admit_buf, board_batch);
+            if (admitted < 0) break;
+
+            if (state_lock(&ipc) != 0) break;
+            int onboard = sh->onboard_passengers;
+            state_unlock(&ipc);
+            const char* why = depart_check(&dc, onboard, now_ms_monotonic());
+            if (why) {
+                logf(&lg, "captain", "%s -> depart (policy=%s onboard=%d)", why, policy_name, onboard);
                 break;
             }
-            sleep_ms(20);
+            const int tick_ms = dc.policy == DEPART_FIXED ? 20 : 5;
+            // pelna paczka: na mostku moze czekac wiecej - bez spania
+            if (admit_buf && admitted == board_batch) continue;
+            // planer / wpuszczanie grupowe: budzi nas pasazer (captain_notify), tick to tylko zapas;
+            // komenda dyspozytora (ctl_post) tez budzi przez captain_wake
+            (void)captain_wait(ipc.shm, ship, cseq, patience_cap(&pat, tick_ms));
         }
+        rec.t_departing = now_ns_monotonic();
+        depart_ms = rec.t_departing / 1000000;
+        const int64_t load_ms = depart_ms - start;
 
         // Zamknij boarding i przejda do DEPARTING
-        if (set_phase(&ipc, &lg, PHASE_DEPARTING, 0) != 0) break;
+        if (set_phase(&ipc, &lg, ship, PHASE_DEPARTING, 0) != 0) break;
+        if (use_planner) planner_close(&ipc, ship, &plan);
 
-        if (sem_wait_nointr(ipc.sem_state) != 0) break;
-        ipc.shm->bridge.dir = BRIDGE_DIR_OUT;
-        sem_post_chk(ipc.sem_state);
+        if (state_lock(&ipc) != 0) break;
+        ship_set_bridge_dir(ipc.shm, ship, BRIDGE_DIR_OUT);
+        state_unlock(&ipc);
+        phase_publish(ipc.shm);
 
         int trip_left_bridge = 0;
-        if (captain_clear_bridge(&ipc, &lg, &trip_left_bridge) != 0) break;
+        if (captain_clear_bridge(&ipc, &lg, ship, &trip_left_bridge) != 0) break;
 
         int trip_boarded_pax = 0;
         int trip_boarded_bikes = 0;
-        if (sem_wait_nointr(ipc.sem_state) != 0) break;
-        trip_boarded_pax = ipc.shm->onboard_passengers;
-        trip_boarded_bikes = ipc.shm->onboard_bikes;
-        sem_post_chk(ipc.sem_state);
+        if (state_lock(&ipc) != 0) break;
+        trip_boarded_pax = sh->onboard_passengers;
+        trip_boarded_bikes = sh->onboard_bikes;
+        state_unlock(&ipc);
+
+        rec.pax = trip_boarded_pax;
+        rec.bikes = trip_boarded_bikes;
+        rec.left_bridge = trip_left_bridge;
 
         if (g_stop) {
-            if (set_phase(&ipc, &lg, PHASE_UNLOADING, 0) != 0) break;
+            rec.t_sailing = -1;
+            rec.t_unloading = now_ns_monotonic();
+            if (set_phase(&ipc, &lg, ship, PHASE_UNLOADING, 0) != 0) break;
 
-            if (sem_wait_nointr(ipc.sem_state) != 0) break;
-            ipc.shm->bridge.dir = BRIDGE_DIR_OUT;
-            sem_post_chk(ipc.sem_state);
+            if (state_lock(&ipc) != 0) break;
+            ship_set_bridge_dir(ipc.shm, ship, BRIDGE_DIR_OUT);
+            state_unlock(&ipc);
+            phase_publish(ipc.shm);
 
             for (;;) {
-                if (sem_wait_nointr(ipc.sem_state) != 0) break;
-                int onboard = ipc.shm->onboard_passengers;
-                sem_post_chk(ipc.sem_state);
+                if (state_lock(&ipc) != 0) break;
+                int onboard = sh->onboard_passengers;
+                state_unlock(&ipc);
                 if (onboard == 0) break;
+                patience_poll(&pat);
                 sleep_ms(50);
             }
             if (g_exit) break;
 
+            ev_publish(ipc.shm, ship, EV_TRIP_END, -1, trip_boarded_pax, trip_boarded_bikes);
+            rec.t_done = now_ns_monotonic();
+            (void)results_trip_append(&res, &rec);
             logf(&lg, "captain", "unloading complete (stop)");
             logf(&lg, "captain",
-                "TRIP SUMMARY trip=%d route=%s passengers=%d bikes=%d left_bridge=%d",
-                my_trip, dir_str(trip_dir), trip_boarded_pax, trip_boarded_bikes, trip_left_bridge);
+                "TRIP SUMMARY ship=%d trip=%d route=%s passengers=%d bikes=%d left_bridge=%d util=%.2f load_ms=%lld policy=%s",
+                (int)ship, my_trip, dir_str(trip_dir), trip_boarded_pax, trip_boarded_bikes, trip_left_bridge,
+                (double)trip_boarded_pax / (double)sh->N, (long long)load_ms, policy_name);
 
             logf(&lg, "captain", "all passengers left after stop -> END");
-            if (set_phase(&ipc, &lg, PHASE_END, 0) != 0) break;
+            if (set_phase(&ipc, &lg, ship, PHASE_END, 0) != 0) break;
             break;
         }
 
+        ev_publish(ipc.shm, ship, EV_DEPART, -1, trip_boarded_pax, trip_boarded_bikes);
         logf(&lg, "captain", "sailing for T2=%dms", ipc.shm->T2_ms);
-        if (set_phase(&ipc, &lg, PHASE_SAILING, 0) != 0) break;
-        int64_t sail_start = now_ms_monotonic();
+        if (set_phase(&ipc, &lg, ship, PHASE_SAILING, 0) != 0) break;
+        rec.t_sailing = now_ns_monotonic();
+        const int64_t sail_start = rec.t_sailing / 1000000;
         while (!g_exit) {
+            const uint32_t cseq = captain_seq(ipc.shm, ship);
+            captain_poll_commands(&ipc, &lg, ship, 0, my_trip);
+            patience_poll(&pat);
             int64_t now = now_ms_monotonic();
             if (now - sail_start >= ipc.shm->T2_ms) break;
-            sleep_ms(20);
+            (void)captain_wait(ipc.shm, ship, cseq, patience_cap(&pat, 20));
         }
 
         logf(&lg, "captain", "arrived -> UNLOADING");
-        if (set_phase(&ipc, &lg, PHASE_UNLOADING, 0) != 0) break;
-        if (sem_wait_nointr(ipc.sem_state) != 0) break;
-        ipc.shm->bridge.dir = BRIDGE_DIR_OUT;
-        sem_post_chk(ipc.sem_state);
+        rec.t_unloading = now_ns_monotonic();
+        if (set_phase(&ipc, &lg, ship, PHASE_UNLOADING, 0) != 0) break;
+        if (state_lock(&ipc) != 0) break;
+        ship_set_bridge_dir(ipc.shm, ship, BRIDGE_DIR_OUT);
+        state_unlock(&ipc);
+        phase_publish(ipc.shm);
 
         // czekaj az wszyscy zejda
         for (;;) {
-            if (sem_wait_nointr(ipc.sem_state) != 0) break;
-            int onboard = ipc.shm->onboard_passengers;
-            sem_post_chk(ipc.sem_state);
+            if (state_lock(&ipc) != 0) break;
+            int onboard = sh->onboard_passengers;
+            state_unlock(&ipc);
             if (onboard == 0) break;
+            patience_poll(&pat);
             sleep_ms(50);
         }
         if (g_exit) break;
 
+        ev_publish(ipc.shm, ship, EV_TRIP_END, -1, trip_boarded_pax, trip_boarded_bikes);
+        rec.t_done = now_ns_monotonic();
+        (void)results_trip_append(&res, &rec);
         logf(&lg, "captain", "unloading complete");
+        const double util = (double)trip_boarded_pax / (double)sh->N;
         logf(&lg, "captain",
-            "TRIP SUMMARY trip=%d route=%s passengers=%d bikes=%d left_bridge=%d",
-            my_trip, dir_str(trip_dir), trip_boarded_pax, trip_boarded_bikes, trip_left_bridge);
+            "TRIP SUMMARY ship=%d trip=%d route=%s passengers=%d bikes=%d left_bridge=%d util=%.2f load_ms=%lld policy=%s",
+            (int)ship, my_trip, dir_str(trip_dir), trip_boarded_pax, trip_boarded_bikes, trip_left_bridge,
+            util, (long long)load_ms, policy_name);
 
         trips_done++;
+        total_pax += trip_boarded_pax;
+        util_sum += util;
+        captain_poll_commands(&ipc, &lg, ship, 0, my_trip);
         if (trips_done >= ipc.shm->R) {
             logf(&lg, "captain", "max trips R=%d reached -> END", ipc.shm->R);
-            if (set_phase(&ipc, &lg, PHASE_END, 0) != 0) break;
+            if (set_phase(&ipc, &lg, ship, PHASE_END, 0) != 0) break;
             break;
         }
 
         // jesli stop przyszedl w trakcie rejsu -> konczymy po biezacym rejsie (jestesmy po doplynieciu)
         if (g_stop) {
             logf(&lg, "captain", "stop after trip completion -> END");
-            if (set_phase(&ipc, &lg, PHASE_END, 0) != 0) break;
+            if (set_phase(&ipc, &lg, ship, PHASE_END, 0) != 0) break;
             break;
         }
 
         // przelacz kierunek na rejs powrotny
-        if (sem_wait_nointr(ipc.sem_state) != 0) break;
-        ipc.shm->direction = (ipc.shm->direction == DIR_KRAKOW_TO_TYNIEC)
+        if (state_lock(&ipc) != 0) break;
+        sh->direction = (sh->direction == DIR_KRAKOW_TO_TYNIEC)
             ? DIR_TYNIEC_TO_KRAKOW : DIR_KRAKOW_TO_TYNIEC;
-        sem_post_chk(ipc.sem_state);
+        state_unlock(&ipc);
     }
 
-    logf(&lg, "captain", "EXIT (g_exit=%d g_stop=%d g_early_depart=%d trips_done=%d)",
-        (int)g_exit, (int)g_stop, (int)g_early_depart, (int)trips_done);
-
+    // statek 0 skonczyl, ale reszta floty jeszcze wozi: terminy cierpliwosci biegna dalej
+    while (pat.enabled && !g_exit) {
+        if (state_lock(&ipc) != 0) break;
+        const int done = fleet_ended(ipc.shm) || ipc.shm->shutdown;
+        state_unlock(&ipc);
+        if (done) break;
+        const uint32_t cseq = captain_seq(ipc.shm, ship);
+        patience_poll(&pat);
+        (void)captain_wait(ipc.shm, ship, cseq, patience_cap(&pat, 50));
+    }
+    if (pat.enabled) {
+        logf(&lg, "captain", "PATIENCE gave_up=%d by_time=%d by_trips=%d",
+            pat.gave_up[0] + pat.gave_up[1], pat.gave_up[0], pat.gave_up[1]);
+    }
+    patience_free(&pat);
+    free(admit_buf);
+    free(plan.cand);
+    free(plan.granted);
+    int64_t run_ms = now_ms_monotonic() - run_start;
+    logf(&lg, "captain", "DEPART SUMMARY ship=%d policy=%s trips=%d passengers=%lld util_avg=%.2f pax_per_hour=%.0f",
+        (int)ship, policy_name, trips_done, (long long)total_pax, trips_done > 0 ? util_sum / trips_done : 0.0,
+        run_ms > 0 ? (double)total_pax * 3600000.0 / (double)run_ms : 0.0);
+
+    logf(&lg, "captain", "EXIT (ship=%d g_exit=%d g_stop=%d g_early_depart=%d trips_done=%d)",
+        (int)ship, (int)g_exit, (int)g_stop, (int)g_early_depart, (int)trips_done);
+
+    results_detach(&res);
     logger_close(&lg);
     ipc_close(&ipc);
     return 0;
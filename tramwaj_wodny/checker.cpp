@@ -0,0 +1,290 @@
+#include "common.h"
+#include "ipc.h"
+#include "cli.h"
+#include "logging.h"
+#include "util.h"
+
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Kontroler niezmiennikow w trakcie przebiegu (launcher --checker <hz>[:<cpu_pct>]).
+// Co okres robi migawke SHM pod mutexem stanu (tylko kopie statkow + sync_count_value, O(F*G)), a sprawdza
+// ja juz po zwolnieniu mutexu. Semafory zmieniaja sie poza mutexem, wiec porownanie z licznikami
+// to nierownosci, ktore wynikaja z kolejnosci zajmij-przed-wpisem / wymaz-przed-oddaniem:
+// wartosc semafora + licznik pod mutexem <= pojemnosc. Ksiega slotow (O(P)) jest liczona bez mutexu,
+// wiec moze byc chwilami niespojna; rownosc ksiega == liczniki sprawdzamy tylko dla statku w spoczynku
+// (SAILING/END i te same liczniki przed i po przejsciu ksiegi, sprawdzone drugim krotkim wejsciem pod mutex).
+// Budzet CPU: suma wlasnego CPU (CLOCK_PROCESS_CPUTIME_ID) nie przekracza cpu_pct% czasu od startu -
+// przy drogiej migawce (duze P) kolejne probki sa odsuwane zamiast podnosic narzut.
+
+static volatile sig_atomic_t g_exit = 0;
+
+static void on_term(int) { g_exit = 1; }
+
+static void install_handlers(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_term;
+    sigemptyset(&sa.sa_mask);
+
+    if (sigaction(SIGINT, &sa, NULL) != 0) die_perror("sigaction(SIGINT)");
+    if (sigaction(SIGTERM, &sa, NULL) != 0) die_perror("sigaction(SIGTERM)");
+    if (sigaction(SIGHUP, &sa, NULL) != 0) die_perror("sigaction(SIGHUP)");
+}
+
+static int64_t cpu_ns_self(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Niezmienniki (nazwy w logu VIOLATION inv=...)
+typedef enum {
+    INV_ONBOARD = 0,      // 0 <= onboard_passengers <= N
+    INV_BIKES,            // 0 <= onboard_bikes <= M
+    INV_SEATS_SEM,        // 0 <= sem_seats, sem_seats + onboard_passengers <= N
+    INV_BIKES_SEM,        // 0 <= sem_bikes, sem_bikes + onboard_bikes <= M
+    INV_BRIDGE_UNITS,     // count <= load_units <= min(2 * count, K)
+    INV_BRIDGE_SEM,       // 0 <= sem_bridge, sem_bridge + load_units <= K
+    INV_BRIDGE_DIR,       // ktos na trapie -> kierunek ustawiony, zgodny z faza (LOADING: nie OUT, UNLOADING: nie IN)
+    INV_BRIDGE_SAILING,   // SAILING -> wszystkie trapy puste
+    INV_LEDGER_ONBOARD,   // sloty z onboard na statku == onboard_passengers / onboard_bikes
+    INV_LEDGER_BRIDGE,    // sloty z ring_idx na trapie == count
+    INV_COUNT
+} inv_t;
+
+static const char* const k_inv_name[INV_COUNT] = {
+    "onboard", "bikes", "seats_sem", "bikes_sem", "bridge_units", "bridge_sem",
+    "bridge_dir", "bridge_sailing", "ledger_onboard", "ledger_bridge"
+};
+
+enum { CHECK_LOG_PER_INV = 20 };   // dalsze naruszenia tego samego typu tylko zliczane
+
+typedef struct {
+    int32_t F, G, K;
+    int32_t ended;
+    ship_state_t ships[MAX_F];
+    int seats_sem[MAX_F], bikes_sem[MAX_F], bridge_sem[MAX_F][MAX_G];
+    uint32_t nslots;
+    // ksiega slotow (bez mutexu); ledger_ok[i]: statek i w spoczynku, ksiega porownywalna z licznikami
+    int32_t led_onboard[MAX_F], led_bikes[MAX_F], led_bridge[MAX_F][MAX_G];
+    int32_t ledger_ok[MAX_F];
+    int64_t hold_ns;              // czas pod mutexem w tej probce (oba wejscia)
+} snapshot_t;
+
+typedef struct {
+    logger_t* lg;
+    int64_t t0_ms;
+    int64_t count[INV_COUNT];
+    int64_t first_ms[INV_COUNT];
+    int64_t total;
+    int64_t ledger_checks;        // statko-probki, w ktorych porownano ksiege
+    int64_t hold_ns_sum, hold_ns_max;
+} checker_t;
+
+static void violation(checker_t* ck, inv_t inv, int ship, int gw, const char* fmt, ...)
+    __attribute__((format(printf, 5, 6)));
+
+static void violation(checker_t* ck, inv_t inv, int ship, int gw, const char* fmt, ...) {
+    const int64_t t = now_ms_monotonic() - ck->t0_ms;
+    if (ck->count[inv] == 0) ck->first_ms[inv] = t;
+    ck->count[inv]++;
+    ck->total++;
+    if (ck->count[inv] > CHECK_LOG_PER_INV) return;
+    char detail[160];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(detail, sizeof(detail), fmt, ap);
+    va_end(ap);
+    logf(ck->lg, "checker", "VIOLATION t_ms=%lld inv=%s ship=%d gw=%d %s",
+        (long long)t, k_inv_name[inv], ship, gw, detail);
+}
+
+// Liczniki, ktore ksiega slotow musi odtworzyc, bez zmian od migawki
+static int ship_same_counters(const ship_state_t* a, const ship_state_t* b, int32_t G) {
+    if (a->phase != b->phase || a->trip_no != b->trip_no ||
+        a->onboard_passengers != b->onboard_passengers || a->onboard_bikes != b->onboard_bikes) return 0;
+    for (int32_t g = 0; g < G; g++) {
+        if (a->bridge[g].count != b->bridge[g].count) return 0;
+    }
+    return 1;
+}
+
+// Pod mutexem tylko kopie statkow i odczyty licznikow (O(F*G)); ksiega slotow bez mutexu,
+// potem drugie krotkie wejscie sprawdza, ktore statki staly w miejscu. 0 ok, -1 blad mutexu
+static int take_snapshot(ipc_handles_t* ipc, snapshot_t* sn) {
+    shm_state_t* s = ipc->shm;
+    if (state_lock(ipc) != 0) return -1;
+    int64_t t = now_ns_monotonic();
+    sn->F = s->F;
+    sn->G = s->G;
+    sn->K = s->K;
+    sn->ended = s->shutdown || fleet_ended(s);
+    memcpy(sn->ships, s->ships, sizeof(ship_state_t) * (size_t)sn->F);
+    for (int32_t i = 0; i < sn->F; i++) {
+        ship_state_t* sh = &s->ships[i];
+        sn->seats_sem[i] = sync_count_value(&sh->sync.seats);
+        sn->bikes_sem[i] = sync_count_value(&sh->sync.bikes);
+        for (int32_t g = 0; g < sn->G; g++) sn->bridge_sem[i][g] = sync_count_value(&sh->sync.bridge[g]);
+    }
+    sn->hold_ns = now_ns_monotonic() - t;
+    state_unlock(ipc);
+
+    // ksiega: pola slotu zmieniaja sie pod mutexem, tu tylko pojedyncze odczyty (relaxed)
+    memset(sn->led_onboard, 0, sizeof(sn->led_onboard));
+    memset(sn->led_bikes, 0, sizeof(sn->led_bikes));
+    memset(sn->led_bridge, 0, sizeof(sn->led_bridge));
+    for (uint32_t i = 0; i < sn->nslots; i++) {
+        const passenger_slot_t* sl = slot_get(s, (int32_t)i);
+        const int32_t ship = __atomic_load_n(&sl->ship, __ATOMIC_RELAXED);
+        if (ship >= sn->F) continue;
+        if (__atomic_load_n(&sl->onboard, __ATOMIC_RELAXED)) {
+            sn->led_onboard[ship]++;
+            sn->led_bikes[ship] += __atomic_load_n(&sl->bike, __ATOMIC_RELAXED);
+        }
+        const int32_t gw = __atomic_load_n(&sl->gw, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&sl->ring_idx, __ATOMIC_RELAXED) >= 0 && gw < sn->G) sn->led_bridge[ship][gw]++;
+    }
+
+    if (state_lock(ipc) != 0) return -1;
+    t = now_ns_monotonic();
+    for (int32_t i = 0; i < sn->F; i++) {
+        const ship_state_t* sh = &sn->ships[i];
+        sn->ledger_ok[i] = (sh->phase == PHASE_SAILING || sh->phase == PHASE_END) &&
+            ship_same_counters(sh, &s->ships[i], sn->G);
+    }
+    sn->hold_ns += now_ns_monotonic() - t;
+    state_unlock(ipc);
+    return 0;
+}
+
+static void check_snapshot(checker_t* ck, const snapshot_t* sn) {
+    ck->hold_ns_sum += sn->hold_ns;
+    if (sn->hold_ns > ck->hold_ns_max) ck->hold_ns_max = sn->hold_ns;
+    for (int32_t i = 0; i < sn->F; i++) {
+        const ship_state_t* sh = &sn->ships[i];
+        if (sh->onboard_passengers < 0 || sh->onboard_passengers > sh->N) {
+            violation(ck, INV_ONBOARD, i, -1, "onboard=%d N=%d", sh->onboard_passengers, sh->N);
+        }
+        if (sh->onboard_bikes < 0 || sh->onboard_bikes > sh->M) {
+            violation(ck, INV_BIKES, i, -1, "bikes=%d M=%d", sh->onboard_bikes, sh->M);
+        }
+        if (sn->seats_sem[i] < 0 || sn->seats_sem[i] + sh->onboard_passengers > sh->N) {
+            violation(ck, INV_SEATS_SEM, i, -1, "sem=%d onboard=%d N=%d", sn->seats_sem[i], sh->onboard_passengers, sh->N);
+        }
+        if (sn->bikes_sem[i] < 0 || sn->bikes_sem[i] + sh->onboard_bikes > sh->M) {
+            violation(ck, INV_BIKES_SEM, i, -1, "sem=%d bikes=%d M=%d", sn->bikes_sem[i], sh->onboard_bikes, sh->M);
+        }
+        if (sn->ledger_ok[i]) ck->ledger_checks++;
+        if (sn->ledger_ok[i] && (sn->led_onboard[i] != sh->onboard_passengers || sn->led_bikes[i] != sh->onboard_bikes)) {
+            violation(ck, INV_LEDGER_ONBOARD, i, -1, "ledger=%d/%d counters=%d/%d",
+                sn->led_onboard[i], sn->led_bikes[i], sh->onboard_passengers, sh->onboard_bikes);
+        }
+
+        for (int32_t g = 0; g < sn->G; g++) {
+            const bridge_state_t* b = &sh->bridge[g];
+            const int cap = 2 * b->count < sn->K ? 2 * b->count : sn->K;
+            if (b->load_units < b->count || b->load_units > cap) {
+                violation(ck, INV_BRIDGE_UNITS, i, g, "units=%d count=%d K=%d", b->load_units, b->count, sn->K);
+            }
+            if (sn->bridge_sem[i][g] < 0 || sn->bridge_sem[i][g] + b->load_units > sn->K) {
+                violation(ck, INV_BRIDGE_SEM, i, g, "sem=%d units=%d K=%d", sn->bridge_sem[i][g], b->load_units, sn->K);
+            }
+            if (b->count > 0 && (b->dir == BRIDGE_DIR_NONE ||
+                (sh->phase == PHASE_LOADING && b->dir == BRIDGE_DIR_OUT) ||
+                (sh->phase == PHASE_UNLOADING && b->dir == BRIDGE_DIR_IN))) {
+                violation(ck, INV_BRIDGE_DIR, i, g, "dir=%d phase=%d count=%d", (int)b->dir, (int)sh->phase, b->count);
+            }
+            if (sh->phase == PHASE_SAILING && b->count != 0) {
+                violation(ck, INV_BRIDGE_SAILING, i, g, "count=%d trip=%d", b->count, sh->trip_no);
+            }
+            if (sn->ledger_ok[i] && sn->led_bridge[i][g] != b->count) {
+                violation(ck, INV_LEDGER_BRIDGE, i, g, "ledger=%d count=%d", sn->led_bridge[i][g], b->count);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    cli_args_t a;
+    int r = cli_parse_checker(argc, argv, &a);
+    if (r == 1) { cli_print_usage_checker(); return 0; }
+    if (r != 0) { cli_print_usage_checker(); return 2; }
+
+    install_handlers();
+
+    ipc_handles_t ipc;
+    if (ipc_open(&ipc, a.shm_name, a.shm_fd, a.msqid) != 0) {
+        fprintf(stderr, "checker: ipc_open failed\n");
+        return 1;
+    }
+
+    logger_t lg;
+    int lr = (a.log_fd >= 0) ? logger_attach(&lg, a.log_fd, ipc.mtx_log)
+        : logger_open(&lg, a.log_path, ipc.mtx_log);
+    if (lr != 0) {
+        fprintf(stderr, "checker: logger_open failed\n");
+        ipc_close(&ipc);
+        return 1;
+    }
+
+    snapshot_t sn;
+    memset(&sn, 0, sizeof(sn));
+    sn.nslots = ipc.shm->layout.slots_cap;
+
+    checker_t ck;
+    memset(&ck, 0, sizeof(ck));
+    ck.lg = &lg;
+    ck.t0_ms = now_ms_monotonic();
+
+    const int64_t period_ns = 1000000000LL / a.check_hz;
+    const int64_t t0_ns = now_ns_monotonic();
+    const int64_t cpu0 = cpu_ns_self();
+    int64_t samples = 0, deferred = 0;
+    logf(&lg, "checker", "started hz=%d cpu_budget_pct=%d slots=%u", (int)a.check_hz, (int)a.check_cpu_pct, sn.nslots);
+
+    int64_t next_ns = t0_ns;
+    while (!g_exit) {
+        if (take_snapshot(&ipc, &sn) != 0) break;
+        check_snapshot(&ck, &sn);
+        samples++;
+        if (sn.ended) break;
+
+        // nastepna probka: po okresie, ale nie wczesniej niz pozwala budzet CPU od startu
+        const int64_t cpu = cpu_ns_self() - cpu0;
+        next_ns += period_ns;
+        const int64_t budget_ns = t0_ns + cpu * 100 / a.check_cpu_pct;
+        if (budget_ns > next_ns) {
+            next_ns = budget_ns;
+            deferred++;
+        }
+        const int64_t now = now_ns_monotonic();
+        if (next_ns < now) next_ns = now;   // zaleglych probek nie nadrabiamy seria
+        const int64_t wait_ms = (next_ns - now + 999999) / 1000000;
+        if (wait_ms > 0) sleep_ms((int)wait_ms);
+    }
+
+    const int64_t wall_ns = now_ns_monotonic() - t0_ns;
+    const int64_t cpu_ns = cpu_ns_self() - cpu0;
+    for (int i = 0; i < INV_COUNT; i++) {
+        if (ck.count[i] == 0) continue;
+        logf(&lg, "checker", "CHECK inv=%s violations=%lld first_t_ms=%lld", k_inv_name[i],
+            (long long)ck.count[i], (long long)ck.first_ms[i]);
+    }
+    logf(&lg, "checker",
+        "CHECK SUMMARY samples=%lld deferred=%lld violations=%lld ledger_checks=%lld hz=%.1f/%d cpu_ms=%.2f "
+        "cpu_pct=%.2f/%d lock_hold_us_avg=%.2f lock_hold_us_max=%.2f",
+        (long long)samples, (long long)deferred, (long long)ck.total, (long long)ck.ledger_checks,
+        wall_ns > 0 ? (double)samples * 1e9 / (double)wall_ns : 0.0, (int)a.check_hz,
+        (double)cpu_ns / 1e6, wall_ns > 0 ? 100.0 * (double)cpu_ns / (double)wall_ns : 0.0, (int)a.check_cpu_pct,
+        samples > 0 ? (double)ck.hold_ns_sum / 1e3 / (double)samples : 0.0, (double)ck.hold_ns_max / 1e3);
+
+    logger_close(&lg);
+    ipc_close(&ipc);
+    return ck.total > 0 ? 3 : 0;
+}
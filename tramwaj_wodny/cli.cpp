@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static int streq(const char* a, const char* b) { return strcmp(a, b) == 0; } // pomocnicze porownanie stringow (rowne -> 1)
@@ -13,7 +14,13 @@ static int need_arg(int i, int argc) { return (i + 1) < argc; } // sprawdza czy
 void cli_print_usage_tramwaj(void) {
     fprintf(stderr, // wypisuje instrukcje uruchomienia programu glownego (launcher)
         "Usage:\n"
-        "  tramwaj --N <int> --M <int> --K <int> --T1 <ms> --T2 <ms> --R <int> --P <int> [--bike-prob <0..1>] [--log <path>]\n"
+        "  tramwaj --N <int> --M <int> --K <int> --T1 <ms> --T2 <ms> --R <int> --P <int> [--bike-prob <0..1>] [--evict-timeout <ms>]\n"
+        "          [--depart-policy fixed|full|idle:<ms>|adaptive] [--board-batch <B>]\n"
+        "          [--admission race|planner] [--results <path>] [--log <path>]\n"
+        "          [--patience <ms>] [--patience-trips <n>] [--fleet <F>|<N:M[:offset_ms],...>] [--gangways <G>]\n"
+        "          [--seed <u64>] [--workload <file>] [--record-workload <file>]\n"
+        "          [--control <sock>] [--control-script <file>]\n"
+        "          [--dispatch-policy fill:<pct>[:<idle_ms>]|queue:<n>[:<idle_ms>]] [--checker <hz>[:<cpu_pct>]]\n"
         "Example:\n"
         "  ./tramwaj --N 20 --M 5 --K 6 --T1 1000 --T2 1500 --R 8 --P 60 --bike-prob 0.3 --log simulation.log\n");
 }
@@ -22,33 +29,178 @@ void cli_print_usage_dispatcher(void) {
     fprintf(stderr, // wypisuje instrukcje uruchomienia dispatchera
         "Usage:\n"
         "  dispatcher --captain-pid <pid> --log <path>\n"
-        "  (IPC args are optional for dispatcher)\n");
+        "  dispatcher --shm <name> --msqid <id> --log <path> [--control <sock>] [--script <file>]\n"
+        "             [--policy fill:<pct>[:<idle_ms>]|queue:<n>[:<idle_ms>]]\n"
+        "  dispatcher --control-send <sock>\n"
+        "  (IPC args are optional for dispatcher; --control/--script need them)\n");
 }
 
 void cli_print_usage_captain(void) {
     fprintf(stderr, // wypisuje instrukcje uruchomienia kapitana (wymaga IPC)
         "Usage:\n"
-        "  captain --shm <name> --sem-prefix <prefix> --msqid <id> --log <path>\n");
+        "  captain --shm <name> --msqid <id> --log <path> [--shm-fd <fd>] [--log-fd <fd>]\n"
+        "          [--results-fd <fd>] [--ship <i>]\n");
 }
 
 void cli_print_usage_passenger(void) {
     fprintf(stderr, // wypisuje instrukcje uruchomienia pasazera (IPC + opcjonalne dir/bike)
         "Usage:\n"
-        "  passenger --shm <name> --sem-prefix <prefix> --msqid <id> --log <path> [--dir 0|1] [--bike 0|1]\n"
-        "  dir: 0 Krakow->Tyniec, 1 Tyniec->Krakow\n");
+        "  passenger --shm <name> --msqid <id> --log <path> --id <slot> [--dir 0|1] [--bike 0|1] [--shm-fd <fd>] [--log-fd <fd>]\n"
+        "            [--results-fd <fd>]\n"
+        "  dir: 0 Krakow->Tyniec, 1 Tyniec->Krakow\n"
+        "  id: indeks slotu pasazera w SHM (0..P-1)\n");
+}
+
+void cli_print_usage_checker(void) {
+    fprintf(stderr, // wypisuje instrukcje uruchomienia kontrolera niezmiennikow
+        "Usage:\n"
+        "  checker --shm <name> --msqid <id> --log <path> [--hz <n>] [--cpu-pct <p>] [--shm-fd <fd>] [--log-fd <fd>]\n"
+        "  hz: probki na sekunde (domyslnie %d), cpu-pct: budzet CPU w %% (domyslnie %d)\n",
+        CHECK_DEFAULT_HZ, CHECK_DEFAULT_CPU_PCT);
 }
 
 static void init_defaults(cli_args_t* a) {
     memset(a, 0, sizeof(*a));                                 // wyzeruj cala strukture argumentow
     a->bike_prob = 0.0;                                       // domyslnie brak rowerow (prawdopodobienstwo)
+    a->evict_timeout_ms = 200;                                // termin na ACK ewakuacji (potem sprawdzenie i wymuszenie)
+    a->depart_policy = DEPART_FIXED;                          // domyslnie odplyw po T1 (jak dotychczas)
+    a->depart_idle_ms = 0;
+    a->board_batch = 0;                                       // domyslnie kazdy pasazer wchodzi sam
+    a->admission = ADMIT_RACE;                                // domyslnie wyscig sem_trywait (jak dotychczas)
+    a->patience_ms = 0;                                       // domyslnie pasazer czeka do konca symulacji
+    a->patience_trips = 0;
+    a->fleet.F = 1;                                           // domyslnie jeden statek z --N/--M
+    a->gangways = 1;                                          // domyslnie jeden trap (mostek) na statek
     a->msqid = -1;                                            // -1 oznacza "nieustawione" dla id kolejki
+    a->shm_fd = -1;                                           // -1: SHM otwierane po nazwie (shm_open)
+    a->log_fd = -1;                                           // -1: log otwierany po sciezce
+    a->results_fd = -1;                                       // -1: bez pliku wynikow
     a->captain_pid = -1;                                      // -1 oznacza "nieustawione" dla PID kapitana
     a->desired_dir = -1;                                      // -1 oznacza "losowo/nieustawione" dla kierunku pasazera
     a->bike_flag = -1;                                        // -1 oznacza "losowo/nieustawione" dla flagi roweru
+    a->passenger_id = -1;                                     // -1 oznacza "nieustawione" dla slotu pasazera
     a->interactive = 1;                                       // domyslnie tryb interaktywny dispatchera wlaczony
+    a->check_hz = 0;                                          // launcher: kontroler wylaczony
+    a->check_cpu_pct = CHECK_DEFAULT_CPU_PCT;
     snprintf(a->log_path, sizeof(a->log_path), "simulation.log"); // domyslna sciezka do logu
 }
 
+int cli_parse_depart_policy(const char* s, int32_t* policy, int32_t* idle_ms) {
+    if (!s || !policy || !idle_ms) return -1;
+    if (streq(s, "fixed")) { *policy = DEPART_FIXED; return 0; }
+    if (streq(s, "full")) { *policy = DEPART_FULL; return 0; }
+    if (streq(s, "adaptive")) { *policy = DEPART_ADAPTIVE; return 0; }
+    if (strncmp(s, "idle:", 5) == 0) {                        // idle:<ms>
+        if (parse_i32(s + 5, idle_ms) != 0 || *idle_ms <= 0) return -1;
+        *policy = DEPART_IDLE;
+        return 0;
+    }
+    return -1;                                                // nieznana polityka
+}
+
+const char* cli_depart_policy_str(int32_t policy) {
+    switch (policy) {
+    case DEPART_FIXED: return "fixed";
+    case DEPART_FULL: return "full";
+    case DEPART_IDLE: return "idle";
+    case DEPART_ADAPTIVE: return "adaptive";
+    default: return "?";
+    }
+}
+
+int cli_parse_dispatch_policy(const char* s, dispatch_policy_cfg_t* out) {
+    if (!s || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    const char* v;
+    if (strncmp(s, "fill:", 5) == 0) { out->kind = DISPATCH_FILL; v = s + 5; }       // fill:<pct>[:<idle_ms>]
+    else if (strncmp(s, "queue:", 6) == 0) { out->kind = DISPATCH_QUEUE; v = s + 6; } // queue:<n>[:<idle_ms>]
+    else return -1;
+
+    char num[16];
+    const char* colon = strchr(v, ':');
+    const size_t n = colon ? (size_t)(colon - v) : strlen(v);
+    if (n == 0 || n >= sizeof(num)) return -1;
+    memcpy(num, v, n);
+    num[n] = '\0';
+    if (colon && (parse_i32(colon + 1, &out->idle_ms) != 0 || out->idle_ms < 0)) return -1;
+    if (out->kind == DISPATCH_FILL) {
+        if (parse_i32(num, &out->fill_pct) != 0 || out->fill_pct < 1 || out->fill_pct > 100) return -1;
+    }
+    else if (parse_i32(num, &out->queue_n) != 0 || out->queue_n < 1) return -1;
+    return 0;
+}
+
+int cli_parse_checker_spec(const char* s, int32_t* hz, int32_t* cpu_pct) {
+    if (!s || !hz || !cpu_pct) return -1;
+    char num[16];
+    const char* colon = strchr(s, ':');
+    const size_t n = colon ? (size_t)(colon - s) : strlen(s);
+    if (n == 0 || n >= sizeof(num)) return -1;
+    memcpy(num, s, n);
+    num[n] = '\0';
+    if (parse_i32(num, hz) != 0 || *hz < 1 || *hz > CHECK_MAX_HZ) return -1;
+    if (colon && (parse_i32(colon + 1, cpu_pct) != 0 || *cpu_pct < 1 || *cpu_pct > 100)) return -1;
+    return 0;
+}
+
+int cli_parse_fleet(const char* s, cli_fleet_t* out) {
+    if (!s || !out || !*s) return -1;
+    memset(out, 0, sizeof(*out));
+    if (!strchr(s, ':')) {                                    // <F>: kopie --N/--M
+        if (parse_i32(s, &out->F) != 0 || out->F < 1 || out->F > MAX_F) return -1;
+        return 0;
+    }
+    out->caps = 1;
+    const char* p = s;
+    while (*p) {                                              // N:M[:offset_ms] oddzielone przecinkami
+        if (out->F >= MAX_F) return -1;
+        char item[64];
+        const char* comma = strchr(p, ',');
+        const size_t n = comma ? (size_t)(comma - p) : strlen(p);
+        if (n == 0 || n >= sizeof(item)) return -1;
+        memcpy(item, p, n);
+        item[n] = '\0';
+        char* f[3] = { item, NULL, NULL };
+        for (int k = 1; k < 3; k++) {
+            char* c = f[k - 1] ? strchr(f[k - 1], ':') : NULL;
+            if (c) { *c = '\0'; f[k] = c + 1; }
+        }
+        const int i = out->F;
+        if (!f[1] || parse_i32(f[0], &out->N[i]) != 0 || parse_i32(f[1], &out->M[i]) != 0) return -1;
+        if (f[2] && (parse_i32(f[2], &out->offset_ms[i]) != 0 || out->offset_ms[i] < 0)) return -1;
+        out->F++;
+        p += n;
+        if (*p == ',') p++;
+    }
+    return out->F > 0 ? 0 : -1;
+}
+
+// Bez listy statki ida parami w przeciwnych kierunkach (obie przystanie obsluzone od startu),
+// kolejne pary przesuniete rownomiernie w cyklu statku 2*(T1+T2)
+void cli_fleet_ship(const cli_args_t* a, int i, int32_t* N, int32_t* M, int32_t* offset_ms, int32_t* start_dir) {
+    const cli_fleet_t* f = &a->fleet;
+    *start_dir = (i & 1) ? DIR_TYNIEC_TO_KRAKOW : DIR_KRAKOW_TO_TYNIEC;
+    if (f->caps) {
+        *N = f->N[i];
+        *M = f->M[i];
+        *offset_ms = f->offset_ms[i];
+        return;
+    }
+    const int pairs = (f->F + 1) / 2;
+    *N = a->N;
+    *M = a->M;
+    *offset_ms = (int32_t)((int64_t)(i / 2) * 2 * ((int64_t)a->T1_ms + a->T2_ms) / pairs);
+}
+
+const char* cli_dispatch_policy_str(int32_t kind) {
+    switch (kind) {
+    case DISPATCH_NONE: return "none";
+    case DISPATCH_FILL: return "fill";
+    case DISPATCH_QUEUE: return "queue";
+    default: return "?";
+    }
+}
+
 int cli_parse_launcher(int argc, char** argv, cli_args_t* out) {
     if (!out) return -1;                                      // brak wskaznika wyjsciowego -> blad
     init_defaults(out);                                       // ustaw wartosci domyslne
@@ -79,6 +231,65 @@ int cli_parse_launcher(int argc, char** argv, cli_args_t* out) {
         else if (streq(k, "--bike-prob") && need_arg(i, argc)) {  // prawdopodobienstwo, ze pasazer ma rower
             if (parse_double(argv[++i], &out->bike_prob) != 0) return -1;
         }
+        else if (streq(k, "--depart-policy") && need_arg(i, argc)) { // polityka odplywu kapitana
+            if (cli_parse_depart_policy(argv[++i], &out->depart_policy, &out->depart_idle_ms) != 0) return -1;
+        }
+        else if (streq(k, "--admission") && need_arg(i, argc)) {  // przydzial miejsc: race | planner
+            const char* v = argv[++i];
+            if (streq(v, "race")) out->admission = ADMIT_RACE;
+            else if (streq(v, "planner")) out->admission = ADMIT_PLANNER;
+            else return -1;
+        }
+        else if (streq(k, "--board-batch") && need_arg(i, argc)) { // wpuszczanie grupowe przez kapitana
+            if (parse_i32(argv[++i], &out->board_batch) != 0) return -1;
+        }
+        else if (streq(k, "--patience") && need_arg(i, argc)) {   // cierpliwosc pasazera na ladzie (ms)
+            if (parse_i32(argv[++i], &out->patience_ms) != 0) return -1;
+        }
+        else if (streq(k, "--patience-trips") && need_arg(i, argc)) { // ile odplywow pasazer przepusci
+            if (parse_i32(argv[++i], &out->patience_trips) != 0) return -1;
+        }
+        else if (streq(k, "--fleet") && need_arg(i, argc)) {     // flota: liczba statkow albo lista pojemnosci
+            if (cli_parse_fleet(argv[++i], &out->fleet) != 0) return -1;
+        }
+        else if (streq(k, "--gangways") && need_arg(i, argc)) {  // trapy na statek (kazdy po K jednostek)
+            if (parse_i32(argv[++i], &out->gangways) != 0) return -1;
+        }
+        else if (streq(k, "--checker") && need_arg(i, argc)) {   // kontroler niezmiennikow: hz[:cpu_pct]
+            if (cli_parse_checker_spec(argv[++i], &out->check_hz, &out->check_cpu_pct) != 0) return -1;
+        }
+        else if (streq(k, "--evict-timeout") && need_arg(i, argc)) { // termin na ACK ewakuacji (ms)
+            if (parse_i32(argv[++i], &out->evict_timeout_ms) != 0) return -1;
+        }
+        else if (streq(k, "--seed") && need_arg(i, argc)) {       // ziarno PRNG obciazenia
+            const char* v = argv[++i];
+            char* end = NULL;
+            errno = 0;
+            unsigned long long sv = strtoull(v, &end, 10);
+            if (errno != 0 || end == v || *end != '\0' || v[0] == '-') return -1;
+            out->seed = (uint64_t)sv;
+            out->has_seed = 1;
+        }
+        else if (streq(k, "--workload") && need_arg(i, argc)) {   // plik obciazenia (ziarno / lista)
+            snprintf(out->workload_path, sizeof(out->workload_path), "%s", argv[++i]);
+        }
+        else if (streq(k, "--record-workload") && need_arg(i, argc)) { // zapis obciazenia z przebiegu
+            snprintf(out->record_workload_path, sizeof(out->record_workload_path), "%s", argv[++i]);
+        }
+        else if (streq(k, "--dispatch-policy") && need_arg(i, argc)) { // automatyczny odplyw w dyspozytorze
+            dispatch_policy_cfg_t tmp;
+            if (cli_parse_dispatch_policy(argv[i + 1], &tmp) != 0) return -1;
+            snprintf(out->dispatch_policy, sizeof(out->dispatch_policy), "%s", argv[++i]);
+        }
+        else if (streq(k, "--control") && need_arg(i, argc)) {    // gniazdo komend dyspozytora
+            snprintf(out->control_path, sizeof(out->control_path), "%s", argv[++i]);
+        }
+        else if (streq(k, "--control-script") && need_arg(i, argc)) { // skrypt komend dyspozytora
+            snprintf(out->control_script, sizeof(out->control_script), "%s", argv[++i]);
+        }
+        else if (streq(k, "--results") && need_arg(i, argc)) {    // plik wynikow kolumnowych
+            snprintf(out->results_path, sizeof(out->results_path), "%s", argv[++i]);
+        }
         else if (streq(k, "--log") && need_arg(i, argc)) {        // sciezka loga
             snprintf(out->log_path, sizeof(out->log_path), "%s", argv[++i]);
         }
@@ -96,29 +307,73 @@ int cli_parse_launcher(int argc, char** argv, cli_args_t* out) {
 
 int cli_validate_launcher(const cli_args_t* a, char* err, int err_sz) {
     if (!a) return -1;                                        // brak wejscia -> blad
-    if (a->N <= 0) { snprintf(err, err_sz, "N must be > 0"); return -1; }                  // N dodatnie
-    if (a->M < 0 || a->M >= a->N) { snprintf(err, err_sz, "M must be >=0 and M < N"); return -1; } // M w [0, N)
-    if (a->K <= 0 || a->K >= a->N) { snprintf(err, err_sz, "K must be >0 and K < N"); return -1; } // K w (0, N)
+    if (a->fleet.F < 1 || a->fleet.F > MAX_F) { snprintf(err, err_sz, "fleet must have 1..%d ships", MAX_F); return -1; }
+    for (int i = 0; i < a->fleet.F; i++) {                    // kazdy statek floty: N > 0, M w [0, N), K w (0, N)
+        int32_t N, M, off, dir;
+        cli_fleet_ship(a, i, &N, &M, &off, &dir);
+        if (N <= 0) { snprintf(err, err_sz, "ship %d: N must be > 0", i); return -1; }
+        if (M < 0 || M >= N) { snprintf(err, err_sz, "ship %d: M must be >=0 and M < N", i); return -1; }
+        if (a->K <= 0 || a->K >= N) { snprintf(err, err_sz, "ship %d: K must be >0 and K < N", i); return -1; }
+    }
     if (a->K > MAX_K) { snprintf(err, err_sz, "K too large (max %d)", MAX_K); return -1; }         // K nie przekracza MAX_K
+    if (a->gangways < 1 || a->gangways > MAX_G) { snprintf(err, err_sz, "gangways must be in [1..%d]", MAX_G); return -1; } // trapy na statek
     if (a->T1_ms <= 0 || a->T2_ms <= 0) { snprintf(err, err_sz, "T1 and T2 must be > 0 (ms)"); return -1; } // czasy dodatnie
     if (a->R <= 0) { snprintf(err, err_sz, "R must be > 0"); return -1; }                          // liczba kursow dodatnia
     if (a->P < 0 || a->P > MAX_P) { snprintf(err, err_sz, "P must be in [0..%d]", MAX_P); return -1; }      // P w dozwolonym zakresie
     if (a->bike_prob < 0.0 || a->bike_prob > 1.0) { snprintf(err, err_sz, "bike-prob must be in [0..1]"); return -1; } // prawdopodobienstwo 0..1
+    if (a->board_batch < 0 || a->board_batch > MAX_K) { snprintf(err, err_sz, "board-batch must be in [0..%d]", MAX_K); return -1; } // 0 = wylaczone
+    if (a->patience_ms < 0 || a->patience_trips < 0) { snprintf(err, err_sz, "patience must be >= 0 (0 = unlimited)"); return -1; }
+    if (a->evict_timeout_ms <= 0) { snprintf(err, err_sz, "evict-timeout must be > 0 (ms)"); return -1; }   // termin ewakuacji dodatni
     if (!a->log_path[0]) { snprintf(err, err_sz, "log path empty"); return -1; }                   // sciezka niepusta
     return 0;                                                // walidacja OK
 }
 
+void cli_fill_state(const cli_args_t* a, shm_state_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->F = a->fleet.F;
+    out->K = a->K;
+    out->G = a->gangways;
+    out->T1_ms = a->T1_ms;
+    out->T2_ms = a->T2_ms;
+    out->R = a->R;
+    out->P = a->P;
+    out->evict_timeout_ms = a->evict_timeout_ms;
+    out->depart_policy = a->depart_policy;
+    out->depart_idle_ms = a->depart_idle_ms;
+    out->board_batch = a->board_batch;
+    out->admission = a->admission;
+    out->patience_ms = a->patience_ms;
+    out->patience_trips = a->patience_trips;
+
+    for (int i = 0; i < out->F; i++) {
+        ship_state_t* sh = &out->ships[i];
+        int32_t dir;
+        cli_fleet_ship(a, i, &sh->N, &sh->M, &sh->offset_ms, &dir);
+        sh->start_dir = (dir_t)dir;
+        sh->direction = sh->start_dir;
+        sh->phase = PHASE_LOADING;                            // zaladunek otwiera kapitan (po offset_ms)
+        sh->boarding_open = 0;
+        for (int g = 0; g < MAX_G; g++) sh->bridge[g].dir = BRIDGE_DIR_NONE;   // puste trapy, liczniki/trip_no = 0
+    }
+}
+
 int cli_parse_child_common(int argc, char** argv, cli_args_t* out) {
     if (!out) return -1;                                      // brak wyjscia -> blad
     init_defaults(out);                                       // ustaw domyslne wartosci
-    // wymagane: --shm --sem-prefix --msqid --log
+    // wymagane: --shm (lub --shm-fd) --msqid (poza backendem futex) --log; opcjonalne: --shm-fd --log-fd
     for (int i = 1; i < argc; i++) {                                // przejdz po argumentach i zbierz wspolne parametry IPC
         const char* k = argv[i];
         if (streq(k, "--shm") && need_arg(i, argc)) {             // nazwa SHM
             snprintf(out->shm_name, sizeof(out->shm_name), "%s", argv[++i]);
         }
-        else if (streq(k, "--sem-prefix") && need_arg(i, argc)) { // prefiks semaforow
-            snprintf(out->sem_prefix, sizeof(out->sem_prefix), "%s", argv[++i]);
+        else if (streq(k, "--shm-fd") && need_arg(i, argc)) {     // dziedziczony deskryptor SHM
+            if (parse_i32(argv[++i], &out->shm_fd) != 0 || out->shm_fd < 0) return -1;
+        }
+        else if (streq(k, "--log-fd") && need_arg(i, argc)) {     // dziedziczony deskryptor logu
+            if (parse_i32(argv[++i], &out->log_fd) != 0 || out->log_fd < 0) return -1;
+        }
+        else if (streq(k, "--results-fd") && need_arg(i, argc)) { // dziedziczony deskryptor pliku wynikow
+            if (parse_i32(argv[++i], &out->results_fd) != 0 || out->results_fd < 0) return -1;
         }
         else if (streq(k, "--msqid") && need_arg(i, argc)) {      // id kolejki msq
             if (parse_i32(argv[++i], (int32_t*)&out->msqid) != 0) return -1; // parsuj do int32 i zapisz do msqid (rzutowanie wskaznika)
@@ -126,12 +381,16 @@ int cli_parse_child_common(int argc, char** argv, cli_args_t* out) {
         else if (streq(k, "--log") && need_arg(i, argc)) {        // sciezka loga
             snprintf(out->log_path, sizeof(out->log_path), "%s", argv[++i]);
         }
+        else if (streq(k, "--ship") && need_arg(i, argc)) {       // kapitan: indeks statku floty
+            if (parse_i32(argv[++i], &out->ship) != 0 || out->ship < 0 || out->ship >= MAX_F) return -1;
+        }
         else if (streq(k, "--help")) {                           // help obsluz y parser roli
             return 1;
         }
         else { /* ignore unknown here; handled by role parser */ } // nieznane opcje zostana sprawdzone w parserze konkretnej roli
     }
-    if (!out->shm_name[0] || !out->sem_prefix[0] || out->msqid < 0) return -1; // brak wymaganych IPC -> blad
+    if (!out->shm_name[0] && out->shm_fd < 0) return -1;                     // brak wymaganych IPC -> blad
+    if (SYNC_MBOX_MSGQ && out->msqid < 0) return -1;                          // kolejka tylko dla skrzynki SysV
     return 0;                                                                 // wspolne argumenty poprawne
 }
 
@@ -180,6 +439,11 @@ int cli_parse_passenger(int argc, char** argv, cli_args_t* out) {
             if (parse_i32(argv[++i], &b) != 0) return -1;
             out->bike_flag = b;
         }
+        else if (streq(k, "--id") && need_arg(i, argc)) {         // indeks slotu w SHM
+            int32_t id;
+            if (parse_i32(argv[++i], &id) != 0) return -1;
+            out->passenger_id = id;
+        }
     }
 
     // --dir: dozwolone {0,1} albo -1 (losowo/nieustawione)
@@ -187,6 +451,11 @@ int cli_parse_passenger(int argc, char** argv, cli_args_t* out) {
         fprintf(stderr, "Invalid --dir: %d (allowed: 0, 1)\n", (int)out->desired_dir);
         return -1;
     }
+    // --id: wymagany (zakres sprawdzany wzgledem P po podpieciu SHM)
+    if (out->passenger_id < 0) {
+        fprintf(stderr, "Missing or invalid --id\n");
+        return -1;
+    }
     // --bike: dozwolone {0,1} albo -1 (losowo/nieustawione)
     if (!(out->bike_flag == -1 || out->bike_flag == 0 || out->bike_flag == 1)) {
         fprintf(stderr, "Invalid --bike: %d (allowed: 0, 1)\n", (int)out->bike_flag);
@@ -195,3 +464,28 @@ int cli_parse_passenger(int argc, char** argv, cli_args_t* out) {
 
     return 0;
 }
+
+int cli_parse_checker(int argc, char** argv, cli_args_t* out) {
+    if (!out) return -1;
+    int r = cli_parse_child_common(argc, argv, out);          // wspolne IPC (shm/msqid/log)
+    if (r != 0) return r;
+    out->check_hz = CHECK_DEFAULT_HZ;
+    for (int i = 1; i < argc; i++) {                          // opcje kontrolera
+        const char* k = argv[i];
+        if (streq(k, "--hz") && need_arg(i, argc)) {             // probki na sekunde
+            if (parse_i32(argv[++i], &out->check_hz) != 0) return -1;
+        }
+        else if (streq(k, "--cpu-pct") && need_arg(i, argc)) {   // budzet CPU (% czasu sciennego)
+            if (parse_i32(argv[++i], &out->check_cpu_pct) != 0) return -1;
+        }
+    }
+    if (out->check_hz < 1 || out->check_hz > CHECK_MAX_HZ) {
+        fprintf(stderr, "Invalid --hz: %d (allowed: 1..%d)\n", (int)out->check_hz, CHECK_MAX_HZ);
+        return -1;
+    }
+    if (out->check_cpu_pct < 1 || out->check_cpu_pct > 100) {
+        fprintf(stderr, "Invalid --cpu-pct: %d (allowed: 1..100)\n", (int)out->check_cpu_pct);
+        return -1;
+    }
+    return 0;
+}
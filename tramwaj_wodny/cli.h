@@ -1,6 +1,8 @@
 #ifndef CLI_H
 #define CLI_H
 
+#include "common.h"
+
 #include <stdint.h>
 #include <sys/types.h>
 
@@ -8,6 +10,32 @@
 extern "C" {
 #endif
 
+    // Kontroler niezmiennikow (checker): domyslna czestotliwosc, budzet CPU i gorna granica --hz
+    enum { CHECK_DEFAULT_HZ = 50, CHECK_DEFAULT_CPU_PCT = 2, CHECK_MAX_HZ = 1000 };
+
+    // Automatyczny odplyw sterowany przez dyspozytora (dispatcher --policy, launcher --dispatch-policy)
+    typedef enum {
+        DISPATCH_NONE = 0,     // tylko komendy z klawiatury / gniazda
+        DISPATCH_FILL = 1,     // onboard >= fill_pct% N
+        DISPATCH_QUEUE = 2     // na drugim brzegu czeka >= queue_n pasazerow
+        // oba: ktos jest na pokladzie i mostek bez wejsc od idle_ms
+    } dispatch_policy_t;
+
+    typedef struct {
+        int32_t kind;          // dispatch_policy_t
+        int32_t fill_pct;
+        int32_t idle_ms;
+        int32_t queue_n;
+    } dispatch_policy_cfg_t;
+
+    // Flota (--fleet): liczba statkow F (kopie --N/--M, rozklad rozlozony rownomiernie)
+    // albo jawna lista pojemnosci "N:M[:offset_ms],..." (caps = 1)
+    typedef struct {
+        int32_t F;
+        int32_t caps;
+        int32_t N[MAX_F], M[MAX_F], offset_ms[MAX_F];
+    } cli_fleet_t;
+
     typedef struct {
         // parametry symulacji
         int32_t N, M, K;
@@ -15,35 +43,85 @@ extern "C" {
         int32_t R;
         int32_t P;
         double bike_prob;
+        int32_t evict_timeout_ms;   // termin na ACK ewakuacji z mostka
+        int32_t depart_policy;      // depart_policy_t (--depart-policy)
+        int32_t depart_idle_ms;     // dla idle:<ms>
+        int32_t board_batch;        // --board-batch B (0 = pasazerowie wchodza sami)
+        int32_t admission;          // admission_t (--admission race|planner)
+        int32_t patience_ms;        // --patience <ms>: rezygnacja z czekania na ladzie (0 = bez limitu)
+        int32_t patience_trips;     // --patience-trips <n>: rezygnacja po n odplywach bez niego (0 = bez limitu)
+        cli_fleet_t fleet;          // --fleet <F>|<N:M[:offset_ms],...> (domyslnie jeden statek)
+        int32_t gangways;           // --gangways <G>: trapy na statek, kazdy po K jednostek (domyslnie 1)
+
+        // obciazenie (workload.h)
+        uint64_t seed;              // --seed (ziarno PRNG kierunku/roweru)
+        int32_t has_seed;
+        char workload_path[256];    // --workload <file>: ziarno albo jawna lista pasazerow
+        char record_workload_path[256]; // --record-workload <file>: zapis uzytej listy
+
+        // sterowanie dyspozytorem (control.h)
+        char control_path[128];     // --control <sock>: gniazdo komend dyspozytora
+        char control_script[256];   // --control-script <file>: komendy z pliku
+        char dispatch_policy[64];   // --dispatch-policy <spec>: przekazywane do dyspozytora
 
         // IPC
         char shm_name[128];
-        char sem_prefix[128];
+        int32_t shm_fd;         // dziedziczony deskryptor SHM (-1 = shm_open po nazwie)
         int32_t msqid;
 
         // log
         char log_path[256];
+        int32_t log_fd;         // dziedziczony deskryptor logu (-1 = open po sciezce)
+
+        // wyniki kolumnowe (results.h)
+        char results_path[256]; // launcher: --results <path> (pusty = wylaczone)
+        int32_t results_fd;     // dzieci: --results-fd <fd> (-1 = wylaczone)
 
         // role-specific
         pid_t captain_pid;      // tylko dispatcher
         int32_t desired_dir;    // tylko passenger (0/1), -1 random
         int32_t bike_flag;      // tylko passenger: -1 losuj, 0 bez, 1 z rowerem
+        int32_t passenger_id;   // tylko passenger: indeks slotu w SHM (0..P-1)
         int32_t interactive;    // dispatcher
+        int32_t ship;           // tylko captain: --ship <i> (indeks statku floty, domyslnie 0)
+        int32_t check_hz;       // launcher --checker <hz>[:<cpu_pct>] / checker --hz (0 = bez kontrolera)
+        int32_t check_cpu_pct;  // budzet CPU kontrolera w % czasu sciennego
     } cli_args_t;
 
     // Parser uzywany przez rozne binarki.
     // W zaleznosci od programu wymagane jest podanie roznych pol.
     int cli_parse_launcher(int argc, char** argv, cli_args_t* out);
-    int cli_parse_child_common(int argc, char** argv, cli_args_t* out); // shm/sem/msq/log
+    int cli_parse_child_common(int argc, char** argv, cli_args_t* out); // shm/msq/log (+ dziedziczone fd, --ship)
     int cli_parse_dispatcher(int argc, char** argv, cli_args_t* out);   // + captain_pid
     int cli_parse_passenger(int argc, char** argv, cli_args_t* out);    // + dir/bike
+    int cli_parse_checker(int argc, char** argv, cli_args_t* out);      // + hz/cpu-pct
 
     int cli_validate_launcher(const cli_args_t* a, char* err, int err_sz);
 
+    // Stan poczatkowy SHM z argumentow launchera (konfiguracja floty, LOADING, puste trapy)
+    void cli_fill_state(const cli_args_t* a, shm_state_t* out);
+
+    // "<F>" | "N:M[:offset_ms],..." -> cli_fleet_t; 0 ok, -1 blad
+    int cli_parse_fleet(const char* s, cli_fleet_t* out);
+    // Statek i floty: pojemnosc, przesuniecie rozkladu i kierunek startowy (kopie --N/--M, gdy bez listy)
+    void cli_fleet_ship(const cli_args_t* a, int i, int32_t* N, int32_t* M, int32_t* offset_ms, int32_t* start_dir);
+
+    // "fixed" | "full" | "idle:<ms>" | "adaptive" -> depart_policy_t (+ idle_ms); 0 ok, -1 blad
+    int cli_parse_depart_policy(const char* s, int32_t* policy, int32_t* idle_ms);
+    const char* cli_depart_policy_str(int32_t policy);
+
+    // "fill:<pct>[:<idle_ms>]" | "queue:<n>[:<idle_ms>]" -> dispatch_policy_cfg_t; 0 ok, -1 blad
+    int cli_parse_dispatch_policy(const char* s, dispatch_policy_cfg_t* out);
+    const char* cli_dispatch_policy_str(int32_t kind);
+
+    // "<hz>[:<cpu_pct>]" -> czestotliwosc probkowania i budzet CPU kontrolera; 0 ok, -1 blad
+    int cli_parse_checker_spec(const char* s, int32_t* hz, int32_t* cpu_pct);
+
     void cli_print_usage_tramwaj(void);
     void cli_print_usage_dispatcher(void);
     void cli_print_usage_captain(void);
     void cli_print_usage_passenger(void);
+    void cli_print_usage_checker(void);
 
 #ifdef __cplusplus
 }
@@ -4,6 +4,8 @@
 // Wspolne definicje dla wszystkich procesow (launcher/dispatcher/captain/passenger).
 // Uwaga: struktury musza byc POD (Plain Old Data), bo sa mapowane przez SHM.
 
+#include "sync_backend.h"
+
 #include <stdint.h>
 #include <sys/types.h>
 
@@ -13,9 +15,16 @@ extern "C" {
 
     // ======= Limity kompilacyjne =======
     // MAX_K / MAX_P to "bezpieczniki" na rozmiar SHM i liczbe procesow.
+    // Sam rozmiar SHM liczony jest w ipc_create z faktycznych K i P (shm_layout_t).
     enum { MAX_K = 1512 };
     enum { MAX_P = 10000 };
-    enum { BRIDGE_Q_CAP = 1024 }; // >= MAX_K (z zapasem)
+    enum { MAX_F = 8 };                  // statki floty (--fleet)
+    enum { MAX_G = 4 };                  // trapy (mostki) na statek (--gangways)
+    enum { EVENT_RING_MIN = 1024, EVENT_RING_MAX = 1 << 16 };
+
+    // ======= Wersjonowany uklad SHM =======
+    enum { SHM_MAGIC = 0x4d535754 };     // "TWSM"
+    enum { SHM_LAYOUT_VERSION = 18 };
 
     // ======= Stany i kierunki =======
     typedef enum {
@@ -31,6 +40,25 @@ extern "C" {
         DIR_TYNIEC_TO_KRAKOW = 1
     } dir_t;
 
+    // Polityka odplywu (kiedy kapitan konczy LOADING)
+    typedef enum {
+        DEPART_FIXED = 0,      // po T1 (albo SIGUSR1)
+        DEPART_FULL = 1,       // gdy statek pelny, najpozniej po T1
+        DEPART_IDLE = 2,       // gdy nikt nie wszedl od depart_idle_ms, najpozniej po T1
+        DEPART_ADAPTIVE = 3    // wg obserwowanego tempa wejsc vs sredniej przepustowosci rejsu (do 2*T1)
+    } depart_policy_t;
+
+    // Przydzial miejsc w LOADING
+    typedef enum {
+        ADMIT_RACE = 0,        // kazdy pasazer sam probuje sem_trywait (seats/bikes/bridge)
+        ADMIT_PLANNER = 1      // kapitan wybiera z puli oczekujacych i wydaje bilety (SLOT_ADMITTED)
+    } admission_t;
+
+    enum { SLOT_DIR_ANY = 0xFF };
+
+    // Planer: rowerzysta pominiety przez tyle rejsow ma pierwszenstwo (ochrona przed zaglodzeniem)
+    enum { ADMIT_FAIR_TRIPS = 2 };
+
     typedef enum {
         BRIDGE_DIR_NONE = 0,
         BRIDGE_DIR_IN = 1,   // lad -> statek
@@ -46,47 +74,215 @@ extern "C" {
 
     typedef struct {
         pid_t pid;
+        int32_t slot;       // indeks w tablicy slotow pasazerow (-1 brak)
         uint8_t units;      // 1 albo 2 (rower)
         uint8_t evicting;   // 1 jesli kapitan nakazal zejscie
     } bridge_node_t;
 
+    // ======= Tablica slotow pasazerow =======
+    // Slot o indeksie = id pasazera (--id). Pozycja na mostku (ring_idx) jest stala
+    // dopoki wezel jest w ring buforze, wiec "czy jestem z przodu/z tylu" to O(1).
+    // wake to slowo futex: kto zdejmuje sasiada z mostka, budzi dokladnie nastepnego.
+    // held_* / onboard to ksiega zasobow pasazera: jedyne zrodlo prawdy przy zwalnianiu,
+    // takze gdy proces zginal (odzyskiwanie przez launcher albo po EOWNERDEAD).
+    // Zasada: zajecie semafora -> wpis; wymazanie wpisu -> zwolnienie (nigdy odwrotnie),
+    // wiec ksiega moze najwyzej zanizyc, a nie zawyzyc trzymane zasoby.
+    typedef enum {
+        SLOT_FREE = 0,
+        SLOT_WAITING = 1,     // czeka na ladzie
+        SLOT_ON_BRIDGE = 2,   // na mostku (ring_idx wazny)
+        SLOT_ONBOARD = 3,
+        SLOT_EVICTING = 4,    // kapitan nakazal zejscie (ring_idx wazny)
+        SLOT_LEFT = 5,        // zakonczyl udzial
+        SLOT_ADMITTED = 6,    // bilet od planera kapitana (--admission planner): moze rezerwowac
+        SLOT_GAVE_UP = 7      // kapitan: skonczyla sie cierpliwosc (--patience*), pasazer odchodzi z ladu
+    } slot_state_t;
+
+    typedef struct {
+        pid_t pid;
+        int32_t state;        // slot_state_t
+        int32_t ring_idx;     // indeks w ring buforze mostka albo -1
+        uint32_t wake;        // licznik budzen (futex)
+        uint8_t dir;          // kierunek pasazera albo SLOT_DIR_ANY
+        uint8_t bike;
+        uint8_t held_seat;    // trzyma 1 z sem_seats
+        uint8_t held_bike;    // trzyma 1 z sem_bikes
+        uint8_t held_units;   // jednostki sem_bridge (0/1/2)
+        uint8_t onboard;      // wliczony do onboard_passengers/onboard_bikes
+        uint8_t ship;         // statek, ktorego dotycza held_* / onboard / ring_idx
+        uint8_t gw;           // trap statku, ktorego dotycza held_units / ring_idx
+        int32_t arrival;      // kolejnosc rejestracji (FIFO dla planera)
+        int32_t skipped;      // ile rejsow rowerzysta czekal pominiety przez planer
+        sync_mbox_slot_t mbox;  // polecenie kapitana dla tego slotu (backend futex)
+    } passenger_slot_t;
+
     typedef struct {
         bridge_dir_t dir;     // jednokierunkowosc
         int32_t load_units;   // zajete jednostki (pomocniczo)
         int32_t count;        // ilu fizycznie na mostku (wpisow)
         int32_t head;         // indeks head w ring buffer
         int32_t tail;         // indeks tail w ring buffer (pierwszy wolny)
-        bridge_node_t q[BRIDGE_Q_CAP];
+        int32_t mask;         // pojemnosc ring buffera - 1 (pojemnosc = potega 2 >= K)
+        // wezly ring buffera leza za shm_state_t (offset w shm_layout_t)
     } bridge_state_t;
 
+    // ======= Szyna zdarzen (events.h) =======
+    // Ring stalej wielkosci: kazdy wpis ma jednego autora (numer zdarzenia z fetch_add na head),
+    // czytelnicy maja wlasne kursory i nie biora mutexu stanu. stamp = numer + 1 po publikacji.
     typedef struct {
-        // Konfiguracja (ustawiana przez launcher)
-        int32_t N, M, K;
+        uint64_t stamp;       // 0 w trakcie zapisu, seq + 1 gdy opublikowany
+        int64_t t_ns;         // now_ns_monotonic() autora
+        pid_t pid;            // autor
+        int32_t type;         // event_type_t
+        int32_t trip;         // trip_no w chwili publikacji
+        int32_t slot;         // slot pasazera albo -1
+        int32_t a, b;         // argumenty zalezne od typu (events.h)
+        int32_t ship;         // statek floty albo -1 (zdarzenie przystani)
+        int32_t pad;
+    } event_t;
+
+    typedef struct {
+        uint64_t head;        // nastepny numer zdarzenia (fetch_add przez autora)
+        uint32_t wake;        // licznik budzen czytelnikow (futex)
+        uint32_t waiters;     // ilu czytelnikow spi na wake (autor budzi tylko gdy > 0)
+    } event_bus_t;
+
+    // ======= Skrzynka komend dyspozytor -> kapitan (control.h) =======
+    // Kolejka SPSC: kazda komenda ma wlasny wpis i potwierdzenie (nie zlewa sie jak SIGUSR1).
+    enum { CTL_BOX_CAP = 64 };
+
+    typedef struct {
+        uint32_t status;      // ctl_status_t (zapisywany ostatni, release)
+        int32_t cmd;          // ctl_cmd_t
+        uint32_t seq;         // numer komendy (od 1)
+        int32_t trip;         // rejs, w ktorym kapitan wykonal komende
+        int32_t for_trip;     // dotyczy tylko tego rejsu (-1 = najblizszy mozliwy)
+        int32_t result;       // ctl_result_t (wazne po potwierdzeniu)
+        int64_t t_sent_us;    // now_us_monotonic() wyslania
+        int64_t t_ack_us;     // now_us_monotonic() wykonania przez kapitana
+    } ctl_slot_t;
+
+    typedef struct {
+        uint32_t head;        // dyspozytor: numer nastepnej komendy
+        uint32_t tail;        // kapitan: numer nastepnej do wykonania
+        uint32_t ack_wake;    // licznik potwierdzen (futex)
+        uint32_t pad;
+        ctl_slot_t q[CTL_BOX_CAP];
+    } ctl_box_t;
+
+    // Naglowek SHM: dzieci odczytuja z niego rozmiar i offsety sekcji
+    // (mapowanie ma rozmiar zalezny od K/P, a nie od stalych kompilacyjnych).
+    typedef struct {
+        uint32_t magic;           // SHM_MAGIC
+        uint32_t version;         // SHM_LAYOUT_VERSION
+        uint64_t total_size;      // rozmiar calego mapowania (bajty)
+        uint32_t header_size;     // sizeof(shm_state_t) u tworcy
+        uint32_t bridge_q_off;    // offset tablic bridge_node_t (bridge_ships * bridge_gws trapow, jedna za druga)
+        uint32_t bridge_q_cap;    // liczba wezlow na trap (potega 2)
+        uint32_t bridge_ships;    // pojemnosc floty (F) - statki z ringami trapow
+        uint32_t bridge_gws;      // pojemnosc trapow na statek (G)
+        uint32_t slots_off;       // offset tablicy passenger_slot_t
+        uint32_t slots_cap;       // liczba slotow (P)
+        uint32_t events_off;      // offset ringu event_t
+        uint32_t events_cap;      // liczba wpisow ringu (potega 2)
+    } shm_layout_t;
+
+    // Statystyki mutexu stanu; zapisywane przez wlasciciela pod mutexem (bez atomikow)
+    typedef struct {
+        uint64_t acquisitions;   // wszystkie wejscia do sekcji krytycznej
+        uint64_t contended;      // pierwsza proba nieudana (zamek zajety)
+        uint64_t spins;          // obroty petli pause przed uspieniem (futex_lock_*)
+        uint64_t parks;          // uspienia: FUTEX_WAIT albo blokujacy lock backendu (pthread/semop)
+        uint64_t wait_ns;        // laczny czas oczekiwania przy kontencji
+    } lock_stats_t;
+
+    // Obiekty synchronizacji osadzone w SHM; typy zalezne od backendu (sync_backend.h).
+    // Muteksy przezywaja smierc wlasciciela (nie zakleszczaja), liczniki sa osobne dla kazdego statku.
+    // Mutex stanu to state albo (TRAMWAJ_SPIN_LOCK) slowo state_word - oba pola zawsze w ukladzie.
+    typedef struct {
+        sync_domain_t domain;    // obiekty backendu poza SHM (sysv: zbior semaforow)
+        sync_mutex_t state;      // mutex do SHM
+        sync_mutex_t log;        // mutex do logu
+        sync_waitq_t waitq;      // czekanie na slowach SHM (sync_wait / sync_notify)
+        uint32_t state_word;     // TRAMWAJ_SPIN_LOCK: 0 wolny, PID wlasciciela (+ bit oczekujacych)
+        uint32_t pad;
+        lock_stats_t state_stats;
+    } shm_sync_t;
+
+    typedef struct {
+        sync_count_t seats;   // N statku
+        sync_count_t bikes;   // M statku
+        sync_count_t bridge[MAX_G];  // K (units) na kazdy trap
+    } ship_sync_t;
+
+    // ======= Statek floty =======
+    // Kazdy statek ma wlasnego kapitana (--ship), maszyne faz, pojemnosc N/M, G trapow i skrzynke
+    // komend. Wspolne sa przystanie (sloty czekajacych), mutex stanu, phase_seq i szyna zdarzen.
+    typedef struct {
+        // Konfiguracja (launcher)
+        int32_t N, M;
+        int32_t offset_ms;            // pierwszy zaladunek po tylu ms od startu kapitana
+        dir_t start_dir;              // przystan poczatkowa
+
+        // Stan (pod mutexem stanu)
+        phase_t phase;
+        dir_t direction;
+        int32_t boarding_open;        // 1 w LOADING, 0 w DEPARTING/...
+        int32_t trip_no;              // numer aktualnego rejsu statku (1..)
+        int32_t onboard_passengers;
+        int32_t onboard_bikes;
+        uint32_t captain_wake;        // licznik budzen kapitana (futex): nowy wezel na mostku
+        pid_t captain_pid;
+
+        bridge_state_t bridge[MAX_G]; // trapy (uzywane pierwsze G); wezly: ring (ship * bridge_gws + gw)
+        ship_sync_t sync;
+        ctl_box_t control;            // komendy dyspozytora dla tego kapitana
+        sync_mbox_ship_t mbox;        // ACK-i ewakuacji dla kapitana (backend futex)
+    } ship_state_t;
+
+    typedef struct {
+        // Uklad pamieci (musi byc pierwszy)
+        shm_layout_t layout;
+
+        // Semafory
+        shm_sync_t sync;
+
+        // Konfiguracja (ustawiana przez launcher); N/M per statek w ships[]
+        int32_t F;                    // liczba statkow (1..MAX_F)
+        int32_t K;                    // jednostki na jeden trap
+        int32_t G;                    // trapy na statek (1..MAX_G)
         int32_t T1_ms, T2_ms;
         int32_t R;
         int32_t P;
+        int32_t evict_timeout_ms;     // termin na ACK ewakuacji (captain_clear_bridge)
+        int32_t depart_policy;        // depart_policy_t
+        int32_t depart_idle_ms;       // parametr DEPART_IDLE
+        int32_t board_batch;          // >0: kapitan wpuszcza do B osob z frontu mostka naraz (0 = kazdy sam)
+        int32_t admission;            // admission_t
+        int32_t patience_ms;          // rezygnacja po tylu ms czekania na ladzie (0 = bez limitu)
+        int32_t patience_trips;       // rezygnacja po tylu odplywach bez niego (0 = bez limitu)
 
         // Stan globalny
-        phase_t phase;
-        dir_t direction;
-        int32_t boarding_open;        // 1 w LOADING, 0 w DEPARTING/...
-        int32_t trip_no;              // numer aktualnego rejsu (1..)
+        uint32_t phase_seq;           // licznik zmian fazy/kierunku dowolnego statku (futex)
         int32_t shutdown;             // ustawiane przez launcher przy SIGINT/SIGTERM
 
-        // Liczniki (aktualizowane przez pasazerow/kapitana pod mutexem)
-        int32_t onboard_passengers;
-        int32_t onboard_bikes;
+        int32_t arrival_seq;          // licznik rejestracji pasazerow (passenger_slot_t.arrival)
 
-        // Mostek
-        bridge_state_t bridge;
+        // Szyna zdarzen (ring za slotami pasazerow)
+        event_bus_t events;
 
-        // PID kapitana (dla wygody/debug)
-        pid_t captain_pid;
+        // Flota (uzywane pierwsze F)
+        ship_state_t ships[MAX_F];
+
+        // Odpornosc na smierc procesow
+        pid_t state_owner;            // wlasciciel mutexu stanu (state_lock; 0 po state_unlock)
+        int32_t lock_recoveries;      // ile razy mutex stanu przejety po smierci wlasciciela
+        int32_t reclaimed_slots;      // ile slotow martwych pasazerow odzyskano z ksiegi
     } shm_state_t;
 
-    // ======= Komunikaty (SysV msgqueue) =======
-    // Kapitan -> pasazer: mtype = PID pasazera
-    // Pasazer -> kapitan: mtype = 1
+    // ======= Komunikaty kapitan <-> pasazer (mbox_* w ipc.h) =======
+    // Kolejka SysV: kapitan -> pasazer mtype = PID pasazera, pasazer -> kapitan mtype wg statku;
+    // backend futex przenosi te same pola przez skrzynki w SHM
 
     typedef enum {
         CMD_EVICT = 1
@@ -99,7 +295,7 @@ extern "C" {
     } msg_cmd_t;
 
     typedef struct {
-        long mtype;          // 1
+        long mtype;          // ustawia mbox_send_ack
         pid_t pid;
         int32_t trip_no;
     } msg_ack_t;
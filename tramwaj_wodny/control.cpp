@@ -0,0 +1,74 @@
+#include "control.h"
+#include "events.h"
+#include "ipc.h"
+#include "util.h"
+
+int ctl_post(shm_state_t* s, int32_t ship, ctl_cmd_t cmd, int32_t for_trip, uint32_t* seq) {
+    ctl_box_t* b = &s->ships[ship].control;
+    const uint32_t n = b->head;   // jedyny pisarz head
+    ctl_slot_t* e = &b->q[n % CTL_BOX_CAP];
+    if (__atomic_load_n(&e->status, __ATOMIC_ACQUIRE) != CTL_FREE) return -1;
+    e->cmd = (int32_t)cmd;
+    e->seq = n + 1;
+    e->trip = -1;
+    e->for_trip = for_trip;
+    e->result = CTL_DONE;
+    e->t_sent_us = now_us_monotonic();
+    e->t_ack_us = -1;
+    __atomic_store_n(&e->status, CTL_SENT, __ATOMIC_RELEASE);
+    __atomic_store_n(&b->head, n + 1, __ATOMIC_RELEASE);
+    if (seq) *seq = n + 1;
+    // kapitan w LOADING spi na captain_wake - komenda ma zadzialac od razu, nie po ticku
+    captain_notify(s, ship);
+    return 0;
+}
+
+int ctl_take_ack(shm_state_t* s, int32_t ship, uint32_t seq, ctl_slot_t* out) {
+    ctl_slot_t* e = &s->ships[ship].control.q[(seq - 1) % CTL_BOX_CAP];
+    if (e->seq != seq || __atomic_load_n(&e->status, __ATOMIC_ACQUIRE) != CTL_ACKED) return 0;
+    if (out) *out = *e;
+    __atomic_store_n(&e->status, CTL_FREE, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int ctl_peek(shm_state_t* s, int32_t ship, ctl_slot_t* out) {
+    return ctl_peek_nth(s, ship, 0, out);
+}
+
+int ctl_peek_nth(shm_state_t* s, int32_t ship, uint32_t n, ctl_slot_t* out) {
+    ctl_box_t* b = &s->ships[ship].control;
+    const uint32_t t = b->tail + n;   // jedyny pisarz tail
+    if (__atomic_load_n(&b->head, __ATOMIC_ACQUIRE) - b->tail <= n) return 0;
+    ctl_slot_t* e = &b->q[t % CTL_BOX_CAP];
+    if (__atomic_load_n(&e->status, __ATOMIC_ACQUIRE) != CTL_SENT) return 0;
+    if (out) *out = *e;
+    return 1;
+}
+
+void ctl_ack(shm_state_t* s, int32_t ship, int32_t trip, int32_t result) {
+    ctl_box_t* b = &s->ships[ship].control;
+    const uint32_t t = b->tail;
+    ctl_slot_t* e = &b->q[t % CTL_BOX_CAP];
+    e->trip = trip;
+    e->result = result;
+    e->t_ack_us = now_us_monotonic();
+    const int32_t cmd = e->cmd;
+    const uint32_t seq = e->seq;
+    __atomic_store_n(&e->status, CTL_ACKED, __ATOMIC_RELEASE);
+    __atomic_store_n(&b->tail, t + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&b->ack_wake, 1, __ATOMIC_RELEASE);
+    shm_word_wake(s, &b->ack_wake, 1, SYNC_BITS_ALL);
+    ev_publish(s, ship, EV_COMMAND, -1, cmd, (int32_t)seq);
+}
+
+const char* ctl_result_str(int result) {
+    return result == CTL_STALE ? "stale" : "done";
+}
+
+const char* ctl_cmd_str(int cmd) {
+    switch (cmd) {
+    case CTL_DEPART: return "depart";
+    case CTL_STOP: return "stop";
+    default: return "?";
+    }
+}
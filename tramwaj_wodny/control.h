@@ -0,0 +1,55 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+// Komendy dyspozytor -> kapitan przez skrzynke w SHM (ctl_box_t w common.h) zamiast SIGUSR1/SIGUSR2.
+// Kazda komenda zajmuje osobny wpis, wiec dwie szybkie komendy "depart" to dwa wczesne odplywy
+// (kolejne LOADING), a nie jeden. Kapitan potwierdza wykonanie (numer rejsu + czas), a dyspozytor
+// liczy opoznienie od wyslania do efektu. Jeden pisarz (dyspozytor) i jeden wykonawca (kapitan);
+// kazdy statek floty ma wlasna skrzynke (ship_state_t.control).
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    typedef enum {
+        CTL_NONE = 0,
+        CTL_DEPART = 1,       // wczesny odplyw: konczy najblizsze (albo biezace) LOADING
+        CTL_STOP = 2          // koniec po biezacym rejsie (w LOADING: rejs odwolany)
+    } ctl_cmd_t;
+
+    typedef enum {
+        CTL_FREE = 0,
+        CTL_SENT = 1,
+        CTL_ACKED = 2
+    } ctl_status_t;
+
+    typedef enum {
+        CTL_DONE = 0,         // wykonana
+        CTL_STALE = 1         // odrzucona: rejs for_trip juz odplynal
+    } ctl_result_t;
+
+    // Dyspozytor: wyslanie; numer w *seq. for_trip >= 0 wiaze DEPART z konkretnym rejsem
+    // (decyzja polityki nie moze przejsc na nastepny zaladunek). 0 ok, -1 skrzynka pelna
+    int ctl_post(shm_state_t* s, int32_t ship, ctl_cmd_t cmd, int32_t for_trip, uint32_t* seq);
+
+    // Dyspozytor: 1 = komenda seq potwierdzona (kopia wpisu w *out, wpis zwolniony), 0 = jeszcze nie
+    int ctl_take_ack(shm_state_t* s, int32_t ship, uint32_t seq, ctl_slot_t* out);
+
+    // Kapitan: najstarsza niewykonana komenda (bez zdejmowania); 1 = jest, 0 = pusto
+    int ctl_peek(shm_state_t* s, int32_t ship, ctl_slot_t* out);
+    // Kapitan: n-ta (od 0) niewykonana komenda, np. STOP za odlozonym DEPART; 1 = jest, 0 = brak
+    int ctl_peek_nth(shm_state_t* s, int32_t ship, uint32_t n, ctl_slot_t* out);
+
+    // Kapitan: zdejmuje najstarsza komende i potwierdza ja (rejs trip, czas teraz, ctl_result_t)
+    void ctl_ack(shm_state_t* s, int32_t ship, int32_t trip, int32_t result);
+
+    const char* ctl_cmd_str(int cmd);
+    const char* ctl_result_str(int result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONTROL_H
@@ -1,14 +1,21 @@
+#include "cli.h"
 #include "common.h"
+#include "control.h"
+#include "events.h"
 #include "ipc.h"
 #include "logging.h"
 #include "util.h"
 
 #include <cstdlib>
 #include <errno.h>
+#include <poll.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 static volatile sig_atomic_t g_exit = 0;      // flaga zakonczenia ustawiana w handlerze sygnalu (typ bezpieczny dla sygnalow)
@@ -29,7 +36,17 @@ static void install_handlers(void) {
 static void usage(void) {
     fprintf(stderr,                             // wypisz na stderr instrukcje uruchomienia
         "Usage (preferred / IPC):\n"
-        "  dispatcher --shm <name> --sem-prefix <prefix> --msqid <id> --log <path>\n"
+        "  dispatcher --shm <name> --msqid <id> --log <path> [--shm-fd <fd>] [--log-fd <fd>]\n"
+        "\n"
+        "  [--control <sock>] [--script <file>] [--policy fill:<pct>[:<idle_ms>]|queue:<n>[:<idle_ms>]]\n"
+        "  --control <sock>  gniazdo UNIX z komendami \"[<t_ms>] depart|stop [<ship>]|state\" (potwierdzane;\n"
+        "                    depart bez statku = statek w LOADING, stop bez statku = cala flota)\n"
+        "  --script <file>   te same komendy z pliku, t_ms od startu dyspozytora\n"
+        "  --policy <spec>   automatyczny odplyw: fill:<pct>[:<idle_ms>] (poklad >= pct%% N) albo\n"
+        "                    queue:<n>[:<idle_ms>] (>= n czeka na drugim brzegu); idle_ms = mostek bez ruchu\n"
+        "\n"
+        "Usage (client):\n"
+        "  dispatcher --control-send <sock>   (komendy ze stdin, odpowiedzi na stdout)\n"
         "\n"
         "Usage (legacy):\n"
         "  dispatcher --captain-pid <pid> --log <path>\n"
@@ -37,40 +54,597 @@ static void usage(void) {
     );
 }
 
-static int sem_wait_nointr(sem_t* s) {
-    while (sem_wait(s) != 0) {
-        if (errno == EINTR) return -1;         // jesli przerwane sygnalem, ponow
-        die_perror("sem_wait");               // inne bledy -> zakoncz
+// PID-y kapitanow floty zapisane w SHM przez launcher; zwraca liczbe statkow (0 = blad)
+static int read_captain_pids_from_shm(ipc_handles_t* ipc, pid_t* out) {
+    if (state_lock(ipc) != 0) return 0;
+    const int F = ipc->shm->F;
+    for (int i = 0; i < F; i++) out[i] = ipc->shm->ships[i].captain_pid;
+    state_unlock(ipc);                        // wyjdz z sekcji krytycznej
+    return F;
+}
+
+static int should_exit_from_shm(ipc_handles_t* ipc) {
+    if (state_lock(ipc) != 0) return 1;
+    int shutdown = ipc->shm->shutdown;        // sprawdz flage globalnego shutdown
+    int end_phase = fleet_ended(ipc->shm);    // wszystkie statki w fazie koncowej
+    state_unlock(ipc);                        // odblokuj
+    return (shutdown || end_phase);           // wyjdz jesli ktorykolwiek warunek spelniony
+}
+
+// Podsumowanie subskrypcji szyny zdarzen: liczba zdarzen per typ + zgubione
+static void log_event_summary(logger_t* lg, const ev_cursor_t* cur, const int64_t* counts) {
+    char buf[512];
+    int off = 0;
+    int64_t seen = 0;
+    for (int t = 1; t < EV_TYPE_COUNT; t++) {
+        seen += counts[t];
+        int w = snprintf(buf + off, sizeof(buf) - (size_t)off, " %s=%lld", ev_type_str(t), (long long)counts[t]);
+        if (w < 0 || (size_t)(off + w) >= sizeof(buf)) break;
+        off += w;
+    }
+    buf[off] = '\0';
+    logf(lg, "dispatcher", "EVENTS seen=%lld lost=%llu%s", (long long)seen, (unsigned long long)cur->lost, buf);
+}
+
+// ======= Sterowanie przez gniazdo / skrypt (control.h) =======
+// Linia: "[<t_ms>] depart|stop [<ship>]|state" ('#' = komentarz), t_ms od polaczenia klienta
+// (dla --script od startu dyspozytora). depart/stop ida przez skrzynke statku w SHM i dostaja
+// "ack ..." dopiero po wykonaniu przez jego kapitana; state odpowiada od razu migawka floty.
+// depart bez numeru trafia do statku, ktory w chwili wyslania laduje; stop bez numeru - do kazdego.
+enum { CTL_MAX_CLIENTS = 8, CTL_MAX_PENDING = 256, CTL_LINE_MAX = 256 };
+enum { CTL_STATE = 100 };     // komenda lokalna (nie idzie do kapitana)
+
+typedef struct {
+    int fd;                   // -1 = wolny
+    int eof;                  // klient skonczyl pisac: zamykamy po ostatniej odpowiedzi
+    int64_t t0_ms;            // poczatek osi czasu klienta
+    int len;
+    char buf[CTL_LINE_MAX];
+} ctl_client_t;
+
+typedef struct {
+    int64_t due_ms;           // termin wyslania (now_ms_monotonic)
+    int client;               // indeks klienta albo -1 (--script)
+    int cmd;                  // ctl_cmd_t albo CTL_STATE
+    int ship;                 // statek docelowy; -1 = wybierany przy wysylce (depart)
+    uint32_t seq;             // 0 = czeka na termin, >0 = w skrzynce, czeka na ack
+} ctl_pending_t;
+
+typedef struct {
+    int listen_fd;            // -1 = bez gniazda
+    const char* path;
+    int F;                    // statki floty (zakres numeru w komendzie)
+    ctl_client_t cl[CTL_MAX_CLIENTS];
+    ctl_pending_t pend[CTL_MAX_PENDING];   // posortowane po due_ms (stabilnie)
+    int npend;
+    int64_t sent, acked;
+    int64_t lat_sum_us, lat_max_us;
+} ctl_server_t;
+
+static const char* phase_name(int ph) {
+    switch (ph) {
+    case PHASE_LOADING: return "LOADING";
+    case PHASE_DEPARTING: return "DEPARTING";
+    case PHASE_SAILING: return "SAILING";
+    case PHASE_UNLOADING: return "UNLOADING";
+    case PHASE_END: return "END";
+    default: return "?";
+    }
+}
+
+static int ctl_listen(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) { perror("socket"); return -1; }
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", path);
+    (void)unlink(path);   // gniazdo po poprzednim przebiegu
+    if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || listen(fd, CTL_MAX_CLIENTS) != 0) {
+        perror("bind/listen(control)");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void ctl_reply(ctl_server_t* c, int client, const char* fmt, ...) {
+    if (client < 0 || c->cl[client].fd < 0) return;
+    char line[CTL_LINE_MAX];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (n > (int)sizeof(line) - 2) n = (int)sizeof(line) - 2;
+    line[n++] = '\n';
+    // klient, ktory zniknal, nie zatrzymuje symulacji (MSG_NOSIGNAL zamiast SIGPIPE)
+    (void)send(c->cl[client].fd, line, (size_t)n, MSG_NOSIGNAL);
+}
+
+// 1 = komenda, 0 = pusta linia / komentarz, -1 = blad skladni
+static int ctl_parse_line(const char* line, int64_t* t_ms, int* cmd, int* ship) {
+    while (*line == ' ' || *line == '\t') line++;
+    if (*line == '#' || *line == '\0' || *line == '\n' || *line == '\r') return 0;
+    char word[16];
+    long long t = 0;
+    int sh = -1;
+    if (sscanf(line, "%lld %15s %d", &t, word, &sh) < 2) {
+        t = 0;
+        sh = -1;
+        if (sscanf(line, "%15s %d", word, &sh) < 1) return -1;
+    }
+    if (t < 0 || sh < -1) return -1;
+    *ship = sh;
+    if (strcmp(word, "depart") == 0) *cmd = CTL_DEPART;
+    else if (strcmp(word, "stop") == 0) *cmd = CTL_STOP;
+    else if (strcmp(word, "state") == 0) *cmd = CTL_STATE;
+    else return -1;
+    *t_ms = (int64_t)t;
+    return 1;
+}
+
+static void ctl_queue(ctl_server_t* c, logger_t* lg, int client, int64_t t0_ms, const char* line) {
+    int64_t t = 0;
+    int cmd = 0, ship = -1;
+    int pr = ctl_parse_line(line, &t, &cmd, &ship);
+    if (pr == 0) return;
+    if (pr > 0 && ship >= c->F) pr = -1;
+    // stop dla calej floty = osobna komenda (i osobne ack) dla kazdego statku
+    const int copies = (cmd == CTL_STOP && ship < 0) ? c->F : 1;
+    if (pr < 0 || c->npend + copies > CTL_MAX_PENDING) {
+        ctl_reply(c, client, "error %s", pr < 0 ? "bad command" : "too many pending commands");
+        if (client < 0) logf(lg, "dispatcher", "CONTROL script: %s", pr < 0 ? "bad line" : "too many commands");
+        return;
+    }
+    for (int k = 0; k < copies; k++) {
+        ctl_pending_t e;
+        e.due_ms = t0_ms + t;
+        e.client = client;
+        e.cmd = cmd;
+        e.ship = copies > 1 ? k : ship;
+        e.seq = 0;
+        int at = c->npend;
+        while (at > 0 && c->pend[at - 1].due_ms > e.due_ms) at--;   // rowne terminy: kolejnosc wejscia
+        memmove(&c->pend[at + 1], &c->pend[at], (size_t)(c->npend - at) * sizeof(e));
+        c->pend[at] = e;
+        c->npend++;
+    }
+}
+
+static void ctl_remove(ctl_server_t* c, int i) {
+    memmove(&c->pend[i], &c->pend[i + 1], (size_t)(c->npend - i - 1) * sizeof(c->pend[0]));
+    c->npend--;
+}
+
+// Migawka floty pod jednym mutexem, odpowiedz po jego zwolnieniu: linia na statek.
+// Komenda z --script nie ma klienta - migawka idzie wtedy do logu (CONTROL state ...)
+static void ctl_reply_state(ctl_server_t* c, ipc_handles_t* ipc, logger_t* lg, int client) {
+    if (state_lock(ipc) != 0) {
+        ctl_reply(c, client, "error state lock");
+        if (client < 0) logf(lg, "dispatcher", "CONTROL script: state lock failed");
+        return;
+    }
+    shm_state_t* s = ipc->shm;
+    const int F = s->F, K = s->K * s->G;   // jednostki wszystkich trapow statku
+    ship_state_t snap[MAX_F];
+    int32_t on_bridge[MAX_F];
+    for (int i = 0; i < F; i++) {
+        snap[i] = s->ships[i];
+        on_bridge[i] = ship_bridge_count(s, i);
+    }
+    state_unlock(ipc);
+    for (int i = 0; i < F; i++) {
+        const ship_state_t* sh = &snap[i];
+        char line[CTL_LINE_MAX];
+        snprintf(line, sizeof(line), "state ship=%d phase=%s trip=%d dir=%d onboard=%d/%d bikes=%d/%d bridge=%d/%d",
+            i, phase_name(sh->phase), sh->trip_no, (int)sh->direction, sh->onboard_passengers, sh->N,
+            sh->onboard_bikes, sh->M, (int)on_bridge[i], K);
+        if (client < 0) logf(lg, "dispatcher", "CONTROL %s", line);
+        else ctl_reply(c, client, "%s", line);
+    }
+}
+
+// depart bez numeru: statek, ktory teraz laduje (najnizszy indeks), inaczej 0
+static int ctl_pick_ship(ipc_handles_t* ipc) {
+    if (state_lock(ipc) != 0) return 0;
+    const int ship = fleet_loading_ship(ipc->shm, -1);
+    state_unlock(ipc);
+    return ship >= 0 ? ship : 0;
+}
+
+// Wysyla komendy, ktorym minal termin, i odbiera potwierdzenia
+static void ctl_pump(ctl_server_t* c, ipc_handles_t* ipc, logger_t* lg) {
+    const int64_t now = now_ms_monotonic();
+    int box_full = 0;
+    for (int i = 0; i < c->npend;) {
+        ctl_pending_t* e = &c->pend[i];
+        if (e->seq == 0) {
+            if (e->due_ms > now || box_full) { i++; continue; }
+            if (e->cmd == CTL_STATE) {
+                ctl_reply_state(c, ipc, lg, e->client);
+                ctl_remove(c, i);
+                continue;
+            }
+            const int ship = e->ship >= 0 ? e->ship : ctl_pick_ship(ipc);
+            // pelna skrzynka: pozniejsze komendy nie moga wyprzedzic tej
+            if (ctl_post(ipc->shm, ship, (ctl_cmd_t)e->cmd, -1, &e->seq) != 0) { box_full = 1; i++; continue; }
+            e->ship = ship;
+            c->sent++;
+            logf(lg, "dispatcher", "CONTROL sent %s ship=%d seq=%u", ctl_cmd_str(e->cmd), ship, e->seq);
+            ctl_reply(c, e->client, "sent %s ship=%d seq=%u", ctl_cmd_str(e->cmd), ship, e->seq);
+        }
+        ctl_slot_t done;
+        if (!ctl_take_ack(ipc->shm, e->ship, e->seq, &done)) { i++; continue; }
+        const int64_t lat = done.t_ack_us - done.t_sent_us;
+        c->acked++;
+        c->lat_sum_us += lat;
+        if (lat > c->lat_max_us) c->lat_max_us = lat;
+        logf(lg, "dispatcher", "CONTROL ack %s ship=%d seq=%u trip=%d result=%s latency_us=%lld",
+            ctl_cmd_str(done.cmd), e->ship, done.seq, done.trip, ctl_result_str(done.result), (long long)lat);
+        ctl_reply(c, e->client, "ack %s ship=%d seq=%u trip=%d result=%s latency_us=%lld",
+            ctl_cmd_str(done.cmd), e->ship, done.seq, done.trip, ctl_result_str(done.result), (long long)lat);
+        ctl_remove(c, i);
+    }
+
+    // klient po EOF: zamknij, gdy dostal wszystkie odpowiedzi
+    for (int k = 0; k < CTL_MAX_CLIENTS; k++) {
+        if (c->cl[k].fd < 0 || !c->cl[k].eof) continue;
+        int busy = 0;
+        for (int i = 0; i < c->npend && !busy; i++) busy = (c->pend[i].client == k);
+        if (busy) continue;
+        close(c->cl[k].fd);
+        c->cl[k].fd = -1;
+    }
+}
+
+// Timeout select: do najblizszego terminu, krotko gdy czekamy na ack (max 50ms jak dla stdin)
+static int ctl_timeout_ms(const ctl_server_t* c) {
+    int64_t t = 50;
+    const int64_t now = now_ms_monotonic();
+    for (int i = 0; i < c->npend; i++) {
+        const int64_t d = c->pend[i].seq ? 2 : c->pend[i].due_ms - now;
+        if (d < t) t = d;
+    }
+    return t < 0 ? 0 : (int)t;
+}
+
+static void ctl_fdset(const ctl_server_t* c, fd_set* rfds, int* maxfd) {
+    if (c->listen_fd >= 0) {
+        FD_SET(c->listen_fd, rfds);
+        if (c->listen_fd > *maxfd) *maxfd = c->listen_fd;
+    }
+    for (int k = 0; k < CTL_MAX_CLIENTS; k++) {
+        if (c->cl[k].fd < 0 || c->cl[k].eof) continue;
+        FD_SET(c->cl[k].fd, rfds);
+        if (c->cl[k].fd > *maxfd) *maxfd = c->cl[k].fd;
+    }
+}
+
+static void ctl_handle_io(ctl_server_t* c, logger_t* lg, fd_set* rfds) {
+    if (c->listen_fd >= 0 && FD_ISSET(c->listen_fd, rfds)) {
+        int fd = accept4(c->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        int k = 0;
+        while (fd >= 0 && k < CTL_MAX_CLIENTS && c->cl[k].fd >= 0) k++;
+        if (fd >= 0 && k == CTL_MAX_CLIENTS) {
+            (void)send(fd, "error too many clients\n", 23, MSG_NOSIGNAL);
+            close(fd);
+        }
+        else if (fd >= 0) {
+            memset(&c->cl[k], 0, sizeof(c->cl[k]));
+            c->cl[k].fd = fd;
+            c->cl[k].t0_ms = now_ms_monotonic();
+            logf(lg, "dispatcher", "CONTROL client %d connected", k);
+        }
+    }
+    for (int k = 0; k < CTL_MAX_CLIENTS; k++) {
+        ctl_client_t* cl = &c->cl[k];
+        if (cl->fd < 0 || cl->eof || !FD_ISSET(cl->fd, rfds)) continue;
+        ssize_t n = read(cl->fd, cl->buf + cl->len, sizeof(cl->buf) - 1 - (size_t)cl->len);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            cl->eof = 1;   // niedokonczona ostatnia linia tez sie liczy
+            if (cl->len > 0) { cl->buf[cl->len] = '\0'; ctl_queue(c, lg, k, cl->t0_ms, cl->buf); cl->len = 0; }
+            continue;
+        }
+        cl->len += (int)n;
+        cl->buf[cl->len] = '\0';
+        char* line = cl->buf;
+        char* nl;
+        while ((nl = strchr(line, '\n')) != NULL) {
+            *nl = '\0';
+            ctl_queue(c, lg, k, cl->t0_ms, line);
+            line = nl + 1;
+        }
+        cl->len = (int)strlen(line);
+        memmove(cl->buf, line, (size_t)cl->len + 1);
+        if (cl->len == (int)sizeof(cl->buf) - 1) {   // linia dluzsza niz bufor
+            ctl_reply(c, k, "error line too long");
+            cl->len = 0;
+        }
+    }
+}
+
+static int ctl_load_script(ctl_server_t* c, logger_t* lg, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) { perror("fopen(script)"); return -1; }
+    const int64_t t0 = now_ms_monotonic();
+    char line[CTL_LINE_MAX];
+    while (fgets(line, sizeof(line), f)) ctl_queue(c, lg, -1, t0, line);
+    fclose(f);
+    logf(lg, "dispatcher", "CONTROL script %s: %d commands", path, c->npend);
+    return 0;
+}
+
+// Koniec symulacji: ostatnie potwierdzenia, reszta bez ack, podsumowanie opoznien
+static void ctl_finish(ctl_server_t* c, ipc_handles_t* ipc, logger_t* lg) {
+    ctl_pump(c, ipc, lg);
+    for (int i = 0; i < c->npend; i++) {
+        ctl_reply(c, c->pend[i].client, "error %s not executed (simulation ended)",
+            c->pend[i].cmd == CTL_STATE ? "state" : ctl_cmd_str(c->pend[i].cmd));
+    }
+    for (int k = 0; k < CTL_MAX_CLIENTS; k++) {
+        if (c->cl[k].fd >= 0) close(c->cl[k].fd);
+        c->cl[k].fd = -1;
+    }
+    if (c->listen_fd >= 0) {
+        close(c->listen_fd);
+        (void)unlink(c->path);
+    }
+    if (c->listen_fd >= 0 || c->sent > 0 || c->npend > 0) {
+        logf(lg, "dispatcher", "CONTROL sent=%lld acked=%lld unacked=%d lat_mean_us=%lld lat_max_us=%lld",
+            (long long)c->sent, (long long)c->acked, c->npend,
+            (long long)(c->acked ? c->lat_sum_us / c->acked : 0), (long long)c->lat_max_us);
+    }
+}
+
+// ======= Polityka automatycznego odplywu (--policy) =======
+// Model stanu budowany wylacznie z szyny zdarzen (bez mutexu stanu): faza, rejs, kierunek,
+// zajetosc pokladu (EV_BOARD niesie onboard), ostatni ruch na mostku i kolejki czekajacych
+// na obu brzegach (EV_PASSENGER_START .. EV_BOARD / EV_PASSENGER_EXIT). Decyzja to DEPART
+// w skrzynce z for_trip = biezacy rejs: spozniona nie przechodzi na nastepny zaladunek.
+enum { SLOT_NOT_WAITING = -2 };
+
+// Podmodel jednego statku floty (zdarzenia rozdzielane po ev.ship)
+typedef struct {
+    int32_t N;                 // konfiguracja ze SHM (stala po starcie)
+    int32_t phase, trip, dir, onboard;
+    int64_t t_trip_start, t_depart, t_last_bridge;
+
+    // decyzje
+    int32_t decided_trip;      // rejs, dla ktorego wyslano DEPART (-1 = brak)
+    uint32_t seq;              // niepotwierdzony DEPART (0 = brak)
+    int32_t early_trip;        // rejs, w ktorym kapitan wykonal DEPART polityki
+} dpol_ship_t;
+
+typedef struct {
+    dispatch_policy_cfg_t cfg;
+
+    // model z szyny zdarzen: kolejki na przystaniach wspolne dla floty, reszta per statek
+    int8_t* slot_dir;          // kierunek czekajacego pasazera (-1 dowolny) albo SLOT_NOT_WAITING
+    int32_t slots;
+    int32_t waiting[2];        // czekajacy z jawnym kierunkiem 0/1
+    int32_t waiting_any;
+    int32_t F;
+    dpol_ship_t sh[MAX_F];
+
+    // skutki: rejsy skrocone przez polityke vs zakonczone przez T1 / polityke kapitana
+    int32_t trips[2];
+    int64_t load_ms_sum[2], pax_sum[2];
+    int32_t stale;
+    int64_t t_first, t_last;
+} dpolicy_t;
+
+static int dpol_init(dpolicy_t* p, ipc_handles_t* ipc, const dispatch_policy_cfg_t* cfg) {
+    memset(p, 0, sizeof(*p));
+    p->cfg = *cfg;
+    p->F = ipc->shm->F;
+    for (int i = 0; i < p->F; i++) {
+        dpol_ship_t* sh = &p->sh[i];
+        sh->N = ipc->shm->ships[i].N;
+        sh->phase = -1;
+        sh->decided_trip = -1;
+        sh->early_trip = -1;
     }
+    p->slots = (int32_t)ipc->shm->layout.slots_cap;
+    p->slot_dir = (int8_t*)malloc((size_t)(p->slots > 0 ? p->slots : 1));
+    if (!p->slot_dir) { perror("malloc(policy)"); return -1; }
+    memset(p->slot_dir, SLOT_NOT_WAITING, (size_t)(p->slots > 0 ? p->slots : 1));
+    p->t_first = -1;
     return 0;
 }
-static void sem_post_chk(sem_t* s) {
-    if (sem_post(s) != 0) die_perror("sem_post"); // zwolnij semafor; blad -> zakoncz
+
+static void dpol_unwait(dpolicy_t* p, int32_t slot) {
+    if (slot < 0 || slot >= p->slots || p->slot_dir[slot] == SLOT_NOT_WAITING) return;
+    const int d = p->slot_dir[slot];
+    if (d == 0 || d == 1) p->waiting[d]--;
+    else p->waiting_any--;
+    p->slot_dir[slot] = SLOT_NOT_WAITING;
+}
+
+static void dpol_on_event(dpolicy_t* p, logger_t* lg, const event_t* ev) {
+    const int64_t t_ms = ev->t_ns / 1000000;   // ta sama skala co now_ms_monotonic()
+    dpol_ship_t* sh = (ev->ship >= 0 && ev->ship < p->F) ? &p->sh[ev->ship] : NULL;
+    switch (ev->type) {
+    case EV_PHASE:
+        if (!sh) break;
+        sh->phase = ev->a;
+        // kapitan otwiera wejscie przed podbiciem trip_no i EV_TRIP_START: tu zaczyna sie zaladunek
+        if (ev->a == PHASE_LOADING) {
+            sh->trip = ev->trip + 1;
+            sh->dir = -1;
+            sh->onboard = 0;
+            sh->t_trip_start = sh->t_last_bridge = t_ms;
+            if (p->t_first < 0) p->t_first = t_ms;
+        }
+        break;
+    case EV_TRIP_START:
+        if (!sh) break;
+        sh->trip = ev->trip;
+        sh->dir = ev->a;
+        break;
+    case EV_PASSENGER_START:
+        if (ev->slot < 0 || ev->slot >= p->slots || p->slot_dir[ev->slot] != SLOT_NOT_WAITING) break;
+        p->slot_dir[ev->slot] = (int8_t)(ev->a == 0 || ev->a == 1 ? ev->a : -1);
+        if (ev->a == 0 || ev->a == 1) p->waiting[ev->a]++;
+        else p->waiting_any++;
+        break;
+    case EV_BRIDGE_ENTER:
+        if (sh && ev->a == BRIDGE_DIR_IN) sh->t_last_bridge = t_ms;
+        break;
+    case EV_BOARD:
+        if (sh) {
+            sh->onboard = ev->a;
+            sh->t_last_bridge = t_ms;
+        }
+        dpol_unwait(p, ev->slot);
+        break;
+    case EV_GAVE_UP:                // koniec cierpliwosci (kapitan)
+    case EV_PASSENGER_EXIT:
+        dpol_unwait(p, ev->slot);   // zrezygnowal / koniec symulacji bez wejscia
+        break;
+    case EV_DEPART:
+        if (sh) sh->t_depart = t_ms;
+        break;
+    case EV_TRIP_END: {
+        if (!sh || ev->trip != sh->trip) break;
+        const int early = (sh->early_trip == sh->trip);
+        const int64_t load_ms = sh->t_depart - sh->t_trip_start;
+        p->trips[early]++;
+        p->load_ms_sum[early] += load_ms;
+        p->pax_sum[early] += ev->a;
+        p->t_last = t_ms;
+        logf(lg, "dispatcher", "POLICY ship=%d trip=%d dir=%d pax=%d load_ms=%lld trip_ms=%lld by=%s left_waiting=%d",
+            ev->ship, sh->trip, sh->dir, ev->a, (long long)load_ms, (long long)(t_ms - sh->t_trip_start),
+            early ? "policy" : "captain", p->waiting[sh->dir & 1] + p->waiting_any);
+        break;
+    }
+    default:
+        break;
+    }
 }
 
-static pid_t read_captain_pid_from_shm(ipc_handles_t* ipc) {
-    if (sem_wait_nointr(ipc->sem_state) != 0) return 0;
-    pid_t p = ipc->shm->captain_pid;          // odczytaj PID kapitana zapisany w pamieci wspoldzielonej
-    sem_post_chk(ipc->sem_state);             // wyjdz z sekcji krytycznej
-    return p;                                 // zwroc PID
+// 1 = warunek polityki spelniony w biezacym LOADING statku; *wait_ms = ile do spelnienia warunku czasu
+static int dpol_ready(const dpolicy_t* p, const dpol_ship_t* sh, int64_t now, int64_t* wait_ms) {
+    *wait_ms = -1;
+    if (sh->phase != PHASE_LOADING || sh->trip <= 0 || sh->decided_trip == sh->trip || sh->onboard <= 0) return 0;
+    if (p->cfg.kind == DISPATCH_FILL && (int64_t)sh->onboard * 100 < (int64_t)p->cfg.fill_pct * sh->N) return 0;
+    if (p->cfg.kind == DISPATCH_QUEUE && (sh->dir < 0 || p->waiting[1 - sh->dir] < p->cfg.queue_n)) return 0;
+    const int64_t left = sh->t_last_bridge + p->cfg.idle_ms - now;   // wspolny warunek: przerwa w wejsciach
+    if (left > 0) { *wait_ms = left; return 0; }
+    return 1;
 }
 
-static int should_exit_from_shm(ipc_handles_t* ipc) {
-    if (sem_wait_nointr(ipc->sem_state) != 0) return 1;
-    int shutdown = ipc->shm->shutdown;        // sprawdz flage globalnego shutdown
-    int end_phase = (ipc->shm->phase == PHASE_END); // sprawdz czy kapitan jest w fazie koncowej
-    sem_post_chk(ipc->sem_state);             // odblokuj
-    return (shutdown || end_phase);           // wyjdz jesli ktorykolwiek warunek spelniony
+// Decyzja + odbior potwierdzenia dla kazdego statku; zwraca sugerowany timeout petli (ms)
+static int dpol_tick(dpolicy_t* p, ipc_handles_t* ipc, logger_t* lg) {
+    int tmo = 200;
+    const int64_t now = now_ms_monotonic();
+    for (int i = 0; i < p->F; i++) {
+        dpol_ship_t* sh = &p->sh[i];
+        if (sh->seq != 0) {
+            ctl_slot_t done;
+            if (!ctl_take_ack(ipc->shm, i, sh->seq, &done)) { tmo = 2; continue; }
+            if (done.result == CTL_DONE) sh->early_trip = done.trip;
+            else p->stale++;
+            logf(lg, "dispatcher", "POLICY ack ship=%d seq=%u trip=%d result=%s latency_us=%lld",
+                i, done.seq, done.trip, ctl_result_str(done.result), (long long)(done.t_ack_us - done.t_sent_us));
+            sh->seq = 0;
+        }
+
+        int64_t wait_ms;
+        if (!dpol_ready(p, sh, now, &wait_ms)) {
+            if (wait_ms >= 0 && wait_ms < tmo) tmo = (int)wait_ms;
+            continue;
+        }
+
+        tmo = 2;
+        if (ctl_post(ipc->shm, i, CTL_DEPART, sh->trip, &sh->seq) != 0) continue;   // pelna skrzynka: sprobuj za chwile
+        sh->decided_trip = sh->trip;
+        logf(lg, "dispatcher", "POLICY depart ship=%d trip=%d seq=%u reason=%s onboard=%d/%d bridge_idle_ms=%lld "
+            "waiting_here=%d waiting_there=%d loading_ms=%lld",
+            i, sh->trip, sh->seq, cli_dispatch_policy_str(p->cfg.kind), sh->onboard, sh->N,
+            (long long)(now - sh->t_last_bridge), p->waiting[sh->dir & 1] + p->waiting_any,
+            p->waiting[1 - (sh->dir & 1)], (long long)(now - sh->t_trip_start));
+    }
+    return tmo;
+}
+
+static void dpol_finish(dpolicy_t* p, logger_t* lg) {
+    const int64_t span = p->t_last - p->t_first;
+    const int64_t pax = p->pax_sum[0] + p->pax_sum[1];
+    logf(lg, "dispatcher", "POLICY summary kind=%s trips_policy=%d trips_captain=%d stale=%d "
+        "load_ms_mean policy=%.1f captain=%.1f pax_mean policy=%.1f captain=%.1f pax_per_s=%.2f",
+        cli_dispatch_policy_str(p->cfg.kind), p->trips[1], p->trips[0], p->stale,
+        p->trips[1] ? (double)p->load_ms_sum[1] / p->trips[1] : 0.0,
+        p->trips[0] ? (double)p->load_ms_sum[0] / p->trips[0] : 0.0,
+        p->trips[1] ? (double)p->pax_sum[1] / p->trips[1] : 0.0,
+        p->trips[0] ? (double)p->pax_sum[0] / p->trips[0] : 0.0,
+        span > 0 ? (double)pax * 1000.0 / (double)span : 0.0);
+    free(p->slot_dir);
+    p->slot_dir = NULL;
+}
+
+// Klient --control-send: stdin -> gniazdo, odpowiedzi -> stdout, az serwer zamknie polaczenie
+static int control_send_main(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) { perror("socket"); return 1; }
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", path);
+    if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) { perror("connect"); close(fd); return 1; }
+
+    int in_open = 1;
+    char buf[CTL_LINE_MAX];
+    while (!g_exit) {
+        struct pollfd p[2];
+        p[0].fd = fd;
+        p[0].events = POLLIN;
+        p[1].fd = in_open ? STDIN_FILENO : -1;
+        p[1].events = POLLIN;
+        p[0].revents = p[1].revents = 0;
+        if (poll(p, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        if (p[1].revents) {
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n <= 0) {
+                in_open = 0;
+                (void)shutdown(fd, SHUT_WR);   // serwer odpowie na reszte i zamknie
+            }
+            else if (send(fd, buf, (size_t)n, MSG_NOSIGNAL) != n) {
+                perror("send");
+                break;
+            }
+        }
+        if (p[0].revents) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0) break;
+            fwrite(buf, 1, (size_t)n, stdout);
+            fflush(stdout);
+        }
+    }
+    close(fd);
+    return 0;
 }
 
 int main(int argc, char** argv) {
     install_handlers();                       // zainstaluj handlery SIGINT/SIGTERM
 
     const char* shm_name = NULL;              // nazwa SHM dla trybu IPC
-    const char* sem_prefix = NULL;            // prefiks semaforow dla trybu IPC
+    int shm_fd = -1;                          // dziedziczony deskryptor SHM (od launchera)
+    int log_fd = -1;                          // dziedziczony deskryptor logu (od launchera)
     const char* log_path = NULL;              // sciezka do pliku logow
     int msqid = -1;                           // id kolejki komunikatow System V
-    pid_t captain_pid = -1;                   // PID procesu kapitana (cel sygnalow)
+    pid_t captain_pid = -1;                   // PID procesu kapitana (cel sygnalow; z SHM: kapitanowie floty)
+    pid_t captains[MAX_F];
+    int n_captains = 0;
+    const char* control_path = NULL;          // gniazdo komend z potwierdzeniem
+    const char* script_path = NULL;           // skrypt komend z pliku
+    dispatch_policy_cfg_t policy;             // automatyczny odplyw (--policy)
+    memset(&policy, 0, sizeof(policy));
 
     for (int i = 1; i < argc; i++) {          // proste parsowanie argumentow CLI
         const char* a = argv[i];              // aktualny argument
@@ -87,14 +661,21 @@ int main(int argc, char** argv) {
         if (strcmp(a, "--shm") == 0) {
             shm_name = need_val("--shm");     // ustaw nazwe SHM
         }
-        else if (strcmp(a, "--sem-prefix") == 0) {
-            sem_prefix = need_val("--sem-prefix"); // ustaw prefiks semaforow
+        else if (strcmp(a, "--shm-fd") == 0 || strcmp(a, "--log-fd") == 0) {
+            const char* v = need_val(a);
+            int32_t tmp;
+            if (parse_i32(v, &tmp) != 0 || tmp < 0) {
+                fprintf(stderr, "Invalid value for %s: %s (must be >= 0)\n", a, v);
+                usage();
+                return 2;
+            }
+            if (strcmp(a, "--shm-fd") == 0) shm_fd = (int)tmp; else log_fd = (int)tmp;
         }
         else if (strcmp(a, "--msqid") == 0) {
             const char* v = need_val("--msqid");
             int32_t tmp;
-            if (parse_i32(v, &tmp) != 0 || tmp < 0) {
-                fprintf(stderr, "Invalid value for --msqid: %s (must be >= 0)\n", v);
+            if (parse_i32(v, &tmp) != 0 || tmp < -1) {
+                fprintf(stderr, "Invalid value for --msqid: %s (must be >= 0, -1 = no queue)\n", v);
                 usage();
                 return 2;
             }
@@ -113,6 +694,23 @@ int main(int argc, char** argv) {
             }
             captain_pid = (pid_t)tmp;
         }
+        else if (strcmp(a, "--control") == 0) {
+            control_path = need_val("--control");
+        }
+        else if (strcmp(a, "--script") == 0) {
+            script_path = need_val("--script");
+        }
+        else if (strcmp(a, "--policy") == 0) {
+            const char* v = need_val("--policy");
+            if (cli_parse_dispatch_policy(v, &policy) != 0) {
+                fprintf(stderr, "Invalid value for --policy: %s\n", v);
+                usage();
+                return 2;
+            }
+        }
+        else if (strcmp(a, "--control-send") == 0) {
+            return control_send_main(need_val("--control-send")); // tryb klienta: bez IPC i logu
+        }
         else if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) {
             usage();                          // pokaz pomoc
             return 0;                         // i zakoncz sukcesem
@@ -130,7 +728,13 @@ int main(int argc, char** argv) {
         return 2;
     }
 
-    const int have_ipc = (shm_name && sem_prefix && msqid >= 0); // tryb IPC aktywny gdy sa kompletne parametry
+    // tryb IPC aktywny gdy sa kompletne parametry (backend futex nie ma kolejki: --msqid -1)
+    const int have_ipc = ((shm_name || shm_fd >= 0) && (msqid >= 0 || !SYNC_MBOX_MSGQ));
+    if ((control_path || script_path || policy.kind != DISPATCH_NONE) && !have_ipc) { // skrzynka komend lezy w SHM
+        fprintf(stderr, "dispatcher: --control/--script/--policy need IPC args\n");
+        usage();
+        return 2;
+    }
 
     ipc_handles_t ipc;
     memset(&ipc, 0, sizeof(ipc));             // wyzeruj uchwyty IPC
@@ -141,20 +745,23 @@ int main(int argc, char** argv) {
     lg.fd = -1;                               // jawnie ustaw brak deskryptora
 
     if (have_ipc) {
-        if (ipc_open(&ipc, shm_name, sem_prefix, msqid) != 0) {  // podepnij sie do SHM/semaf./msq
+        if (ipc_open(&ipc, shm_name, shm_fd, msqid) != 0) {      // podepnij sie do SHM (semafory w SHM) i msq
             fprintf(stderr, "dispatcher: ipc_open failed\n");
             return 1;
         }
         ipc_opened = 1;                       // zaznacz aktywny IPC
 
-        if (logger_open(&lg, log_path, ipc.sem_log) != 0) {      // otworz log z synchronizacja przez sem_log
+        int lr = (log_fd >= 0) ? logger_attach(&lg, log_fd, ipc.mtx_log)  // dziedziczony fd logu
+            : logger_open(&lg, log_path, ipc.mtx_log);               // albo otworz log z synchronizacja przez mtx_log
+        if (lr != 0) {
             fprintf(stderr, "dispatcher: logger_open failed\n");
             ipc_close(&ipc);                  // posprzataj IPC przy bledzie
             return 1;
         }
 
         if (captain_pid < 0) {                // jesli PID nie podany na CLI
-            captain_pid = read_captain_pid_from_shm(&ipc); // sprobuj odczytac z SHM
+            n_captains = read_captain_pids_from_shm(&ipc, captains); // sprobuj odczytac z SHM
+            if (n_captains > 0) captain_pid = captains[0];
         }
     }
     else {
@@ -166,32 +773,93 @@ int main(int argc, char** argv) {
         if (ipc_opened) { logger_close(&lg); ipc_close(&ipc); }  // sprzatnij jesli cos otwarte
         return 2;
     }
+    if (n_captains == 0) {                    // --captain-pid: jeden kapitan
+        captains[0] = captain_pid;
+        n_captains = 1;
+    }
 
+    ev_cursor_t cur;                          // wlasny kursor w szynie zdarzen (bez mutexu stanu)
+    memset(&cur, 0, sizeof(cur));
+    int64_t ev_counts[EV_TYPE_COUNT] = { 0 };
     if (ipc_opened) {
-        logf(&lg, "dispatcher", "started captain_pid=%d", (int)captain_pid); // log startu z PID kapitana
+        ev_subscribe(ipc.shm, &cur, 1);   // od najstarszego wpisu: rejsy sprzed startu tez sie licza
+        logf(&lg, "dispatcher", "started captain_pid=%d ships=%d", (int)captain_pid, n_captains); // log startu z PID kapitana
     }
 
+    static ctl_server_t ctl;                  // static: kolejka komend ma kilka KB
+    ctl.listen_fd = -1;
+    ctl.path = control_path;
+    ctl.F = n_captains;
+    for (int k = 0; k < CTL_MAX_CLIENTS; k++) ctl.cl[k].fd = -1;
+    if (control_path) {
+        signal(SIGPIPE, SIG_IGN);
+        ctl.listen_fd = ctl_listen(control_path);
+        if (ctl.listen_fd >= 0) logf(&lg, "dispatcher", "CONTROL listening on %s", control_path);
+    }
+    if (script_path) (void)ctl_load_script(&ctl, &lg, script_path);
+
+    dpolicy_t pol;                            // model stanu z szyny + decyzje odplywu
+    memset(&pol, 0, sizeof(pol));
+    if (policy.kind != DISPATCH_NONE && dpol_init(&pol, &ipc, &policy) == 0) {
+        logf(&lg, "dispatcher", "POLICY %s fill_pct=%d idle_ms=%d queue_n=%d", cli_dispatch_policy_str(policy.kind),
+            policy.fill_pct, policy.idle_ms, policy.queue_n);
+    }
+    else policy.kind = DISPATCH_NONE;
+
     fprintf(stderr,                             // instrukcja sterowania z klawiatury
         "Dispatcher pid=%d. Commands:\n"
         "  1 + ENTER -> send SIGUSR1 (early depart)\n"
         "  2 + ENTER -> send SIGUSR2 (stop)\n",
         (int)getpid());
 
+    int stdin_open = 1;                       // 0 po EOF na stdin (np. uruchomienie z /dev/null)
+    uint32_t ended_mask = 0;                  // statki, ktore oglosily PHASE_END
     while (!g_exit) {                          // petla glowna dopoki nie dostaniemy SIGINT/SIGTERM
-        if (ipc_opened && should_exit_from_shm(&ipc)) { // jesli IPC: obserwuj END/shutdown zapisane w SHM
-            logf(&lg, "dispatcher", "observed END/shutdown in SHM -> exit");
-            break;                             // wyjdz z petli
+        if (ipc_opened) {                      // jesli IPC: koniec symulacji = EV_PHASE(PHASE_END) kazdego statku
+            const uint64_t lost_before = cur.lost;
+            int end = 0;
+            event_t ev;
+            while (ev_next(ipc.shm, &cur, &ev)) {
+                if (ev.type > EV_NONE && ev.type < EV_TYPE_COUNT) ev_counts[ev.type]++;
+                if (policy.kind != DISPATCH_NONE) dpol_on_event(&pol, &lg, &ev);
+                if (ev.type == EV_PHASE && ev.a == PHASE_END && ev.ship >= 0 && ev.ship < MAX_F) {
+                    ended_mask |= 1u << ev.ship;
+                    end = (ended_mask == (1u << n_captains) - 1);
+                }
+            }
+            // zgubione wpisy (nadpisany ring): END mogl przepasc - jednorazowo sprawdz stan w SHM
+            if (!end && cur.lost != lost_before) end = should_exit_from_shm(&ipc);
+            if (end) {
+                logf(&lg, "dispatcher", "observed END/shutdown -> exit");
+                break;                         // wyjdz z petli
+            }
+        }
+
+        if (ipc_opened) ctl_pump(&ctl, &ipc, &lg); // komendy z terminem + potwierdzenia kapitana
+        const int ctl_active = (ctl.listen_fd >= 0 || ctl.npend > 0);
+        const int pol_ms = (policy.kind != DISPATCH_NONE) ? dpol_tick(&pol, &ipc, &lg) : 200;
+
+        if (!stdin_open && !ctl_active) {      // bez klawiatury: sam subskrybent zdarzen, spimy na szynie
+            (void)ev_wait(ipc.shm, &cur, pol_ms);
+            continue;
         }
 
         fd_set rfds;
         FD_ZERO(&rfds);                        // wyczysc zestaw descriptorow do select
-        FD_SET(STDIN_FILENO, &rfds);           // obserwuj stdin (komendy uzytkownika)
+        int maxfd = -1;
+        if (stdin_open) {
+            FD_SET(STDIN_FILENO, &rfds);       // obserwuj stdin (komendy uzytkownika)
+            maxfd = STDIN_FILENO;
+        }
+        ctl_fdset(&ctl, &rfds, &maxfd);        // gniazdo sterujace i klienci
 
+        int tmo_ms = ctl_timeout_ms(&ctl);
+        if (pol_ms < tmo_ms) tmo_ms = pol_ms;
         struct timeval tv;
-        tv.tv_sec = 0;                         // timeout 0.2s, aby okresowo sprawdzac SHM/g_exit
-        tv.tv_usec = 200000;
+        tv.tv_sec = 0;                         // timeout <=50ms, aby okresowo czytac szyne zdarzen/g_exit
+        tv.tv_usec = tmo_ms * 1000;
 
-        int sel = select(STDIN_FILENO + 1, &rfds, NULL, NULL, &tv); // czekaj na wejscie lub timeout
+        int sel = select(maxfd + 1, &rfds, NULL, NULL, &tv); // czekaj na wejscie lub timeout
         if (sel < 0) {
             if (errno == EINTR) continue;      // przerwane sygnalem -> wroc do petli i sprawdz g_exit
             perror("select");                  // inny blad select
@@ -199,9 +867,16 @@ int main(int argc, char** argv) {
         }
         if (sel == 0) continue;                // timeout -> iteracja (sprawdzenie SHM na gorze petli)
 
+        ctl_handle_io(&ctl, &lg, &rfds);
+        if (!stdin_open || !FD_ISSET(STDIN_FILENO, &rfds)) continue;
+
         char buf[64];
         ssize_t n = read(STDIN_FILENO, buf, sizeof(buf)); // odczytaj wpisane znaki
-        if (n <= 0) break;                     // EOF lub blad -> koniec
+        if (n <= 0) {                          // EOF lub blad
+            if (!ipc_opened) break;            // legacy: nie ma czego obserwowac -> koniec
+            stdin_open = 0;                    // IPC: dalej czytamy szyne zdarzen az do END
+            continue;
+        }
 
         char cmd = 0;
         for (ssize_t i = 0; i < n; i++) {      // znajdz pierwsza nie-biala litere jako komende
@@ -210,27 +885,25 @@ int main(int argc, char** argv) {
             break;
         }
 
-        if (cmd == '1') {                      // komenda: wczesny odjazd
-            if (kill(captain_pid, SIGUSR1) != 0) { // wyslij SIGUSR1 do kapitana
-                perror("kill(SIGUSR1)");       // blad wyslania (np. brak procesu / uprawnien)
-                if (ipc_opened) logf(&lg, "dispatcher", "FAILED SIGUSR1 to captain=%d errno=%d", (int)captain_pid, errno); // log bledu
-            }
-            else {
-                if (ipc_opened) logf(&lg, "dispatcher", "sent SIGUSR1 to captain=%d", (int)captain_pid); // log sukcesu
-            }
-        }
-        else if (cmd == '2') {                 // komenda: stop
-            if (kill(captain_pid, SIGUSR2) != 0) { // wyslij SIGUSR2 do kapitana
-                perror("kill(SIGUSR2)");
-                if (ipc_opened) logf(&lg, "dispatcher", "FAILED SIGUSR2 to captain=%d errno=%d", (int)captain_pid, errno);
+        // sygnaly z klawiatury ida do calej floty: SIGUSR1 dziala tylko na statek w LOADING
+        for (int k = 0; k < n_captains && (cmd == '1' || cmd == '2'); k++) {
+            const int sig = (cmd == '1') ? SIGUSR1 : SIGUSR2; // wczesny odjazd / stop
+            const char* sname = (cmd == '1') ? "SIGUSR1" : "SIGUSR2";
+            if (captains[k] <= 1) continue;
+            if (kill(captains[k], sig) != 0) { // wyslij sygnal do kapitana
+                perror(cmd == '1' ? "kill(SIGUSR1)" : "kill(SIGUSR2)"); // blad wyslania (np. brak procesu / uprawnien)
+                if (ipc_opened) logf(&lg, "dispatcher", "FAILED %s to captain=%d errno=%d", sname, (int)captains[k], errno); // log bledu
             }
             else {
-                if (ipc_opened) logf(&lg, "dispatcher", "sent SIGUSR2 to captain=%d", (int)captain_pid);
+                if (ipc_opened) logf(&lg, "dispatcher", "sent %s to captain=%d", sname, (int)captains[k]); // log sukcesu
             }
         }
     }
 
     if (ipc_opened) {
+        ctl_finish(&ctl, &ipc, &lg);
+        if (policy.kind != DISPATCH_NONE) dpol_finish(&pol, &lg);
+        log_event_summary(&lg, &cur, ev_counts);
         logf(&lg, "dispatcher", "EXIT (g_exit=%d)", (int)g_exit); // koncowy wpis w logu z powodem (czy przerwano sygnalem)
         logger_close(&lg);                      // zamknij logger
         ipc_close(&ipc);                        // odlacz sie od IPC
@@ -0,0 +1,112 @@
+#include "events.h"
+#include "ipc.h"
+#include "util.h"
+
+#include <unistd.h>
+
+static event_t* ev_ring(shm_state_t* s) {
+    return (event_t*)((char*)s + s->layout.events_off);
+}
+
+void ev_publish(shm_state_t* s, int32_t ship, event_type_t type, int32_t slot, int32_t a, int32_t b) {
+    event_bus_t* bus = &s->events;
+    const uint64_t seq = __atomic_fetch_add(&bus->head, 1, __ATOMIC_SEQ_CST);
+    event_t* e = &ev_ring(s)[seq & (s->layout.events_cap - 1)];
+
+    // seqlock wpisu: stamp=0 widoczny przed danymi, stamp=seq+1 dopiero po nich
+    __atomic_store_n(&e->stamp, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->t_ns = now_ns_monotonic();
+    e->pid = getpid();
+    e->type = (int32_t)type;
+    e->trip = (ship >= 0 && ship < MAX_F) ? __atomic_load_n(&s->ships[ship].trip_no, __ATOMIC_RELAXED) : 0;
+    e->ship = ship;
+    e->slot = slot;
+    e->a = a;
+    e->b = b;
+    __atomic_store_n(&e->stamp, seq + 1, __ATOMIC_RELEASE);
+
+    if (__atomic_load_n(&bus->waiters, __ATOMIC_SEQ_CST) > 0) {
+        __atomic_fetch_add(&bus->wake, 1, __ATOMIC_RELEASE);
+        shm_word_wake(s, &bus->wake, SYNC_WAKE_ALL, SYNC_BITS_ALL);
+    }
+}
+
+void ev_subscribe(shm_state_t* s, ev_cursor_t* c, int from_start) {
+    const uint64_t head = __atomic_load_n(&s->events.head, __ATOMIC_ACQUIRE);
+    const uint64_t cap = s->layout.events_cap;
+    c->next = from_start ? (head > cap ? head - cap : 0) : head;
+    c->lost = 0;
+}
+
+int ev_next(shm_state_t* s, ev_cursor_t* c, event_t* out) {
+    const uint64_t cap = s->layout.events_cap;
+    event_t* ring = ev_ring(s);
+    for (;;) {
+        const uint64_t head = __atomic_load_n(&s->events.head, __ATOMIC_ACQUIRE);
+        if (c->next >= head) return 0;
+        if (head - c->next > cap) {
+            // czytelnik zostal w tyle o wiecej niz caly ring
+            c->lost += head - cap - c->next;
+            c->next = head - cap;
+        }
+
+        const event_t* e = &ring[c->next & (cap - 1)];
+        const uint64_t st = __atomic_load_n(&e->stamp, __ATOMIC_ACQUIRE);
+        if (st == c->next + 1) {
+            event_t tmp = *e;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&e->stamp, __ATOMIC_RELAXED) != st) continue;  // nadpisany w trakcie kopii
+            *out = tmp;
+            c->next++;
+            return 1;
+        }
+        if (st > c->next + 1) {
+            // wpis nalezy juz do nowszego okrazenia: nasz zostal nadpisany
+            c->lost++;
+            c->next++;
+            continue;
+        }
+        // stamp 0 albo z poprzedniego okrazenia: autor jeszcze pisze (albo nie zaczal) - probujemy pozniej.
+        // Autor, ktory zginal w trakcie zapisu, zatrzymuje czytelnika az ring go okrazy (head - next > cap)
+        return 0;
+    }
+}
+
+int ev_wait(shm_state_t* s, const ev_cursor_t* c, int timeout_ms) {
+    event_bus_t* bus = &s->events;
+    const uint32_t w = __atomic_load_n(&bus->wake, __ATOMIC_ACQUIRE);
+    __atomic_fetch_add(&bus->waiters, 1, __ATOMIC_SEQ_CST);
+    int rc = 0;
+    if (__atomic_load_n(&bus->head, __ATOMIC_SEQ_CST) > c->next) {
+        // numer zarezerwowany, ale wpis jeszcze niegotowy: nie krecimy sie (1 CPU = autor czeka na nas)
+        sleep_ms(1);
+    }
+    else {
+        rc = shm_word_wait(s, &bus->wake, w, SYNC_BITS_ALL, timeout_ms);
+    }
+    __atomic_fetch_sub(&bus->waiters, 1, __ATOMIC_SEQ_CST);
+    return rc;
+}
+
+const char* ev_type_str(int type) {
+    switch (type) {
+    case EV_PHASE: return "phase";
+    case EV_TRIP_START: return "trip_start";
+    case EV_DEPART: return "depart";
+    case EV_TRIP_END: return "trip_end";
+    case EV_ADMIT: return "admit";
+    case EV_PASSENGER_START: return "passenger_start";
+    case EV_BRIDGE_ENTER: return "bridge_enter";
+    case EV_BOARD: return "board";
+    case EV_LEAVE_SHIP: return "leave_ship";
+    case EV_EVICT_REQ: return "evict_req";
+    case EV_EVICT_ACK: return "evict_ack";
+    case EV_EVICT_FORCED: return "evict_forced";
+    case EV_EVICTED: return "evicted";
+    case EV_PASSENGER_EXIT: return "passenger_exit";
+    case EV_COMMAND: return "command";
+    case EV_GAVE_UP: return "gave_up";
+    default: return "?";
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+// Szyna zdarzen w SHM: kazde przejscie stanu (faza, mostek, wejscie, ewakuacja, odplyw)
+// publikowane jest raz, jako wpis stalej wielkosci w ringu (event_t w common.h).
+// Autor rezerwuje numer przez fetch_add na head i jest jedynym pisarzem tego wpisu;
+// czytelnicy (dyspozytor, narzedzia) trzymaja wlasny kursor i nie biora mutexu stanu.
+// Ring nadpisuje najstarsze wpisy - spozniony czytelnik dostaje licznik zgubionych.
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    typedef enum {
+        EV_NONE = 0,
+        EV_PHASE = 1,            // a = phase_t, b = boarding_open
+        EV_TRIP_START = 2,       // a = direction
+        EV_DEPART = 3,           // a = onboard_passengers, b = onboard_bikes
+        EV_TRIP_END = 4,         // a = pasazerowie rejsu, b = rowery rejsu
+        EV_ADMIT = 5,            // planer wydal bilet; a = bike
+        EV_PASSENGER_START = 6,  // a = kierunek (-1 dowolny), b = bike
+        EV_BRIDGE_ENTER = 7,     // a = bridge_dir_t, b = jednostki
+        EV_BOARD = 8,            // a = onboard_passengers, b = onboard_bikes
+        EV_LEAVE_SHIP = 9,       // zszedl na lad po UNLOADING
+        EV_EVICT_REQ = 10,       // kapitan: CMD_EVICT do slotu
+        EV_EVICT_ACK = 11,       // kapitan: ACK od pasazera
+        EV_EVICT_FORCED = 12,    // kapitan: termin minal, zdjety sila; a = alive
+        EV_EVICTED = 13,         // pasazer zszedl z mostka po CMD_EVICT
+        EV_PASSENGER_EXIT = 14,  // a = boarded
+        EV_COMMAND = 15,         // kapitan wykonal komende dyspozytora; a = ctl_cmd_t, b = seq
+        EV_GAVE_UP = 16,         // kapitan: koniec cierpliwosci; a = 0 czas / 1 odplywy, b = ms czekania
+        EV_TYPE_COUNT = 17
+    } event_type_t;
+
+    typedef struct {
+        uint64_t next;    // numer nastepnego zdarzenia do odczytu
+        uint64_t lost;    // ile zdarzen nadpisano zanim je przeczytano
+    } ev_cursor_t;
+
+    // Publikacja (bez mutexu stanu); ship = statek floty albo -1, trip_no statku czytany atomowo z SHM
+    void ev_publish(shm_state_t* s, int32_t ship, event_type_t type, int32_t slot, int32_t a, int32_t b);
+
+    // Kursor od biezacego head (from_start=0) albo od najstarszego wpisu w ringu (1)
+    void ev_subscribe(shm_state_t* s, ev_cursor_t* c, int from_start);
+
+    // 1 = zdarzenie w *out, 0 = brak nowych (albo autor jeszcze pisze)
+    int ev_next(shm_state_t* s, ev_cursor_t* c, event_t* out);
+
+    // Spij az pojawi sie zdarzenie za kursorem (maks. timeout_ms). 0 = jest, -1 = timeout
+    int ev_wait(shm_state_t* s, const ev_cursor_t* c, int timeout_ms);
+
+    const char* ev_type_str(int type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENTS_H
@@ -0,0 +1,127 @@
+#include "futex.h"
+
+#include "util.h"
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+int futex_wait(uint32_t* addr, uint32_t expected, int timeout_ms) {
+    struct timespec ts;
+    struct timespec* pts = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        pts = &ts;
+    }
+    long r = syscall(SYS_futex, addr, FUTEX_WAIT, expected, pts, NULL, 0);
+    if (r == 0) return 0;
+    if (errno == EAGAIN) return 0;   // wartosc zmienila sie zanim zasnelismy
+    if (errno != ETIMEDOUT && errno != EINTR) perror("futex(WAIT)");
+    return -1;
+}
+
+int futex_wake(uint32_t* addr, int n) {
+    long r = syscall(SYS_futex, addr, FUTEX_WAKE, n, NULL, NULL, 0);
+    if (r < 0) { perror("futex(WAKE)"); return -1; }
+    return (int)r;
+}
+
+int futex_wait_bits(uint32_t* addr, uint32_t expected, uint32_t bits, int timeout_ms) {
+    // WAIT_BITSET bierze termin bezwzgledny (CLOCK_MONOTONIC), a nie czas wzgledny
+    struct timespec ts;
+    struct timespec* pts = NULL;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += timeout_ms / 1000;
+        ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+        pts = &ts;
+    }
+    long r = syscall(SYS_futex, addr, FUTEX_WAIT_BITSET, expected, pts, NULL, bits);
+    if (r == 0) return 0;
+    if (errno == EAGAIN) return 0;
+    if (errno != ETIMEDOUT && errno != EINTR) perror("futex(WAIT_BITSET)");
+    return -1;
+}
+
+int futex_wake_bits(uint32_t* addr, int n, uint32_t bits) {
+    long r = syscall(SYS_futex, addr, FUTEX_WAKE_BITSET, n, NULL, NULL, bits);
+    if (r < 0) { perror("futex(WAKE_BITSET)"); return -1; }
+    return (int)r;
+}
+
+// ======= Zamek w slowie SHM =======
+static const uint32_t FUTEX_LOCK_WAITERS = 0x80000000u;
+
+static inline void cpu_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+// Limit obrotow jak w glibc (PTHREAD_MUTEX_ADAPTIVE_NP): 2x srednia z ostatnich prob.
+// Na jednym CPU wlasciciel nie zwolni zamka, dopoki kreci sie czekajacy - od razu spimy.
+static int g_spin_ncpu = 0;
+static int g_spin_avg = 0;
+
+static int spin_limit(void) {
+    if (g_spin_ncpu == 0) g_spin_ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (g_spin_ncpu <= 1) return 0;
+    const int lim = 2 * g_spin_avg + 10;
+    return lim < FUTEX_LOCK_SPIN_MAX ? lim : FUTEX_LOCK_SPIN_MAX;
+}
+
+int futex_lock_try(uint32_t* w) {
+    uint32_t v = 0;
+    return __atomic_compare_exchange_n(w, &v, (uint32_t)getpid(), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) ? 0 : -1;
+}
+
+void futex_lock_wait(uint32_t* w, uint32_t* spins, uint32_t* parks) {
+    const uint32_t self = (uint32_t)getpid();
+    uint32_t n_spin = 0, n_park = 0;
+
+    const int limit = spin_limit();
+    int got = 0;
+    for (int i = 0; i < limit && !got; i++) {
+        cpu_pause();
+        n_spin++;
+        uint32_t v = __atomic_load_n(w, __ATOMIC_RELAXED);
+        if (v == 0) got = __atomic_compare_exchange_n(w, &v, self, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+    }
+    if (limit > 0) g_spin_avg += ((int)n_spin - g_spin_avg) / 8;
+
+    // po przebudzeniu bierzemy zamek z bitem oczekujacych: moze spac jeszcze ktos
+    while (!got) {
+        uint32_t v = __atomic_load_n(w, __ATOMIC_RELAXED);
+        if (v == 0) {
+            got = __atomic_compare_exchange_n(w, &v, self | FUTEX_LOCK_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (!(v & FUTEX_LOCK_WAITERS) &&
+            !__atomic_compare_exchange_n(w, &v, v | FUTEX_LOCK_WAITERS, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) continue;
+        n_park++;
+        if (futex_wait(w, v | FUTEX_LOCK_WAITERS, FUTEX_LOCK_CHECK_MS) == 0) continue;
+
+        // dlugi sen: czy wlasciciel jeszcze zyje (zombie jest zywy do wait4 launchera)
+        uint32_t cur = __atomic_load_n(w, __ATOMIC_RELAXED);
+        const pid_t owner = (pid_t)(cur & ~FUTEX_LOCK_WAITERS);
+        if (owner > 0 && kill(owner, 0) != 0 && errno == ESRCH) {
+            got = __atomic_compare_exchange_n(w, &cur, self | FUTEX_LOCK_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+        }
+    }
+    if (spins) *spins += n_spin;
+    if (parks) *parks += n_park;
+}
+
+void futex_unlock(uint32_t* w) {
+    const uint32_t v = __atomic_exchange_n(w, 0, __ATOMIC_RELEASE);
+    if (v == 0) { errno = EPERM; die_perror("futex_unlock(not locked)"); }
+    if (v & FUTEX_LOCK_WAITERS) futex_wake(w, 1);
+}
@@ -0,0 +1,37 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+// Cienka warstwa na futex(2) dla slow lezacych w SHM (MAP_SHARED),
+// wiec uzywamy wariantow bez FUTEX_PRIVATE_FLAG.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Spij dopoki *addr == expected (maks. timeout_ms; <0 bez limitu).
+    // 0 = obudzony albo wartosc juz inna, -1 = timeout/EINTR
+    int futex_wait(uint32_t* addr, uint32_t expected, int timeout_ms);
+
+    // Obudz do n procesow czekajacych na addr
+    int futex_wake(uint32_t* addr, int n);
+
+    // Jak futex_wait, ale z maska bits (FUTEX_WAIT_BITSET): futex_wake_bits budzi tylko czekajacych,
+    // ktorych maska ma wspolny bit z podana; zwykly futex_wake budzi wszystkich
+    int futex_wait_bits(uint32_t* addr, uint32_t expected, uint32_t bits, int timeout_ms);
+    int futex_wake_bits(uint32_t* addr, int n, uint32_t bits);
+
+    // Zamek w jednym slowie SHM: 0 = wolny, PID wlasciciela | FUTEX_LOCK_WAITERS, gdy ktos spi.
+    // Przy kontencji krotkie krecenie z pause (limit adaptowany, 0 na jednym CPU), potem FUTEX_WAIT.
+    // Czekajacy po FUTEX_LOCK_CHECK_MS snu sprawdza kill(pid, 0) i przejmuje zamek martwego wlasciciela.
+    enum { FUTEX_LOCK_SPIN_MAX = 1000, FUTEX_LOCK_CHECK_MS = 200 };
+    int futex_lock_try(uint32_t* w);                                 // 0 wziety, -1 zajety
+    void futex_lock_wait(uint32_t* w, uint32_t* spins, uint32_t* parks);  // blokujaco, po nieudanym try
+    void futex_unlock(uint32_t* w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FUTEX_H
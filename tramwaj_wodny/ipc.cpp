@@ -1,8 +1,10 @@
 #include "ipc.h"
+#include "futex.h"
 #include "util.h"
 
 #include <errno.h>
 #include <fcntl.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/ipc.h>
@@ -11,219 +13,672 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-static void build_sem_name(char* out, size_t out_sz, const char* prefix, const char* suffix) {
-    snprintf(out, out_sz, "%s_%s", prefix, suffix);
+static void ipc_bind_sync(ipc_handles_t* h) {
+    h->mtx_state = &h->shm->sync.state;
+    h->mtx_log = &h->shm->sync.log;
 }
 
-static sem_t* sem_open_create(const char* name, unsigned init_val) {
-    sem_t* s = sem_open(name, O_CREAT | O_EXCL, 0600, init_val);
-    if (s == SEM_FAILED) {
-        perror("sem_open(create)");
-        return SEM_FAILED;
+// Liczniki statkow floty: pojemnosc N/M statku, K jednostek na kazdy z G trapow
+static int ships_init_sync(shm_state_t* s) {
+    sync_domain_t* d = &s->sync.domain;
+    for (int32_t i = 0; i < s->F; i++) {
+        ship_state_t* sh = &s->ships[i];
+        if (sync_count_init(d, &sh->sync.seats, (unsigned)sh->N) != 0) return -1;
+        if (sync_count_init(d, &sh->sync.bikes, (unsigned)sh->M) != 0) return -1;
+        for (int32_t g = 0; g < s->G; g++) {
+            if (sync_count_init(d, &sh->sync.bridge[g], (unsigned)s->K) != 0) return -1;
+        }
     }
-    return s;
+    return 0;
+}
+
+static void ships_destroy_sync(shm_state_t* s) {
+    sync_domain_t* d = &s->sync.domain;
+    for (int32_t i = 0; i < s->F; i++) {
+        ship_sync_t* sy = &s->ships[i].sync;
+        sync_count_destroy(d, &sy->seats);
+        sync_count_destroy(d, &sy->bikes);
+        for (int32_t g = 0; g < s->G; g++) sync_count_destroy(d, &sy->bridge[g]);
+    }
+}
+
+static void ships_set_mask(shm_state_t* s) {
+    for (int i = 0; i < MAX_F; i++) {
+        for (int g = 0; g < MAX_G; g++) s->ships[i].bridge[g].mask = (int32_t)s->layout.bridge_q_cap - 1;
+    }
+}
+
+static uint32_t round_up_pow2(uint32_t v) {
+    uint32_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
 }
 
-static sem_t* sem_open_existing(const char* name) {
-    sem_t* s = sem_open(name, 0);
-    if (s == SEM_FAILED) {
-        perror("sem_open(open)");
-        return SEM_FAILED;
+static size_t align_up(size_t v, size_t a) {
+    return (v + a - 1) & ~(a - 1);
+}
+
+void shm_layout_compute(int32_t K, int32_t P, int32_t F, int32_t G, shm_layout_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->magic = SHM_MAGIC;
+    out->version = SHM_LAYOUT_VERSION;
+    out->header_size = (uint32_t)sizeof(shm_state_t);
+
+    // Na trapie jest co najwyzej K wezlow (kazdy zajmuje >= 1 jednostke sem_bridge)
+    out->bridge_q_cap = round_up_pow2((uint32_t)(K > 1 ? K : 2));
+    out->bridge_q_off = (uint32_t)align_up(sizeof(shm_state_t), 64);
+
+    // Ring na kazdy trap floty: F * G (demon: pojemnosc --max-F/--max-G, ipc_reset nie pozwala wiecej)
+    out->bridge_ships = (uint32_t)(F < 1 ? 1 : (F > MAX_F ? MAX_F : F));
+    out->bridge_gws = (uint32_t)(G < 1 ? 1 : (G > MAX_G ? MAX_G : G));
+    size_t end = (size_t)out->bridge_q_off +
+        (size_t)out->bridge_ships * out->bridge_gws * out->bridge_q_cap * sizeof(bridge_node_t);
+
+    // Slot na kazdego pasazera (indeks = --id)
+    out->slots_cap = (uint32_t)(P > 0 ? P : 1);
+    out->slots_off = (uint32_t)align_up(end, 64);
+    end = (size_t)out->slots_off + (size_t)out->slots_cap * sizeof(passenger_slot_t);
+
+    // Ring zdarzen: ~8 przejsc na pasazera, zeby czytelnik budzony co kilkadziesiat ms nie gubil wpisow
+    uint32_t ev = (uint32_t)out->slots_cap * 8;
+    if (ev < EVENT_RING_MIN) ev = EVENT_RING_MIN;
+    if (ev > EVENT_RING_MAX) ev = EVENT_RING_MAX;
+    out->events_cap = round_up_pow2(ev);
+    out->events_off = (uint32_t)align_up(end, 64);
+    end = (size_t)out->events_off + (size_t)out->events_cap * sizeof(event_t);
+
+    out->total_size = align_up(end, 64);
+}
+
+static int shm_layout_check(const shm_state_t* s, size_t mapped) {
+    const shm_layout_t* l = &s->layout;
+    if (l->magic != SHM_MAGIC || l->version != SHM_LAYOUT_VERSION) {
+        fprintf(stderr, "shm: bad magic/version (0x%x v%u)\n", l->magic, l->version);
+        return -1;
+    }
+    if (l->header_size != sizeof(shm_state_t) || l->total_size != mapped) {
+        fprintf(stderr, "shm: layout size mismatch\n");
+        return -1;
     }
-    return s;
+    if ((l->bridge_q_cap & (l->bridge_q_cap - 1)) != 0 ||
+        l->bridge_ships < 1 || l->bridge_ships > MAX_F || l->bridge_gws < 1 || l->bridge_gws > MAX_G ||
+        (uint64_t)l->bridge_q_off + (uint64_t)l->bridge_ships * l->bridge_gws * l->bridge_q_cap * sizeof(bridge_node_t) >
+            l->total_size) {
+        fprintf(stderr, "shm: bad bridge section\n");
+        return -1;
+    }
+    if ((uint64_t)l->slots_off + (uint64_t)l->slots_cap * sizeof(passenger_slot_t) > l->total_size) {
+        fprintf(stderr, "shm: bad slots section\n");
+        return -1;
+    }
+    if ((l->events_cap & (l->events_cap - 1)) != 0 ||
+        (uint64_t)l->events_off + (uint64_t)l->events_cap * sizeof(event_t) > l->total_size) {
+        fprintf(stderr, "shm: bad events section\n");
+        return -1;
+    }
+    return 0;
 }
 
-int ipc_create(ipc_handles_t* h, const char* shm_name, const char* sem_prefix,
+int ipc_create(ipc_handles_t* h, const char* shm_name,
     const shm_state_t* initial_state, int* out_msqid) {
-    if (!h || !shm_name || !sem_prefix || !initial_state || !out_msqid) return -1;
+    if (!h || !shm_name || !initial_state || !out_msqid) return -1;
     memset(h, 0, sizeof(*h));
     snprintf(h->shm_name, sizeof(h->shm_name), "%s", shm_name);
-    snprintf(h->sem_prefix, sizeof(h->sem_prefix), "%s", sem_prefix);
 
     // SHM
     int fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0600);
     if (fd < 0) { perror("shm_open"); return -1; }
     h->shm_fd = fd;
 
-    if (ftruncate(fd, (off_t)sizeof(shm_state_t)) != 0) { perror("ftruncate"); return -1; }
+    shm_layout_t layout;
+    shm_layout_compute(initial_state->K, initial_state->P, initial_state->F, initial_state->G, &layout);
 
-    void* p = mmap(NULL, sizeof(shm_state_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ftruncate(fd, (off_t)layout.total_size) != 0) { perror("ftruncate"); return -1; }
+
+    void* p = mmap(NULL, (size_t)layout.total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
     if (p == MAP_FAILED) { perror("mmap"); return -1; }
     h->shm = (shm_state_t*)p;
+    h->shm_size = (size_t)layout.total_size;
     memcpy(h->shm, initial_state, sizeof(shm_state_t));
+    h->shm->layout = layout;
+    ships_set_mask(h->shm);
+    for (uint32_t i = 0; i < layout.slots_cap; i++) {
+        passenger_slot_t* sl = slot_get(h->shm, (int32_t)i);
+        sl->state = SLOT_FREE;
+        sl->ring_idx = -1;
+    }
 
-    // Semafory
-    char name[256];
-
-    build_sem_name(name, sizeof(name), sem_prefix, "state");
-    h->sem_state = sem_open_create(name, 1);
-    if (h->sem_state == SEM_FAILED) return -1;
-
-    build_sem_name(name, sizeof(name), sem_prefix, "log");
-    h->sem_log = sem_open_create(name, 1);
-    if (h->sem_log == SEM_FAILED) return -1;
-
-    build_sem_name(name, sizeof(name), sem_prefix, "seats");
-    h->sem_seats = sem_open_create(name, (unsigned)initial_state->N);
-    if (h->sem_seats == SEM_FAILED) return -1;
-
-    build_sem_name(name, sizeof(name), sem_prefix, "bikes");
-    h->sem_bikes = sem_open_create(name, (unsigned)initial_state->M);
-    if (h->sem_bikes == SEM_FAILED) return -1;
-
-    build_sem_name(name, sizeof(name), sem_prefix, "bridge");
-    h->sem_bridge = sem_open_create(name, (unsigned)initial_state->K);
-    if (h->sem_bridge == SEM_FAILED) return -1;
-
+    // Synchronizacja: w SHM (jedno mapowanie zamiast osobnych plikow /dev/shm/sem.*),
+    // obiekty backendu poza SHM (sysv: zbior semaforow) w domenie
+    shm_sync_t* sy = &h->shm->sync;
+    if (sync_domain_create(&sy->domain) != 0) return -1;
+    if (sync_mutex_init(&sy->domain, &sy->state) != 0) return -1;
+    if (sync_mutex_init(&sy->domain, &sy->log) != 0) return -1;
+    if (sync_waitq_init(&sy->domain, &sy->waitq) != 0) return -1;
+    if (ships_init_sync(h->shm) != 0) return -1;
+    ipc_bind_sync(h);
+
+    // kolejka tylko dla skrzynki na SysV (posix/sysv): dzieci dostaja --msqid w CLI; backend futex: -1
+#if SYNC_MBOX_MSGQ
     int msqid = msgget(IPC_PRIVATE, IPC_CREAT | IPC_EXCL | 0600);
     if (msqid < 0) { perror("msgget"); return -1; }
+#else
+    int msqid = -1;
+#endif
     h->msqid = msqid;
     *out_msqid = msqid;
+    mbox_reset(h);
 
     return 0;
 }
 
-int ipc_open(ipc_handles_t* h, const char* shm_name, const char* sem_prefix, int msqid) {
-    if (!h || !shm_name || !sem_prefix) return -1;
-    memset(h, 0, sizeof(*h));
-    snprintf(h->shm_name, sizeof(h->shm_name), "%s", shm_name);
-    snprintf(h->sem_prefix, sizeof(h->sem_prefix), "%s", sem_prefix);
+int ipc_reset(ipc_handles_t* h, const shm_state_t* cfg) {
+    if (!h || !h->shm || !cfg) return -1;
+    shm_state_t* s = h->shm;
+    if ((uint32_t)cfg->K > s->layout.bridge_q_cap || cfg->P < 0 || (uint32_t)cfg->P > s->layout.slots_cap ||
+        cfg->F < 1 || (uint32_t)cfg->F > s->layout.bridge_ships || cfg->G < 1 || (uint32_t)cfg->G > s->layout.bridge_gws) {
+        fprintf(stderr, "ipc_reset: K=%d P=%d F=%d G=%d over capacity (bridge=%u slots=%u ships=%u gangways=%u)\n",
+            (int)cfg->K, (int)cfg->P, (int)cfg->F, (int)cfg->G, s->layout.bridge_q_cap, s->layout.slots_cap,
+            s->layout.bridge_ships, s->layout.bridge_gws);
+        return -1;
+    }
 
-    int fd = shm_open(shm_name, O_RDWR, 0600);
-    if (fd < 0) { perror("shm_open(open)"); return -1; }
-    h->shm_fd = fd;
+    // liczniki od nowa (nikt na nich nie czeka miedzy przebiegami); F/G poprzedniego przebiegu
+    ships_destroy_sync(s);
+
+    // uklad i muteksy zostaja na miejscu; reszta naglowka z cfg, szyna zdarzen numeruje dalej.
+    // Slowa futeksow tylko rosna (jak sl->wake): ktos, kto odczytal licznik w poprzednim przebiegu,
+    // nie moze zobaczyc tej samej wartosci po resecie i zasnac na niej
+    const event_bus_t ev = s->events;
+    const uint32_t pseq = s->phase_seq;
+    uint32_t cwake[MAX_F], ack_wake[MAX_F];
+    for (int i = 0; i < MAX_F; i++) {
+        cwake[i] = s->ships[i].captain_wake;
+        ack_wake[i] = s->ships[i].control.ack_wake;
+    }
+    const size_t from = offsetof(shm_state_t, F);
+    memcpy((char*)s + from, (const char*)cfg + from, sizeof(shm_state_t) - from);
+    s->events = ev;
+    s->phase_seq = pseq;
+    for (int i = 0; i < MAX_F; i++) {
+        s->ships[i].captain_wake = cwake[i];
+        s->ships[i].control.ack_wake = ack_wake[i];
+    }
+    memset(&s->sync.state_stats, 0, sizeof(s->sync.state_stats));   // statystyki LOCK per przebieg
+    ships_set_mask(s);
+    for (uint32_t i = 0; i < s->layout.slots_cap; i++) {
+        passenger_slot_t* sl = slot_get(s, (int32_t)i);
+        const uint32_t wake = sl->wake;
+        memset(sl, 0, sizeof(*sl));
+        sl->wake = wake;
+        sl->state = SLOT_FREE;
+        sl->ring_idx = -1;
+    }
 
-    void* p = mmap(NULL, sizeof(shm_state_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (p == MAP_FAILED) { perror("mmap(open)"); return -1; }
-    h->shm = (shm_state_t*)p;
+    if (ships_init_sync(s) != 0) return -1;
 
-    char name[256];
-    build_sem_name(name, sizeof(name), sem_prefix, "state");
-    h->sem_state = sem_open_existing(name);
-    if (h->sem_state == SEM_FAILED) return -1;
+    // niedoreczone CMD_EVICT/ACK z poprzedniego przebiegu
+    mbox_reset(h);
+    return 0;
+}
 
-    build_sem_name(name, sizeof(name), sem_prefix, "log");
-    h->sem_log = sem_open_existing(name);
-    if (h->sem_log == SEM_FAILED) return -1;
+int ipc_share_fd(ipc_handles_t* h) {
+    if (!h || h->shm_fd < 0) return -1;
+    // shm_open ustawia FD_CLOEXEC - zdejmujemy, zeby dzieci dostaly fd przez execv
+    int fl = fcntl(h->shm_fd, F_GETFD);
+    if (fl < 0 || fcntl(h->shm_fd, F_SETFD, fl & ~FD_CLOEXEC) != 0) { perror("fcntl(shm_fd)"); return -1; }
+    return h->shm_fd;
+}
 
-    build_sem_name(name, sizeof(name), sem_prefix, "seats");
-    h->sem_seats = sem_open_existing(name);
-    if (h->sem_seats == SEM_FAILED) return -1;
+int ipc_open(ipc_handles_t* h, const char* shm_name, int shm_fd, int msqid) {
+    if (!h || (!shm_name && shm_fd < 0)) return -1;
+    memset(h, 0, sizeof(*h));
+    if (shm_name) snprintf(h->shm_name, sizeof(h->shm_name), "%s", shm_name);
+
+    // Dziedziczony deskryptor (launcher) albo otwarcie po nazwie
+    int fd = shm_fd;
+    if (fd < 0) {
+        fd = shm_open(shm_name, O_RDWR, 0600);
+        if (fd < 0) { perror("shm_open(open)"); return -1; }
+    }
 
-    build_sem_name(name, sizeof(name), sem_prefix, "bikes");
-    h->sem_bikes = sem_open_existing(name);
-    if (h->sem_bikes == SEM_FAILED) return -1;
+    // Rozmiar mapowania z fstat, uklad sekcji z naglowka (weryfikowany)
+    struct stat st;
+    if (fstat(fd, &st) != 0) { perror("fstat(shm)"); close(fd); return -1; }
+    if ((size_t)st.st_size < sizeof(shm_state_t)) { fprintf(stderr, "shm: too small\n"); close(fd); return -1; }
 
-    build_sem_name(name, sizeof(name), sem_prefix, "bridge");
-    h->sem_bridge = sem_open_existing(name);
-    if (h->sem_bridge == SEM_FAILED) return -1;
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // po mmap deskryptor nie jest juz potrzebny
+    close(fd);
+    h->shm_fd = -1;
+    if (p == MAP_FAILED) { perror("mmap(open)"); return -1; }
+    h->shm = (shm_state_t*)p;
+    h->shm_size = (size_t)st.st_size;
+    if (shm_layout_check(h->shm, h->shm_size) != 0) return -1;
 
+    ipc_bind_sync(h);
     h->msqid = msqid;
     return 0;
 }
 
 void ipc_close(ipc_handles_t* h) {
     if (!h) return;
-    if (h->shm && h->shm != MAP_FAILED) munmap(h->shm, sizeof(shm_state_t));
+    if (h->shm && h->shm != MAP_FAILED) munmap(h->shm, h->shm_size);
     h->shm = NULL;
-    if (h->shm_fd > 0) close(h->shm_fd);
+    if (h->shm_fd >= 0) close(h->shm_fd);
     h->shm_fd = -1;
 
-    if (h->sem_state && h->sem_state != SEM_FAILED) sem_close(h->sem_state);
-    if (h->sem_log && h->sem_log != SEM_FAILED) sem_close(h->sem_log);
-    if (h->sem_seats && h->sem_seats != SEM_FAILED) sem_close(h->sem_seats);
-    if (h->sem_bikes && h->sem_bikes != SEM_FAILED) sem_close(h->sem_bikes);
-    if (h->sem_bridge && h->sem_bridge != SEM_FAILED) sem_close(h->sem_bridge);
+    // muteksy i liczniki leza w SHM - znikaja razem z mapowaniem
+    h->mtx_state = h->mtx_log = NULL;
+}
 
-    h->sem_state = h->sem_log = h->sem_seats = h->sem_bikes = h->sem_bridge = SEM_FAILED;
+// Obiekty backendu poza SHM (sysv: zbior semaforow) - uchwyt w naglowku SHM
+static void ipc_destroy_sync(const char* shm_name) {
+    int fd = shm_open(shm_name, O_RDWR, 0600);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(shm_state_t)) { close(fd); return; }
+    void* p = mmap(NULL, sizeof(shm_state_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) { perror("mmap(destroy)"); return; }
+    shm_state_t* s = (shm_state_t*)p;
+    if (s->layout.magic == SHM_MAGIC && s->layout.version == SHM_LAYOUT_VERSION) sync_domain_destroy(&s->sync.domain);
+    munmap(p, sizeof(shm_state_t));
 }
 
-int ipc_destroy(const char* shm_name, const char* sem_prefix, int msqid) {
-    if (!shm_name || !sem_prefix) return -1;
+int ipc_destroy(const char* shm_name, int msqid) {
+    if (!shm_name) return -1;
+    ipc_destroy_sync(shm_name);
 
-    // SHM unlink
+    // SHM unlink (razem z nim znikaja muteksy i liczniki osadzone w SHM)
     if (shm_unlink(shm_name) != 0) {
         // moze juz usuniete; nie traktuj jako fatal
         perror("shm_unlink");
     }
 
-    char name[256];
-    build_sem_name(name, sizeof(name), sem_prefix, "state");
-    if (sem_unlink(name) != 0) perror("sem_unlink(state)");
+    // msg queue remove
+    if (msqid >= 0) {
+        if (msgctl(msqid, IPC_RMID, NULL) != 0) perror("msgctl(IPC_RMID)");
+    }
+    return 0;
+}
 
-    build_sem_name(name, sizeof(name), sem_prefix, "log");
-    if (sem_unlink(name) != 0) perror("sem_unlink(log)");
+// ======= Mutex stanu =======
+static void count_post_n(sync_count_t* c, int n) {
+    for (int i = 0; i < n; i++) sync_count_post(c);
+}
 
-    build_sem_name(name, sizeof(name), sem_prefix, "seats");
-    if (sem_unlink(name) != 0) perror("sem_unlink(seats)");
+int slot_reclaim_locked(shm_state_t* s, int32_t id) {
+    passenger_slot_t* sl = slot_get(s, id);
+    if (!sl) return 0;
+    ship_state_t* sh = ship_get(s, sl->ship);
+    int any = 0;
+    if (!sh) { sl->state = SLOT_LEFT; return 0; }
+
+    // wezel na trapie: wyjmij ze srodka i obudz sasiadow (zmienil sie front/back)
+    const int32_t gw = sl->gw < MAX_G ? sl->gw : 0;
+    if (sl->ring_idx >= 0) {
+        if (bridge_remove_slot(s, sl->ship, gw, id) == 0) any = 1;
+        if (sh->bridge[gw].count == 0) sh->bridge[gw].dir = BRIDGE_DIR_NONE;
+        bridge_wake_all(s, sl->ship);
+    }
+    if (sl->onboard) {
+        sl->onboard = 0;
+        if (sh->onboard_passengers > 0) sh->onboard_passengers -= 1;
+        if (sl->bike && sh->onboard_bikes > 0) sh->onboard_bikes -= 1;
+        any = 1;
+    }
+    if (sl->held_units) { int u = sl->held_units; sl->held_units = 0; count_post_n(&sh->sync.bridge[gw], u); any = 1; }
+    if (sl->held_seat) { sl->held_seat = 0; count_post_n(&sh->sync.seats, 1); any = 1; }
+    if (sl->held_bike) { sl->held_bike = 0; count_post_n(&sh->sync.bikes, 1); any = 1; }
 
-    build_sem_name(name, sizeof(name), sem_prefix, "bikes");
-    if (sem_unlink(name) != 0) perror("sem_unlink(bikes)");
+    sl->state = SLOT_LEFT;
+    return any;
+}
 
-    build_sem_name(name, sizeof(name), sem_prefix, "bridge");
-    if (sem_unlink(name) != 0) perror("sem_unlink(bridge)");
+// wlasciciel zginal w sekcji krytycznej (pod mutexem): odzyskaj jego slot z ksiegi
+static void state_recover_locked(shm_state_t* s, pid_t dead) {
+    s->lock_recoveries++;
+    for (uint32_t i = 0; dead > 0 && i < s->layout.slots_cap; i++) {
+        if (slot_get(s, (int32_t)i)->pid == dead) {
+            if (slot_reclaim_locked(s, (int32_t)i)) s->reclaimed_slots++;
+            break;
+        }
+    }
+}
 
-    // msg queue remove
-    if (msqid >= 0) {
-        if (msgctl(msqid, IPC_RMID, NULL) != 0) perror("msgctl(IPC_RMID)");
+// kontencja rozliczana juz pod mutexem (statystyki bez atomikow)
+static void state_count_contended(shm_state_t* s, int64_t t0_ns, int64_t spins, int64_t parks) {
+    lock_stats_t* st = &s->sync.state_stats;
+    st->contended++;
+    st->spins += (uint64_t)spins;
+    st->parks += (uint64_t)parks;
+    st->wait_ns += (uint64_t)(now_ns_monotonic() - t0_ns);
+}
+
+// Zamek stanu: sync_mutex_* backendu albo (TRAMWAJ_SPIN_LOCK) slowo state_word przez futex_lock_*.
+// Oba przezywaja smierc wlasciciela; kto wchodzi po nim, widzi niewyzerowane state_owner.
+static int state_mutex_try(shm_sync_t* sy) {
+#ifdef TRAMWAJ_SPIN_LOCK
+    return futex_lock_try(&sy->state_word);
+#else
+    return sync_mutex_trylock(&sy->state);
+#endif
+}
+
+static int state_mutex_wait(shm_sync_t* sy, sync_lock_cost_t* cost) {
+#ifdef TRAMWAJ_SPIN_LOCK
+    futex_lock_wait(&sy->state_word, &cost->spins, &cost->parks);
+    return 0;
+#else
+    return sync_mutex_lock(&sy->state, cost);
+#endif
+}
+
+int state_lock(ipc_handles_t* h) {
+    shm_state_t* s = h->shm;
+    shm_sync_t* sy = &s->sync;
+    int64_t t0 = -1;
+    sync_lock_cost_t cost = { 0, 0 };
+    if (state_mutex_try(sy) != 0) {
+        t0 = now_ns_monotonic();
+        if (state_mutex_wait(sy, &cost) != 0) return -1;
     }
+    sy->state_stats.acquisitions++;
+    if (t0 >= 0) state_count_contended(s, t0, cost.spins, cost.parks);
+
+    // wlasciciel zginal w sekcji krytycznej: odzyskaj jego slot
+    const pid_t dead = s->state_owner;
+    s->state_owner = getpid();
+    if (dead != 0) state_recover_locked(s, dead);
     return 0;
 }
 
+void state_unlock(ipc_handles_t* h) {
+    h->shm->state_owner = 0;
+#ifdef TRAMWAJ_SPIN_LOCK
+    futex_unlock(&h->shm->sync.state_word);
+#else
+    sync_mutex_unlock(h->mtx_state);
+#endif
+}
+
+const char* state_lock_impl(void) {
+#ifdef TRAMWAJ_SPIN_LOCK
+    return "spin";
+#else
+    return sync_mutex_impl();
+#endif
+}
+
+// ======= Flota =======
+ship_state_t* ship_get(shm_state_t* s, int32_t ship) {
+    if (ship < 0 || ship >= s->F || ship >= MAX_F) return NULL;
+    return &s->ships[ship];
+}
+
+int fleet_loading_ship(shm_state_t* s, int desired_dir) {
+    for (int32_t i = 0; i < s->F; i++) {
+        const ship_state_t* sh = &s->ships[i];
+        if (sh->phase != PHASE_LOADING || sh->boarding_open == 0) continue;
+        if (desired_dir >= 0 && (int)sh->direction != desired_dir) continue;
+        return i;
+    }
+    return -1;
+}
+
+int fleet_ended(shm_state_t* s) {
+    for (int32_t i = 0; i < s->F; i++) {
+        if (s->ships[i].phase != PHASE_END) return 0;
+    }
+    return 1;
+}
+
+// ======= Trapy statku =======
+int32_t ship_pick_gangway(shm_state_t* s, int32_t ship, int want) {
+    ship_state_t* sh = &s->ships[ship];
+    int32_t best = -1;
+    int best_free = 0;
+    for (int32_t g = 0; g < s->G && g < MAX_G; g++) {
+        const bridge_state_t* b = &sh->bridge[g];
+        if (b->dir != BRIDGE_DIR_NONE && (int)b->dir != want) continue;
+        const int v = sync_count_value(&sh->sync.bridge[g]);
+        if (best < 0 || v > best_free || (v == best_free && b->count < sh->bridge[best].count)) {
+            best = g;
+            best_free = v;
+        }
+    }
+    return best < 0 ? 0 : best;
+}
+
+void ship_set_bridge_dir(shm_state_t* s, int32_t ship, bridge_dir_t dir) {
+    for (int32_t g = 0; g < s->G && g < MAX_G; g++) s->ships[ship].bridge[g].dir = dir;
+}
+
+int32_t ship_bridge_count(shm_state_t* s, int32_t ship) {
+    int32_t n = 0;
+    for (int32_t g = 0; g < s->G && g < MAX_G; g++) n += s->ships[ship].bridge[g].count;
+    return n;
+}
+
+// ======= Sloty pasazerow =======
+passenger_slot_t* slot_get(shm_state_t* s, int32_t id) {
+    if (id < 0 || (uint32_t)id >= s->layout.slots_cap) return NULL;
+    return (passenger_slot_t*)((char*)s + s->layout.slots_off) + id;
+}
+
+static uint32_t word_key(const shm_state_t* s, const uint32_t* w) {
+    return (uint32_t)((const char*)w - (const char*)s);
+}
+
+int shm_word_wait(shm_state_t* s, uint32_t* w, uint32_t expected, uint32_t bits, int timeout_ms) {
+    return sync_wait(&s->sync.waitq, word_key(s, w), w, expected, bits, timeout_ms);
+}
+
+void shm_word_wake(shm_state_t* s, uint32_t* w, int n, uint32_t bits) {
+    sync_notify(&s->sync.waitq, word_key(s, w), w, n, bits);
+}
+
+uint32_t slot_seq(shm_state_t* s, int32_t id) {
+    passenger_slot_t* sl = slot_get(s, id);
+    return sl ? __atomic_load_n(&sl->wake, __ATOMIC_ACQUIRE) : 0;
+}
+
+void slot_wake(shm_state_t* s, int32_t id) {
+    passenger_slot_t* sl = slot_get(s, id);
+    if (!sl) return;
+    __atomic_fetch_add(&sl->wake, 1, __ATOMIC_RELEASE);
+    shm_word_wake(s, &sl->wake, 1, SYNC_BITS_ALL);
+}
+
+int slot_wait(shm_state_t* s, int32_t id, uint32_t seq, int timeout_ms) {
+    passenger_slot_t* sl = slot_get(s, id);
+    if (!sl) { sleep_ms(1); return -1; }
+    return shm_word_wait(s, &sl->wake, seq, SYNC_BITS_ALL, timeout_ms);
+}
+
+uint32_t phase_seq(shm_state_t* s) {
+    return __atomic_load_n(&s->phase_seq, __ATOMIC_ACQUIRE);
+}
+
+void phase_publish(shm_state_t* s) {
+    __atomic_fetch_add(&s->phase_seq, 1, __ATOMIC_RELEASE);
+    shm_word_wake(s, &s->phase_seq, SYNC_WAKE_ALL, SYNC_BITS_ALL);
+    for (int32_t i = 0; i < s->F && i < MAX_F; i++) bridge_wake_all(s, i);
+}
+
+int phase_wait(shm_state_t* s, uint32_t seq, int timeout_ms) {
+    return shm_word_wait(s, &s->phase_seq, seq, SYNC_BITS_ALL, timeout_ms);
+}
+
+static uint32_t slot_bit(int32_t id) {
+    return 1u << ((uint32_t)id & 31u);
+}
+
+int phase_wait_slot(shm_state_t* s, uint32_t seq, int32_t id, int timeout_ms) {
+    return shm_word_wait(s, &s->phase_seq, seq, slot_bit(id), timeout_ms);
+}
+
+void phase_poke_slot(shm_state_t* s, int32_t id) {
+    // podbicie licznika zamyka wyscig z czekajacym, ktory juz odczytal seq, a jeszcze nie zasnal;
+    // spiacy z innymi bitami nie sa budzeni (backend futex: jadro nie sprawdza im ponownie wartosci;
+    // posix/sysv nie maja masek i budza caly kubelek)
+    __atomic_fetch_add(&s->phase_seq, 1, __ATOMIC_RELEASE);
+    shm_word_wake(s, &s->phase_seq, SYNC_WAKE_ALL, slot_bit(id));
+}
+
+uint32_t captain_seq(shm_state_t* s, int32_t ship) {
+    return __atomic_load_n(&s->ships[ship].captain_wake, __ATOMIC_ACQUIRE);
+}
+
+void captain_notify(shm_state_t* s, int32_t ship) {
+    ship_state_t* sh = &s->ships[ship];
+    __atomic_fetch_add(&sh->captain_wake, 1, __ATOMIC_RELEASE);
+    shm_word_wake(s, &sh->captain_wake, 1, SYNC_BITS_ALL);
+}
+
+int captain_wait(shm_state_t* s, int32_t ship, uint32_t seq, int timeout_ms) {
+    return shm_word_wait(s, &s->ships[ship].captain_wake, seq, SYNC_BITS_ALL, timeout_ms);
+}
+
 // ======= Deque ops (ring buffer) =======
-static int idx_next(int i) { return (i + 1) % BRIDGE_Q_CAP; }
-static int idx_prev(int i) { return (i - 1 + BRIDGE_Q_CAP) % BRIDGE_Q_CAP; }
+// Pojemnosc ring buffera jest potega 2, wiec zawijanie indeksu to maska. Ring trapu gw statku i
+// lezy pod bridge_q_off + (i * bridge_gws + gw) * bridge_q_cap; stan (head/tail/count) w ships[i].bridge[gw].
+static bridge_node_t* bridge_q(shm_state_t* s, int32_t ship, int32_t gw) {
+    return (bridge_node_t*)((char*)s + s->layout.bridge_q_off) +
+        ((size_t)ship * s->layout.bridge_gws + (size_t)gw) * s->layout.bridge_q_cap;
+}
+static int idx_next(const bridge_state_t* b, int i) { return (i + 1) & b->mask; }
+static int idx_prev(const bridge_state_t* b, int i) { return (i - 1) & b->mask; }
 
-int bridge_is_empty(shm_state_t* s) {
-    return s->bridge.count == 0;
+int bridge_is_empty(shm_state_t* s, int32_t ship, int32_t gw) {
+    return s->ships[ship].bridge[gw].count == 0;
 }
 
-bridge_node_t* bridge_front(shm_state_t* s) {
-    if (s->bridge.count == 0) return NULL;
-    return &s->bridge.q[s->bridge.head];
+int bridge_is_front(shm_state_t* s, int32_t ship, int32_t gw, int32_t slot) {
+    const bridge_state_t* b = &s->ships[ship].bridge[gw];
+    passenger_slot_t* sl = slot_get(s, slot);
+    return sl && sl->ship == ship && sl->gw == gw && b->count > 0 && sl->ring_idx == b->head;
 }
 
-bridge_node_t* bridge_back(shm_state_t* s) {
-    if (s->bridge.count == 0) return NULL;
-    int last = idx_prev(s->bridge.tail);
-    return &s->bridge.q[last];
+int bridge_is_back(shm_state_t* s, int32_t ship, int32_t gw, int32_t slot) {
+    const bridge_state_t* b = &s->ships[ship].bridge[gw];
+    passenger_slot_t* sl = slot_get(s, slot);
+    return sl && sl->ship == ship && sl->gw == gw && b->count > 0 && sl->ring_idx == idx_prev(b, b->tail);
 }
 
-int bridge_push_back(shm_state_t* s, bridge_node_t node) {
-    if (s->bridge.count >= BRIDGE_Q_CAP - 1) return -1;
-    s->bridge.q[s->bridge.tail] = node;
-    s->bridge.tail = idx_next(s->bridge.tail);
-    s->bridge.count++;
-    s->bridge.load_units += node.units;
+// Budzi wszystkich ze wszystkich trapow statku (<= G * K wezlow), np. po zamknieciu boardingu
+void bridge_wake_all(shm_state_t* s, int32_t ship) {
+    for (int32_t g = 0; g < s->G && g < MAX_G; g++) {
+        const bridge_state_t* b = &s->ships[ship].bridge[g];
+        bridge_node_t* q = bridge_q(s, ship, g);
+        int i = b->head;
+        for (int n = 0; n < b->count; n++) {
+            slot_wake(s, q[i].slot);
+            i = idx_next(b, i);
+        }
+    }
+}
+
+static void slot_set_ring(shm_state_t* s, int32_t slot, int32_t idx) {
+    passenger_slot_t* sl = slot_get(s, slot);
+    if (sl) sl->ring_idx = idx;
+}
+
+bridge_node_t* bridge_front(shm_state_t* s, int32_t ship, int32_t gw) {
+    const bridge_state_t* b = &s->ships[ship].bridge[gw];
+    if (b->count == 0) return NULL;
+    return &bridge_q(s, ship, gw)[b->head];
+}
+
+bridge_node_t* bridge_back(shm_state_t* s, int32_t ship, int32_t gw) {
+    const bridge_state_t* b = &s->ships[ship].bridge[gw];
+    if (b->count == 0) return NULL;
+    return &bridge_q(s, ship, gw)[idx_prev(b, b->tail)];
+}
+
+int bridge_push_back(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t node) {
+    bridge_state_t* b = &s->ships[ship].bridge[gw];
+    if (b->count > b->mask) return -1;
+    bridge_q(s, ship, gw)[b->tail] = node;
+    slot_set_ring(s, node.slot, b->tail);
+    b->tail = idx_next(b, b->tail);
+    b->count++;
+    b->load_units += node.units;
     return 0;
 }
 
-int bridge_push_front(shm_state_t* s, bridge_node_t node) {
-    if (s->bridge.count >= BRIDGE_Q_CAP - 1) return -1;
-    s->bridge.head = idx_prev(s->bridge.head);
-    s->bridge.q[s->bridge.head] = node;
-    s->bridge.count++;
-    s->bridge.load_units += node.units;
+int bridge_push_front(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t node) {
+    bridge_state_t* b = &s->ships[ship].bridge[gw];
+    if (b->count > b->mask) return -1;
+    b->head = idx_prev(b, b->head);
+    bridge_q(s, ship, gw)[b->head] = node;
+    slot_set_ring(s, node.slot, b->head);
+    b->count++;
+    b->load_units += node.units;
     return 0;
 }
 
-int bridge_pop_front(shm_state_t* s, bridge_node_t* out) {
-    if (s->bridge.count == 0) return -1;
-    bridge_node_t n = s->bridge.q[s->bridge.head];
-    s->bridge.head = idx_next(s->bridge.head);
-    s->bridge.count--;
-    s->bridge.load_units -= n.units;
+int bridge_pop_front(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t* out) {
+    bridge_state_t* b = &s->ships[ship].bridge[gw];
+    bridge_node_t* q = bridge_q(s, ship, gw);
+    if (b->count == 0) return -1;
+    bridge_node_t n = q[b->head];
+    b->head = idx_next(b, b->head);
+    b->count--;
+    b->load_units -= n.units;
+    slot_set_ring(s, n.slot, -1);
+    if (b->count > 0) slot_wake(s, q[b->head].slot);
     if (out) *out = n;
     return 0;
 }
 
-int bridge_pop_back(shm_state_t* s, bridge_node_t* out) {
-    if (s->bridge.count == 0) return -1;
-    int last = idx_prev(s->bridge.tail);
-    bridge_node_t n = s->bridge.q[last];
-    s->bridge.tail = last;
-    s->bridge.count--;
-    s->bridge.load_units -= n.units;
+int bridge_pop_front_batch(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t* out, int max) {
+    bridge_state_t* b = &s->ships[ship].bridge[gw];
+    bridge_node_t* q = bridge_q(s, ship, gw);
+    int n = 0;
+    while (n < max && b->count > 0) {
+        bridge_node_t* fr = &q[b->head];
+        if (fr->evicting) break;
+        out[n++] = *fr;
+        b->head = idx_next(b, b->head);
+        b->count--;
+        b->load_units -= fr->units;
+        slot_set_ring(s, fr->slot, -1);
+    }
+    return n;
+}
+
+int bridge_remove_slot(shm_state_t* s, int32_t ship, int32_t gw, int32_t slot) {
+    bridge_state_t* b = &s->ships[ship].bridge[gw];
+    bridge_node_t* q = bridge_q(s, ship, gw);
+    passenger_slot_t* sl = slot_get(s, slot);
+    if (!sl || sl->ring_idx < 0 || b->count == 0) return -1;
+    int i = sl->ring_idx;
+    int32_t units = q[i].units;
+    // przesun ogon o jedno miejsce w strone luki (O(K), tylko przy odzyskiwaniu)
+    for (int nx = idx_next(b, i); nx != b->tail; i = nx, nx = idx_next(b, nx)) {
+        q[i] = q[nx];
+        slot_set_ring(s, q[i].slot, i);
+    }
+    b->tail = idx_prev(b, b->tail);
+    b->count--;
+    b->load_units -= units;
+    sl->ring_idx = -1;
+    return 0;
+}
+
+int bridge_pop_back(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t* out) {
+    bridge_state_t* b = &s->ships[ship].bridge[gw];
+    bridge_node_t* q = bridge_q(s, ship, gw);
+    if (b->count == 0) return -1;
+    int last = idx_prev(b, b->tail);
+    bridge_node_t n = q[last];
+    b->tail = last;
+    b->count--;
+    b->load_units -= n.units;
+    slot_set_ring(s, n.slot, -1);
+    if (b->count > 0) slot_wake(s, q[idx_prev(b, b->tail)].slot);
     if (out) *out = n;
     return 0;
 }
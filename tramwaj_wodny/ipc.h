@@ -3,51 +3,140 @@
 
 #include "common.h"
 
-#include <semaphore.h>
-
 #ifdef __cplusplus
 extern "C" {
 #endif
 
     typedef struct {
-        // nazwy (uzywane do cleanup)
+        // nazwa (uzywana do cleanup)
         char shm_name[128];
-        char sem_prefix[128];
 
         // uchwyty
         int shm_fd;
         shm_state_t* shm;
+        size_t shm_size;    // rozmiar mapowania (z naglowka shm_layout_t)
 
-        sem_t* sem_state;   // mutex do SHM
-        sem_t* sem_log;     // mutex do logu
-        sem_t* sem_seats;   // N
-        sem_t* sem_bikes;   // M
-        sem_t* sem_bridge;  // K (units)
+        // wskazniki na obiekty synchronizacji osadzone w SHM (shm_sync_t, backend z sync_backend.h);
+        // liczniki statkow: ship_get(shm, i)->sync
+        sync_mutex_t* mtx_state;   // mutex do SHM - przez state_lock/state_unlock
+        sync_mutex_t* mtx_log;     // mutex do logu
 
-        int msqid;          // SysV message queue id
+        int msqid;          // SysV message queue id (skrzynka mbox_* w backendach posix/sysv; futex: -1)
     } ipc_handles_t;
 
-    // Tworzy IPC (tylko launcher)
-    int ipc_create(ipc_handles_t* h, const char* shm_name, const char* sem_prefix,
+    // Wylicza uklad SHM dla danych K, P, F i G (ring trapu: potega 2 >= K, dla kazdego z F * G trapow)
+    void shm_layout_compute(int32_t K, int32_t P, int32_t F, int32_t G, shm_layout_t* out);
+
+    // Tworzy IPC (tylko launcher); rozmiar SHM z initial_state->K / ->P / ->F / ->G,
+    // domena backendu synchronizacji, muteksy i liczniki statkow (F, N/M z initial_state->ships) w SHM
+    int ipc_create(ipc_handles_t* h, const char* shm_name,
         const shm_state_t* initial_state, int* out_msqid);
 
-    // Otwiera IPC (dzieci)
-    int ipc_open(ipc_handles_t* h, const char* shm_name, const char* sem_prefix, int msqid);
+    // Demon (tramwajd): nowa konfiguracja w istniejacym SHM miedzy przebiegami, gdy nikt inny
+    // nie korzysta z IPC. Stan i sloty od zera, semafory na nowe N/M/K, pusta kolejka komunikatow;
+    // uklad (pojemnosc z ipc_create) i muteksy zostaja, liczniki futeksow (phase_seq, captain_wake,
+    // ack_wake, sloty, szyna zdarzen) rosna dalej. 0 ok, -1 blad (K/P/F/G ponad pojemnosc)
+    int ipc_reset(ipc_handles_t* h, const shm_state_t* cfg);
+
+    // Launcher: zdejmuje FD_CLOEXEC z deskryptora SHM i zwraca go (przekazywany dzieciom jako --shm-fd)
+    int ipc_share_fd(ipc_handles_t* h);
+
+    // Otwiera IPC (dzieci): shm_fd >= 0 -> dziedziczony deskryptor (jedno mmap),
+    // w przeciwnym razie shm_open(shm_name)
+    int ipc_open(ipc_handles_t* h, const char* shm_name, int shm_fd, int msqid);
 
     // Zamkniecie (wszyscy)
     void ipc_close(ipc_handles_t* h);
 
-    // Cleanup (tylko launcher): sem_unlink/shm_unlink/msgctl(IPC_RMID)
-    int ipc_destroy(const char* shm_name, const char* sem_prefix, int msqid);
-
-    // ======= Operacje na deque mostka (pod sem_state mutexem) =======
-    int bridge_is_empty(shm_state_t* s);
-    bridge_node_t* bridge_front(shm_state_t* s);
-    bridge_node_t* bridge_back(shm_state_t* s);
-    int bridge_push_back(shm_state_t* s, bridge_node_t node);
-    int bridge_push_front(shm_state_t* s, bridge_node_t node);
-    int bridge_pop_front(shm_state_t* s, bridge_node_t* out);
-    int bridge_pop_back(shm_state_t* s, bridge_node_t* out);
+    // Czekanie na slowie w SHM (liczniki budzen) przez backend: sync_wait / sync_notify z kluczem = offset slowa.
+    // wait: 0 obudzony / slowo inne, -1 timeout/EINTR; wake po zmianie slowa (n, bits jak w sync_backend.h)
+    int shm_word_wait(shm_state_t* s, uint32_t* w, uint32_t expected, uint32_t bits, int timeout_ms);
+    void shm_word_wake(shm_state_t* s, uint32_t* w, int n, uint32_t bits);
+
+    // Cleanup (tylko launcher): domena backendu (sysv: IPC_RMID zbioru semaforow), shm_unlink, msgctl(IPC_RMID)
+    int ipc_destroy(const char* shm_name, int msqid);
+
+    // ======= Mutex stanu (process-shared, odporny na smierc wlasciciela) =======
+    // sync_mutex_* backendu albo (TRAMWAJ_SPIN_LOCK) slowo shm_sync_t.state_word przez futex_lock_*.
+    // state_owner jest ustawiany po wejsciu i zerowany przed wyjsciem: niezerowy po wejsciu znaczy,
+    // ze poprzedni wlasciciel zginal w sekcji krytycznej - odzyskujemy jego slot z ksiegi.
+    // Kontencje (nieudana pierwsza proba) liczy shm_sync_t.state_stats (pod mutexem).
+    // 0 ok (takze po odzyskaniu), -1 blad (ENOTRECOVERABLE itp.)
+    int state_lock(ipc_handles_t* h);
+    void state_unlock(ipc_handles_t* h);
+    const char* state_lock_impl(void);   // "spin" albo sync_mutex_impl()
+
+    // Pod mutexem: zwalnia wszystko, co wg ksiegi trzyma slot (wezel na mostku, jednostki
+    // mostka, miejsce, rower, liczniki na statku sl->ship) i ustawia SLOT_LEFT. Wolane przez pasazera
+    // na wyjsciu oraz przez innych dla slotu zmarlego procesu.
+    // 1 = cos zwolniono, 0 = ksiega pusta
+    int slot_reclaim_locked(shm_state_t* s, int32_t id);
+
+    // ======= Flota =======
+    ship_state_t* ship_get(shm_state_t* s, int32_t ship);    // NULL gdy ship poza [0, F)
+    // Pod mutexem: pierwszy statek w LOADING (boarding otwarty) w kierunku desired_dir (<0 dowolny); -1 brak
+    int fleet_loading_ship(shm_state_t* s, int desired_dir);
+    // Pod mutexem: 1 = wszystkie statki w PHASE_END
+    int fleet_ended(shm_state_t* s);
+
+    // ======= Trapy statku (--gangways) =======
+    // Pod mutexem: trap dla ruchu w kierunku want (BRIDGE_DIR_IN/OUT) - sposrod pustych albo juz
+    // plynacych w tym kierunku ten z najwieksza liczba wolnych jednostek (sync_count_value), przy remisie
+    // krotsza kolejka. Zaden nie pasuje -> 0 (wejscie i tak sprawdzi kierunek pod mutexem)
+    int32_t ship_pick_gangway(shm_state_t* s, int32_t ship, int want);
+    // Pod mutexem: kierunek wszystkich trapow statku (poczatek LOADING / odplyw / rozladunek)
+    void ship_set_bridge_dir(shm_state_t* s, int32_t ship, bridge_dir_t dir);
+    // Pod mutexem: wezly na wszystkich trapach statku
+    int32_t ship_bridge_count(shm_state_t* s, int32_t ship);
+
+    // ======= Skrzynka kapitan <-> pasazer (CMD_EVICT / ACK) =======
+    // Kolejka SysV (sync_msgq.cpp) albo skrzynki w SHM (backend futex). Polecenie adresowane
+    // slotem i PID-em pasazera, ACK statkiem kapitana. Nieblokujace; odbiorca odpytuje.
+    int mbox_send_cmd(ipc_handles_t* h, int32_t slot, const msg_cmd_t* m);       // m->mtype = PID; 0 ok, -1 blad
+    int mbox_recv_cmd(ipc_handles_t* h, int32_t slot, pid_t pid, msg_cmd_t* out); // 1 odebrane, 0 brak
+    void mbox_drop_cmd(ipc_handles_t* h, int32_t slot, pid_t pid);               // niedoreczone polecenie
+    int mbox_send_ack(ipc_handles_t* h, int32_t ship, const msg_ack_t* m);       // 0 ok, -1 blad
+    int mbox_recv_ack(ipc_handles_t* h, int32_t ship, msg_ack_t* out);           // 1 odebrane, 0 brak
+    void mbox_reset(ipc_handles_t* h);   // tworca: pusta skrzynka (ipc_create / ipc_reset)
+
+    // ======= Sloty pasazerow =======
+    passenger_slot_t* slot_get(shm_state_t* s, int32_t id);  // NULL gdy id poza zakresem
+    uint32_t slot_seq(shm_state_t* s, int32_t id);           // odczyt licznika budzen (przed sprawdzeniem warunku)
+    void slot_wake(shm_state_t* s, int32_t id);              // budzi dokladnie ten slot
+    int slot_wait(shm_state_t* s, int32_t id, uint32_t seq, int timeout_ms);
+
+    // Zmiana fazy/kierunku dowolnego statku: podbija phase_seq, budzi czekajacych na faze
+    uint32_t phase_seq(shm_state_t* s);
+    void phase_publish(shm_state_t* s);
+    int phase_wait(shm_state_t* s, uint32_t seq, int timeout_ms);
+    // Czekanie na faze z maska slotu (bit id % 32): phase_publish budzi wszystkich,
+    // phase_poke_slot tylko czekajacych z tym bitem (np. rezygnacja wg cierpliwosci)
+    int phase_wait_slot(shm_state_t* s, uint32_t seq, int32_t id, int timeout_ms);
+    void phase_poke_slot(shm_state_t* s, int32_t id);
+
+    // Budzenie kapitana statku (wpuszczanie grupowe): pasazer po wejsciu na mostek podbija captain_wake
+    uint32_t captain_seq(shm_state_t* s, int32_t ship);
+    void captain_notify(shm_state_t* s, int32_t ship);
+    int captain_wait(shm_state_t* s, int32_t ship, uint32_t seq, int timeout_ms);
+
+    // ======= Operacje na deque trapu gw statku ship (pod mutexem stanu: state_lock) =======
+    // push_* zapisuja ring_idx w slocie wezla; pop_front budzi nowy front,
+    // pop_back budzi nowy back (nastepnego w kolejce).
+    int bridge_is_empty(shm_state_t* s, int32_t ship, int32_t gw);
+    int bridge_is_front(shm_state_t* s, int32_t ship, int32_t gw, int32_t slot);
+    int bridge_is_back(shm_state_t* s, int32_t ship, int32_t gw, int32_t slot);
+    void bridge_wake_all(shm_state_t* s, int32_t ship);     // wszystkie trapy statku
+    bridge_node_t* bridge_front(shm_state_t* s, int32_t ship, int32_t gw);
+    bridge_node_t* bridge_back(shm_state_t* s, int32_t ship, int32_t gw);
+    int bridge_push_back(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t node);
+    int bridge_push_front(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t node);
+    int bridge_pop_front(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t* out);
+    // Zdejmuje do max wezlow z frontu (bez evicting) w jednej sekcji krytycznej, bez budzenia
+    // sasiadow; zwraca liczbe zdjetych
+    int bridge_pop_front_batch(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t* out, int max);
+    int bridge_pop_back(shm_state_t* s, int32_t ship, int32_t gw, bridge_node_t* out);
+    // Usuwa wezel slotu ze srodka kolejki (tylko odzyskiwanie po smierci procesu)
+    int bridge_remove_slot(shm_state_t* s, int32_t ship, int32_t gw, int32_t slot);
 
 #ifdef __cplusplus
 }
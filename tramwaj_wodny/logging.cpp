@@ -1,7 +1,6 @@
 #include "logging.h"
 #include "util.h"
 
-#include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
@@ -9,21 +8,15 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-static int sem_wait_nointr(sem_t* s) {
-    while (sem_wait(s) != 0) {
-        if (errno == EINTR) return -1;
-        die_perror("sem_wait");
-    }
-    return 0;
-}
+// Mutex logu przezywa smierc wlasciciela: jesli proces zginal w trakcie zapisu, przejmujemy go
+// (co najwyzej jedna ucieta linia) zamiast blokowac wszystkich logujacych.
+static int log_lock(sync_mutex_t* m) { return sync_mutex_lock(m, NULL); }
 
-static void sem_post_chk(sem_t* s) {
-    if (sem_post(s) != 0) die_perror("sem_post");
-}
+static void log_unlock(sync_mutex_t* m) { sync_mutex_unlock(m); }
 
-int logger_open(logger_t* lg, const char* path, sem_t* sem_log) {
-    if (!lg || !path || !sem_log) return -1;
-    lg->sem_log = sem_log;
+int logger_open(logger_t* lg, const char* path, sync_mutex_t* mtx_log) {
+    if (!lg || !path || !mtx_log) return -1;
+    lg->mtx_log = mtx_log;
     int fd = open(path, O_CREAT | O_WRONLY | O_APPEND, 0600);
     if (fd < 0) {
         perror("open(log)");
@@ -33,6 +26,13 @@ int logger_open(logger_t* lg, const char* path, sem_t* sem_log) {
     return 0;
 }
 
+int logger_attach(logger_t* lg, int fd, sync_mutex_t* mtx_log) {
+    if (!lg || fd < 0 || !mtx_log) return -1;
+    lg->mtx_log = mtx_log;
+    lg->fd = fd;
+    return 0;
+}
+
 void logger_close(logger_t* lg) {
     if (!lg) return;
     if (lg->fd >= 0) close(lg->fd);
@@ -42,14 +42,15 @@ void logger_close(logger_t* lg) {
 void logf(logger_t* lg, const char* role, const char* fmt, ...) {
     if (!lg || lg->fd < 0 || !role || !fmt) return;
 
-    if (sem_wait_nointr(lg->sem_log) != 0) return;
+    if (log_lock(lg->mtx_log) != 0) return;
 
     char buf[1024];
-    int64_t ms = now_ms_monotonic();
+    // znacznik: ms jak dotad + czesc ulamkowa do ns (kolejnosc zdarzen ponizej 1 ms)
+    int64_t ns = now_ns_monotonic();
     pid_t pid = getpid();
 
-    int off = snprintf(buf, sizeof(buf), "[%lld] pid=%d role=%s ",
-        (long long)ms, (int)pid, role);
+    int off = snprintf(buf, sizeof(buf), "[%lld.%06lld] pid=%d role=%s ",
+        (long long)(ns / 1000000), (long long)(ns % 1000000), (int)pid, role);
     if (off < 0) off = 0;
     if (off >= (int)sizeof(buf)) off = (int)sizeof(buf) - 1;
 
@@ -79,5 +80,5 @@ void logf(logger_t* lg, const char* role, const char* fmt, ...) {
         written += (size_t)wr;
     }
 
-    sem_post_chk(lg->sem_log);
+    log_unlock(lg->mtx_log);
 }
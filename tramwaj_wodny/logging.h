@@ -1,17 +1,20 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 
-#include <semaphore.h>
+#include "sync_backend.h"
+
 #include <stdarg.h>
 
-// Prosty logger do pliku (append). Uzywa semafora do serializacji wpisow.
+// Prosty logger do pliku (append). Uzywa mutexu procesowego (w SHM) do serializacji wpisow.
 
 typedef struct {
     int fd;           // open()'owany plik
-    sem_t* sem_log;   // named semaphore (binary)
+    sync_mutex_t* mtx_log;   // mutex procesowy (w SHM)
 } logger_t;
 
-int logger_open(logger_t* lg, const char* path, sem_t* sem_log);
+int logger_open(logger_t* lg, const char* path, sync_mutex_t* mtx_log);
+// Uzyj juz otwartego (dziedziczonego przez execv) deskryptora logu
+int logger_attach(logger_t* lg, int fd, sync_mutex_t* mtx_log);
 void logger_close(logger_t* lg);
 
 // log line: [ms] pid role event details...
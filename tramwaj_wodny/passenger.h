@@ -0,0 +1,27 @@
+#ifndef PASSENGER_H
+#define PASSENGER_H
+
+// Logika pasazera niezalezna od procesu: uzywa jej ./passenger (jeden przebieg na proces)
+// i worker puli tramwajd (wiele przebiegow w tym samym, juz podlaczonym procesie).
+
+#include "ipc.h"
+#include "logging.h"
+#include "results.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Caly cykl pasazera na otwartym IPC: rejestracja w slocie id, proba wejscia, rejs, zejscie,
+    // sprzatanie wg ksiegi i wiersz wynikow (res moze byc wylaczony). 1/0 = wszedl/nie wszedl, -1 blad.
+    int passenger_run(ipc_handles_t* ipc, logger_t* lg, results_writer_t* res,
+        int32_t id, int desired_dir, int has_bike);
+
+    // Z handlera sygnalu: biezacy (i kazdy kolejny) passenger_run konczy sie przez sprzatanie
+    void passenger_request_exit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PASSENGER_H
@@ -0,0 +1,489 @@
+#include "passenger.h"
+#include "common.h"
+#include "events.h"
+#include "util.h"
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t g_exit = 0;
+
+void passenger_request_exit(void) { g_exit = 1; }
+
+static int desired_dir_ok(const ship_state_t* sh, int desired_dir) {
+    if (desired_dir < 0) return 1;
+    return (int)sh->direction == desired_dir;
+}
+
+// liczniki statku, ktorego dotyczy ksiega slotu (sl->ship ustawiany pod mutexem przed rezerwacja)
+static ship_sync_t* ledger_sync(ipc_handles_t* ipc, const passenger_slot_t* sl) {
+    return &ipc->shm->ships[sl->ship].sync;
+}
+
+static void release_n(sync_count_t* c, int n) {
+    for (int i = 0; i < n; i++) sync_count_post(c);
+}
+
+// ======= Ksiega zasobow (passenger_slot_t.held_* / onboard) =======
+// Najpierw wymazujemy wpis, potem oddajemy semafor: smierc pomiedzy
+// moze co najwyzej "zgubic" zasob, nigdy nie zwolni go dwukrotnie.
+static void ledger_drop_units(ipc_handles_t* ipc, passenger_slot_t* sl) {
+    int u = sl->held_units;
+    sl->held_units = 0;
+    release_n(&ledger_sync(ipc, sl)->bridge[sl->gw], u);
+}
+
+static void ledger_drop_reservation(ipc_handles_t* ipc, passenger_slot_t* sl) {
+    ship_sync_t* sy = ledger_sync(ipc, sl);
+    if (sl->held_seat) { sl->held_seat = 0; sync_count_post(&sy->seats); }
+    if (sl->held_bike) { sl->held_bike = 0; sync_count_post(&sy->bikes); }
+}
+
+// rollback proby wejscia: mostek + rezerwacje statku
+static void ledger_rollback(ipc_handles_t* ipc, passenger_slot_t* sl) {
+    ledger_drop_units(ipc, sl);
+    ledger_drop_reservation(ipc, sl);
+}
+
+// Dzieki temu proces nie blokuje sie trzymajac 1 jednostke i czekajac na druga.
+static int acquire_units_atomic(sync_count_t* c, int units) {
+    if (units == 1) {
+        // jedna jednostka: zwykle blokujace czekanie (EINTR przy SIGTERM -> wyjscie)
+        while (sync_count_wait(c) != 0) {
+            if (g_exit) return -1;
+        }
+        return 1;
+    }
+    for (;;) {
+        if (g_exit) return -1;
+
+        int got = 0;
+        for (int i = 0; i < units; i++) {
+            if (sync_count_trywait(c) != 0) {
+                // rollback czesciowego zajecia
+                if (got > 0) release_n(c, got);
+                got = -1;
+                break;
+            }
+            got++;
+        }
+
+        if (got == units) return units;
+        sleep_ms(1);
+    }
+}
+
+static void passenger_send_ack(ipc_handles_t* ipc, int32_t ship, int trip_no) {
+    msg_ack_t ack;
+    ack.mtype = 0; // ustawia skrzynka (statek kapitana)
+    ack.pid = getpid();
+    ack.trip_no = trip_no;
+    (void)mbox_send_ack(ipc, ship, &ack);
+}
+
+static int read_trip_no(ipc_handles_t* ipc, int32_t ship) {
+    if (state_lock(ipc) != 0) return -1;
+    int t = ipc->shm->ships[ship].trip_no;
+    state_unlock(ipc);
+    return t;
+}
+
+// Obsluga wymuszonego zejscia w kolejnosci LIFO:
+// - czekamy az dir=OUT i bedziemy na back (budzi nas kapitan albo ten, kto zszedl za nami)
+// - pop_back
+// - zwalniamy mostek + rezerwacje
+static void passenger_handle_evict(ipc_handles_t* ipc, logger_t* lg, int32_t id, int trip_no) {
+    logf(lg, "passenger", "evict handling start (trip=%d)", trip_no);
+
+    for (;;) {
+        if (g_exit) return;
+
+        const uint32_t seq = slot_seq(ipc->shm, id);
+        if (state_lock(ipc) != 0) return;
+
+        if (slot_get(ipc->shm, id)->state == SLOT_LEFT) {
+            // kapitan nie doczekal sie ACK i zdjal nas sila (zasoby oddal wg ksiegi)
+            state_unlock(ipc);
+            logf(lg, "passenger", "forced off bridge by captain (evict timeout), trip=%d", trip_no);
+            return;
+        }
+
+        passenger_slot_t* sl = slot_get(ipc->shm, id);
+        const int32_t ship = sl->ship, gw = sl->gw;
+        bridge_state_t* b = &ipc->shm->ships[ship].bridge[gw];
+        if (b->dir == BRIDGE_DIR_OUT && bridge_is_back(ipc->shm, ship, gw, id)) {
+            bridge_node_t out;
+            bridge_pop_back(ipc->shm, ship, gw, &out);
+
+            if (b->count == 0) b->dir = BRIDGE_DIR_NONE;
+            sl->state = SLOT_LEFT;
+
+            state_unlock(ipc);
+
+            // zwolnij zasoby (mostek + rezerwacje statku)
+            ledger_rollback(ipc, sl);
+
+            passenger_send_ack(ipc, ship, trip_no);
+            ev_publish(ipc->shm, ship, EV_EVICTED, id, 0, 0);
+            logf(lg, "passenger", "left bridge due to evict (LIFO), trip=%d", trip_no);
+            return;
+        }
+
+        state_unlock(ipc);
+        (void)slot_wait(ipc->shm, id, seq, 50);
+    }
+}
+
+int passenger_run(ipc_handles_t* ipc, logger_t* lg, results_writer_t* res,
+    int32_t id, int desired_dir, int has_bike) {
+    const pid_t me = getpid();
+    const int units = has_bike ? 2 : 1;
+
+    if (!slot_get(ipc->shm, id)) {
+        fprintf(stderr, "passenger: slot %d out of range (P=%d)\n", (int)id, (int)ipc->shm->layout.slots_cap);
+        return -1;
+    }
+
+    pax_rec_t rec;
+    rec.pid = me;
+    rec.dir = (int8_t)desired_dir;
+    rec.bike = (uint8_t)has_bike;
+    rec.trip = -1;
+    rec.ship = -1;
+    rec.t_arrive = now_ns_monotonic();
+    rec.t_board = rec.t_leave = -1;
+
+    logf(lg, "passenger", "start desired_dir=%d bike=%d units=%d",
+        desired_dir, has_bike, units);
+
+    if (state_lock(ipc) != 0) return -1;
+    {
+        passenger_slot_t* sl = slot_get(ipc->shm, id);
+        sl->pid = me;
+        sl->state = SLOT_WAITING;
+        sl->ring_idx = -1;
+        sl->dir = (uint8_t)(desired_dir < 0 ? SLOT_DIR_ANY : desired_dir);
+        sl->bike = (uint8_t)has_bike;
+        sl->held_seat = sl->held_bike = sl->held_units = sl->onboard = 0;
+        sl->arrival = ipc->shm->arrival_seq++;
+        sl->skipped = 0;
+    }
+    state_unlock(ipc);
+    ev_publish(ipc->shm, -1, EV_PASSENGER_START, id, desired_dir, has_bike);
+
+    // Ksiega w SHM zamiast flag lokalnych: na wyjsciu zwalniamy dokladnie to, co jest w niej
+    // zapisane, a po SIGKILL ten sam zapis pozwala odzyskac zasoby (slot_reclaim_locked)
+    passenger_slot_t* const led = slot_get(ipc->shm, id);
+    const int planner = (ipc->shm->admission == ADMIT_PLANNER);
+
+    int boarded = 0;
+    int32_t ship = 0;             // statek biezacej proby (led->ship)
+    int32_t gw = 0;               // trap statku (led->gw)
+    ship_state_t* sh = &ipc->shm->ships[0];
+
+    while (!g_exit) {
+        // odbierz ewentualne CMD_EVICT (nieblokujaco)
+        msg_cmd_t cmd;
+        if (mbox_recv_cmd(ipc, id, me, &cmd) && cmd.cmd == CMD_EVICT) {
+            passenger_handle_evict(ipc, lg, id, cmd.trip_no);
+            goto finish;
+        }
+
+        // kapitan pilnuje cierpliwosci (--patience*) i oznacza nas SLOT_GAVE_UP
+        if (__atomic_load_n(&led->state, __ATOMIC_ACQUIRE) == SLOT_GAVE_UP) {
+            logf(lg, "passenger", "gave up waiting (patience)");
+            goto finish;
+        }
+
+        // wybierz statek w LOADING w naszym kierunku (pierwszy z floty; planer: ten z biletu)
+        // i najmniej zajety trap; licznik faz przed odczytem, zeby nie przegapic zmiany. Ksiega
+        // jest tu pusta, wiec led->ship / led->gw mozna przestawic (pod mutexem - czyta je slot_reclaim_locked)
+        const uint32_t pseq = phase_seq(ipc->shm);
+        if (state_lock(ipc) != 0) goto finish;
+        const int end = ipc->shm->shutdown || fleet_ended(ipc->shm);
+        int pick = -1;
+        if (!end) {
+            if (!planner) pick = fleet_loading_ship(ipc->shm, desired_dir);
+            else if (led->state == SLOT_ADMITTED) pick = led->ship;
+            else pick = fleet_loading_ship(ipc->shm, desired_dir) >= 0 ? 0 : -1;   // czekamy na bilet
+        }
+        if (pick >= 0 && !planner) led->ship = (uint8_t)pick;
+        if (pick >= 0 && (!planner || led->state == SLOT_ADMITTED)) {
+            led->gw = (uint8_t)ship_pick_gangway(ipc->shm, led->ship, BRIDGE_DIR_IN);
+        }
+        state_unlock(ipc);
+
+        if (end) {
+            logf(lg, "passenger", "END/shutdown observed -> exit");
+            break;
+        }
+
+        if (pick < 0) {
+            // zaden statek nie laduje w naszym kierunku: spij do zmiany fazy (phase_publish kapitana)
+            // albo do rezygnacji (phase_poke_slot); termin cierpliwosci liczy kapitan, timeout to tylko zabezpieczenie
+            (void)phase_wait_slot(ipc->shm, pseq, id, 1000);
+            continue;
+        }
+
+        if (planner) {
+            // bez biletu od kapitana nic nie rezerwujemy (budzi nas przydzial w planner_tick)
+            const uint32_t sseq = slot_seq(ipc->shm, id);
+            if (__atomic_load_n(&led->state, __ATOMIC_ACQUIRE) != SLOT_ADMITTED) {
+                (void)slot_wait(ipc->shm, id, sseq, 100);
+                continue;
+            }
+        }
+        ship = led->ship;
+        gw = led->gw;
+        sh = &ipc->shm->ships[ship];
+        ship_sync_t* sy = &sh->sync;
+        bridge_state_t* br = &sh->bridge[gw];
+
+        // Sprobuj zarezerwowac miejsce na statku
+        if (!led->held_seat) {
+            if (sync_count_trywait(&sy->seats) != 0) {
+                (void)phase_wait(ipc->shm, pseq, 5);
+                continue;
+            }
+            led->held_seat = 1;
+        }
+
+        if (has_bike && !led->held_bike) {
+            if (sync_count_trywait(&sy->bikes) != 0) {
+                ledger_drop_reservation(ipc, led);
+                (void)phase_wait(ipc->shm, pseq, 5);
+                continue;
+            }
+            led->held_bike = 1;
+        }
+
+        // Sprobuj zarezerwowac jednostki wybranego trapu
+        if (led->held_units == 0) {
+            for (int i = 0; i < units; i++) {
+                if (sync_count_trywait(&sy->bridge[gw]) != 0) break;
+                led->held_units++;
+            }
+
+            if (led->held_units != units) {
+                ledger_rollback(ipc, led);
+                (void)phase_wait(ipc->shm, pseq, 2);
+                continue;
+            }
+        }
+
+        // Wejscie na mostek: wymagamy dir NONE lub IN
+        if (state_lock(ipc) != 0) goto finish;
+
+        if (led->state == SLOT_GAVE_UP) {
+            // kapitan zdazyl nas skreslic miedzy rezerwacja a wejsciem
+            state_unlock(ipc);
+            ledger_rollback(ipc, led);
+            continue;
+        }
+
+        if (sh->phase != PHASE_LOADING ||
+            sh->boarding_open == 0 ||
+            !desired_dir_ok(sh, desired_dir)) {
+            state_unlock(ipc);
+            ledger_rollback(ipc, led);
+            continue;
+        }
+
+        if (!(br->dir == BRIDGE_DIR_NONE || br->dir == BRIDGE_DIR_IN)) {
+            state_unlock(ipc);
+            ledger_rollback(ipc, led);
+            continue;
+        }
+
+        if (br->dir == BRIDGE_DIR_NONE) br->dir = BRIDGE_DIR_IN;
+
+        bridge_node_t node;
+        node.pid = me;
+        node.slot = id;
+        node.units = (uint8_t)units;
+        node.evicting = 0;
+
+        if (bridge_push_back(ipc->shm, ship, gw, node) != 0) {
+            state_unlock(ipc);
+            ledger_rollback(ipc, led);
+            continue;
+        }
+
+        slot_get(ipc->shm, id)->state = SLOT_ON_BRIDGE;
+        const int batch = ipc->shm->board_batch > 0;
+        state_unlock(ipc);
+        // wpuszczanie grupowe: kapitan zdejmuje nas z frontu, my tylko go budzimy
+        if (batch) captain_notify(ipc->shm, ship);
+        ev_publish(ipc->shm, ship, EV_BRIDGE_ENTER, id, BRIDGE_DIR_IN, units);
+
+        logf(lg, "passenger", "entered bridge (dir IN), waiting to board");
+
+        // Czekaj az bedziesz z przodu i boarding wciaz otwarty
+        // (budzi nas poprzednik schodzacy z frontu albo zmiana fazy);
+        // w trybie --board-batch czekamy, az kapitan oznaczy nas SLOT_ONBOARD
+        for (;;) {
+            if (g_exit) goto finish;
+
+            const uint32_t seq = slot_seq(ipc->shm, id);
+
+            // odbierz CMD_EVICT
+            if (mbox_recv_cmd(ipc, id, me, &cmd) && cmd.cmd == CMD_EVICT) {
+                passenger_handle_evict(ipc, lg, id, cmd.trip_no);
+                goto finish;
+            }
+
+            if (state_lock(ipc) != 0) goto finish;
+
+            if (batch && led->state == SLOT_ONBOARD) {
+                // kapitan juz nas wpuscil: zdjal wezel, policzyl onboard_* i oddal jednostki mostka
+                const int onboard = sh->onboard_passengers;
+                const int bikes = sh->onboard_bikes;
+                rec.trip = sh->trip_no;
+                rec.ship = (int8_t)ship;
+                state_unlock(ipc);
+                rec.t_board = now_ns_monotonic();
+
+                boarded = 1;
+                logf(lg, "passenger", "BOARDED ship=%d (onboard=%d bikes=%d)", (int)ship, onboard, bikes);
+                break;
+            }
+
+            if (sh->phase != PHASE_LOADING || sh->boarding_open == 0) {
+                state_unlock(ipc);
+
+                const int trip = read_trip_no(ipc, ship);
+                passenger_handle_evict(ipc, lg, id, trip);
+                goto finish;
+            }
+
+            bridge_node_t* fr = bridge_front(ipc->shm, ship, gw);
+            if (!batch && fr && bridge_is_front(ipc->shm, ship, gw, id) && fr->evicting == 0) {
+                bridge_node_t out;
+                bridge_pop_front(ipc->shm, ship, gw, &out);
+                if (br->count == 0) br->dir = BRIDGE_DIR_NONE;
+                led->state = SLOT_ONBOARD;
+
+                sh->onboard_passengers += 1;
+                if (has_bike) sh->onboard_bikes += 1;
+                led->onboard = 1;
+
+                const int onboard = sh->onboard_passengers;
+                const int bikes = sh->onboard_bikes;
+                rec.trip = sh->trip_no;
+                rec.ship = (int8_t)ship;
+
+                state_unlock(ipc);
+                rec.t_board = now_ns_monotonic();
+
+                ledger_drop_units(ipc, led);
+                ev_publish(ipc->shm, ship, EV_BOARD, id, onboard, bikes);
+                // planer: zwolnione jednostki mostka = miejsce na kolejny bilet
+                if (planner) captain_notify(ipc->shm, ship);
+                boarded = 1;
+
+                logf(lg, "passenger", "BOARDED ship=%d (onboard=%d bikes=%d)", (int)ship, onboard, bikes);
+                break;
+            }
+
+            state_unlock(ipc);
+            (void)slot_wait(ipc->shm, id, seq, 50);
+        }
+
+        break; // po wejsciu/odmowie konczymy probe
+    }
+
+    if (!boarded) {
+        logf(lg, "passenger", "did not board (timeout or shutdown)");
+        goto finish;
+    }
+
+    // Czekaj na UNLOADING i wyjdz ze statku (DIR_OUT)
+    while (!g_exit) {
+        const uint32_t pseq = phase_seq(ipc->shm);
+        if (state_lock(ipc) != 0) goto finish;
+        phase_t ph = sh->phase;
+        int shutdown = ipc->shm->shutdown;
+        state_unlock(ipc);
+
+        if (shutdown || ph == PHASE_END) goto finish;
+        if (ph == PHASE_UNLOADING) break;
+        (void)phase_wait(ipc->shm, pseq, 100);
+    }
+
+    // zejscie: najmniej zajety trap (ksiega bez jednostek - led->gw mozna przestawic pod mutexem)
+    if (state_lock(ipc) != 0) goto finish;
+    gw = ship_pick_gangway(ipc->shm, ship, BRIDGE_DIR_OUT);
+    led->gw = (uint8_t)gw;
+    state_unlock(ipc);
+
+    // zajmij units trapu
+    // ===== FIX: atomowo (trywait+rollback), zeby nie blokowac sie trzymajac 1/2 zasobu =====
+    {
+        int gotu = acquire_units_atomic(&sh->sync.bridge[gw], units);
+        if (gotu < 0) goto finish;
+        led->held_units = (uint8_t)gotu;
+    }
+
+    if (state_lock(ipc) != 0) goto finish;
+    if (sh->bridge[gw].dir == BRIDGE_DIR_NONE) sh->bridge[gw].dir = BRIDGE_DIR_OUT;
+
+    // wejscie od strony statku
+    bridge_node_t node2;
+    node2.pid = me;
+    node2.slot = id;
+    node2.units = (uint8_t)units;
+    node2.evicting = 0;
+    (void)bridge_push_front(ipc->shm, ship, gw, node2);
+    state_unlock(ipc);
+    ev_publish(ipc->shm, ship, EV_BRIDGE_ENTER, id, BRIDGE_DIR_OUT, units);
+
+    // zejscie na lad: tylko back w DIR_OUT (budzi nas ten, kto zszedl przed nami)
+    for (;;) {
+        if (g_exit) goto finish;
+
+        const uint32_t seq = slot_seq(ipc->shm, id);
+        if (state_lock(ipc) != 0) goto finish;
+        if (bridge_is_back(ipc->shm, ship, gw, id)) {
+            bridge_node_t out;
+            bridge_pop_back(ipc->shm, ship, gw, &out);
+            if (sh->bridge[gw].count == 0) sh->bridge[gw].dir = BRIDGE_DIR_NONE;
+            led->state = SLOT_LEFT;
+
+            sh->onboard_passengers -= 1;
+            if (has_bike) sh->onboard_bikes -= 1;
+            led->onboard = 0;
+
+            state_unlock(ipc);
+
+            // zwolnij mostek, miejsce na statku i rower
+            ledger_rollback(ipc, led);
+            ev_publish(ipc->shm, ship, EV_LEAVE_SHIP, id, 0, 0);
+            rec.t_leave = now_ns_monotonic();
+
+            logf(lg, "passenger", "LEFT ship and freed resources");
+            break;
+        }
+
+        state_unlock(ipc);
+        (void)slot_wait(ipc->shm, id, seq, 50);
+    }
+
+finish:
+    // Cleanup wg ksiegi (zeby nie zostawic zasobow przy SIGTERM); ta sama sciezka
+    // co odzyskiwanie slotu martwego pasazera, tylko wykonana przez wlasciciela
+    if (state_lock(ipc) == 0) {
+        (void)slot_reclaim_locked(ipc->shm, id);
+        state_unlock(ipc);
+    }
+    ev_publish(ipc->shm, boarded ? ship : -1, EV_PASSENGER_EXIT, id, boarded, 0);
+    (void)results_pax_write(res, id, &rec);
+
+    // log zakonczenia procesu pasazera
+    logf(lg, "passenger",
+        "EXIT (boarded=%d exit_flag=%d)",
+        boarded, (int)g_exit);
+    return boarded;
+}
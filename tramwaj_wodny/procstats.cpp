@@ -0,0 +1,138 @@
+#include "procstats.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int64_t tv_us(const struct timeval* tv) {
+    return (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+static int64_t cpu_us(const child_usage_t* c) { return c->user_us + c->sys_us; }
+
+const char* proc_role_str(proc_role_t r) {
+    switch (r) {
+    case ROLE_CAPTAIN: return "captain";
+    case ROLE_DISPATCHER: return "dispatcher";
+    case ROLE_PASSENGER: return "passenger";
+    case ROLE_CHECKER: return "checker";
+    default: return "?";
+    }
+}
+
+int procstats_init(procstats_t* ps, int cap) {
+    if (!ps || cap < 0) return -1;
+    memset(ps, 0, sizeof(*ps));
+    if (cap == 0) return 0;
+    ps->items = (child_usage_t*)calloc((size_t)cap, sizeof(child_usage_t));
+    if (!ps->items) { perror("calloc(procstats)"); return -1; }
+    ps->cap = cap;
+    return 0;
+}
+
+void procstats_free(procstats_t* ps) {
+    if (!ps) return;
+    free(ps->items);
+    ps->items = NULL;
+    ps->count = ps->cap = 0;
+}
+
+void procstats_add(procstats_t* ps, pid_t pid, proc_role_t role, const struct rusage* ru) {
+    if (!ps || !ru || ps->count >= ps->cap) return;
+    child_usage_t* c = &ps->items[ps->count++];
+    c->pid = pid;
+    c->role = role;
+    c->user_us = tv_us(&ru->ru_utime);
+    c->sys_us = tv_us(&ru->ru_stime);
+    c->nvcsw = ru->ru_nvcsw;
+    c->nivcsw = ru->ru_nivcsw;
+    c->maxrss_kb = ru->ru_maxrss;
+}
+
+static int cmp_cpu_desc(const void* a, const void* b) {
+    int64_t x = cpu_us((const child_usage_t*)a), y = cpu_us((const child_usage_t*)b);
+    return (x < y) - (x > y);
+}
+
+// percentyl metoda "nearest rank" na posortowanej tablicy
+static int64_t pctl(const int64_t* sorted, int n, int p) {
+    if (n <= 0) return 0;
+    int rank = (p * n + 99) / 100;
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static void report_pctl(logger_t* lg, proc_role_t role, const char* metric, int64_t* vals, int n, int64_t div) {
+    qsort(vals, (size_t)n, sizeof(int64_t), cmp_i64);
+    logf(lg, "launcher", "RUSAGE PCTL role=%s metric=%s n=%d p50=%lld p90=%lld p99=%lld max=%lld",
+        proc_role_str(role), metric, n,
+        (long long)(pctl(vals, n, 50) / div), (long long)(pctl(vals, n, 90) / div),
+        (long long)(pctl(vals, n, 99) / div), (long long)(vals[n - 1] / div));
+}
+
+void procstats_report(const procstats_t* ps, logger_t* lg, int top_n) {
+    if (!ps || !lg) return;
+
+    // Sumy per rola
+    int64_t n[ROLE_COUNT] = { 0 }, user[ROLE_COUNT] = { 0 }, sys[ROLE_COUNT] = { 0 };
+    int64_t vcs[ROLE_COUNT] = { 0 }, ivcs[ROLE_COUNT] = { 0 }, rss[ROLE_COUNT] = { 0 };
+    int64_t all_cpu = 0;
+    for (int i = 0; i < ps->count; i++) {
+        const child_usage_t* c = &ps->items[i];
+        n[c->role]++;
+        user[c->role] += c->user_us;
+        sys[c->role] += c->sys_us;
+        vcs[c->role] += c->nvcsw;
+        ivcs[c->role] += c->nivcsw;
+        if (c->maxrss_kb > rss[c->role]) rss[c->role] = c->maxrss_kb;
+        all_cpu += cpu_us(c);
+    }
+
+    for (int r = 0; r < ROLE_COUNT; r++) {
+        int64_t cpu = user[r] + sys[r];
+        logf(lg, "launcher",
+            "RUSAGE role=%s n=%lld cpu_ms=%lld user_ms=%lld sys_ms=%lld nvcsw=%lld nivcsw=%lld maxrss_kb=%lld share=%.1f%%",
+            proc_role_str((proc_role_t)r), (long long)n[r], (long long)(cpu / 1000),
+            (long long)(user[r] / 1000), (long long)(sys[r] / 1000),
+            (long long)vcs[r], (long long)ivcs[r], (long long)rss[r],
+            all_cpu > 0 ? 100.0 * (double)cpu / (double)all_cpu : 0.0);
+    }
+
+    // Percentyle dla floty pasazerow (jedyna rola z wieloma procesami)
+    int np = (int)n[ROLE_PASSENGER];
+    if (np > 0) {
+        int64_t* vals = (int64_t*)malloc((size_t)np * sizeof(int64_t));
+        if (vals) {
+            int k = 0;
+            for (int i = 0; i < ps->count; i++) if (ps->items[i].role == ROLE_PASSENGER) vals[k++] = cpu_us(&ps->items[i]);
+            report_pctl(lg, ROLE_PASSENGER, "cpu_us", vals, np, 1);
+
+            k = 0;
+            for (int i = 0; i < ps->count; i++) if (ps->items[i].role == ROLE_PASSENGER) vals[k++] = ps->items[i].nvcsw + ps->items[i].nivcsw;
+            report_pctl(lg, ROLE_PASSENGER, "csw", vals, np, 1);
+
+            k = 0;
+            for (int i = 0; i < ps->count; i++) if (ps->items[i].role == ROLE_PASSENGER) vals[k++] = ps->items[i].maxrss_kb;
+            report_pctl(lg, ROLE_PASSENGER, "maxrss_kb", vals, np, 1);
+            free(vals);
+        }
+    }
+
+    // Top N procesow wg CPU
+    if (top_n > 0 && ps->count > 0) {
+        child_usage_t* tmp = (child_usage_t*)malloc((size_t)ps->count * sizeof(child_usage_t));
+        if (tmp) {
+            memcpy(tmp, ps->items, (size_t)ps->count * sizeof(child_usage_t));
+            qsort(tmp, (size_t)ps->count, sizeof(child_usage_t), cmp_cpu_desc);
+            int lim = (top_n < ps->count) ? top_n : ps->count;
+            for (int i = 0; i < lim; i++) {
+                logf(lg, "launcher", "RUSAGE TOP rank=%d pid=%d role=%s cpu_us=%lld csw=%lld maxrss_kb=%lld",
+                    i + 1, (int)tmp[i].pid, proc_role_str(tmp[i].role), (long long)cpu_us(&tmp[i]),
+                    (long long)(tmp[i].nvcsw + tmp[i].nivcsw), (long long)tmp[i].maxrss_kb);
+            }
+            free(tmp);
+        }
+    }
+}
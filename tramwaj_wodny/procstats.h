@@ -0,0 +1,57 @@
+#ifndef PROCSTATS_H
+#define PROCSTATS_H
+
+// Rozliczanie zasobow procesow potomnych launchera (wait4 + rusage).
+// Launcher dopisuje kazde zebrane dziecko, a przy zamknieciu wypisuje
+// podsumowanie: sumy per rola, percentyle dla floty pasazerow, top procesy.
+
+#include "logging.h"
+
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    typedef enum {
+        ROLE_CAPTAIN = 0,
+        ROLE_DISPATCHER = 1,
+        ROLE_PASSENGER = 2,
+        ROLE_CHECKER = 3,
+        ROLE_COUNT = 4
+    } proc_role_t;
+
+    typedef struct {
+        pid_t pid;
+        proc_role_t role;
+        int64_t user_us;
+        int64_t sys_us;
+        int64_t nvcsw;
+        int64_t nivcsw;
+        int64_t maxrss_kb;
+    } child_usage_t;
+
+    typedef struct {
+        child_usage_t* items;
+        int count;
+        int cap;
+    } procstats_t;
+
+    int procstats_init(procstats_t* ps, int cap);
+    void procstats_free(procstats_t* ps);
+
+    // Dopisz zebrane dziecko (rusage z wait4)
+    void procstats_add(procstats_t* ps, pid_t pid, proc_role_t role, const struct rusage* ru);
+
+    // Podsumowanie do logu: linie "RUSAGE ..." (sumy per rola, percentyle, top N)
+    void procstats_report(const procstats_t* ps, logger_t* lg, int top_n);
+
+    const char* proc_role_str(proc_role_t r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PROCSTATS_H
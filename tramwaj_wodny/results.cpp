@@ -0,0 +1,192 @@
+#include "results.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Szerokosc kolumny w bajtach (kolejnosc jak results_col_t)
+static const uint8_t k_col_width[RES_COL_COUNT] = {
+    4, 4, 4, 4, 4, 8, 8, 8, 8, 8, 4,    // RT_*
+    1, 4, 1, 1, 4, 8, 8, 8, 1           // RP_*
+};
+
+static int col_is_trip(int c) { return c < RP_VALID; }
+
+static size_t align_up(size_t v, size_t a) {
+    return (v + a - 1) & ~(a - 1);
+}
+
+static void results_layout(results_header_t* h, uint32_t trips_cap, uint32_t pax_cap) {
+    memset(h, 0, sizeof(*h));
+    h->magic = RESULTS_MAGIC;
+    h->version = RESULTS_VERSION;
+    h->trips_cap = trips_cap;
+    h->pax_cap = pax_cap;
+    size_t end = align_up(sizeof(results_header_t), 64);
+    for (int c = 0; c < RES_COL_COUNT; c++) {
+        h->col_off[c] = end;
+        end = align_up(end + (size_t)k_col_width[c] * (col_is_trip(c) ? trips_cap : pax_cap), 64);
+    }
+    h->total_size = end;
+}
+
+static void* col(results_header_t* h, int c) {
+    return (char*)h + h->col_off[c];
+}
+
+int results_create(const char* path, uint32_t trips_cap, uint32_t pax_cap) {
+    if (!path) return -1;
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0) { perror("open(results)"); return -1; }
+
+    results_header_t h;
+    results_layout(&h, trips_cap, pax_cap);
+    if (ftruncate(fd, (off_t)h.total_size) != 0) { perror("ftruncate(results)"); close(fd); return -1; }
+
+    void* p = mmap(NULL, (size_t)h.total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) { perror("mmap(results)"); close(fd); return -1; }
+    results_header_t* hdr = (results_header_t*)p;
+    memcpy(hdr, &h, sizeof(h));
+    // kolumny czasow/rejsu pasazerow: -1 = brak (ftruncate daje zera)
+    memset(col(hdr, RP_TRIP), 0xff, (size_t)pax_cap * 4);
+    memset(col(hdr, RP_T_BOARD), 0xff, (size_t)pax_cap * 8);
+    memset(col(hdr, RP_T_LEAVE), 0xff, (size_t)pax_cap * 8);
+    memset(col(hdr, RP_SHIP), 0xff, (size_t)pax_cap);
+    munmap(p, (size_t)h.total_size);
+    return fd;
+}
+
+static int results_check(const results_header_t* h, size_t mapped) {
+    if (h->magic != RESULTS_MAGIC || h->version != RESULTS_VERSION || h->total_size != mapped) {
+        fprintf(stderr, "results: bad magic/version/size\n");
+        return -1;
+    }
+    results_header_t expect;
+    results_layout(&expect, h->trips_cap, h->pax_cap);
+    if (memcmp(expect.col_off, h->col_off, sizeof(h->col_off)) != 0 || expect.total_size != h->total_size) {
+        fprintf(stderr, "results: bad column layout\n");
+        return -1;
+    }
+    return 0;
+}
+
+int results_attach(results_writer_t* w, int fd) {
+    memset(w, 0, sizeof(*w));
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { perror("fstat(results)"); return -1; }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) { perror("mmap(results)"); return -1; }
+    close(fd);
+    if (results_check((const results_header_t*)p, (size_t)st.st_size) != 0) {
+        munmap(p, (size_t)st.st_size);
+        return -1;
+    }
+    w->hdr = (results_header_t*)p;
+    w->size = (size_t)st.st_size;
+    return 0;
+}
+
+void results_detach(results_writer_t* w) {
+    if (w->hdr) munmap(w->hdr, w->size);
+    w->hdr = NULL;
+    w->size = 0;
+}
+
+int results_trip_append(results_writer_t* w, const trip_rec_t* r) {
+    results_header_t* h = w->hdr;
+    if (!h) return 0;
+    const uint32_t row = __atomic_fetch_add(&h->trips_reserved, 1, __ATOMIC_RELAXED);
+    if (row >= h->trips_cap) return -1;
+    ((int32_t*)col(h, RT_TRIP))[row] = r->trip;
+    ((int32_t*)col(h, RT_DIR))[row] = r->dir;
+    ((int32_t*)col(h, RT_PAX))[row] = r->pax;
+    ((int32_t*)col(h, RT_BIKES))[row] = r->bikes;
+    ((int32_t*)col(h, RT_LEFT_BRIDGE))[row] = r->left_bridge;
+    ((int64_t*)col(h, RT_T_LOADING))[row] = r->t_loading;
+    ((int64_t*)col(h, RT_T_DEPARTING))[row] = r->t_departing;
+    ((int64_t*)col(h, RT_T_SAILING))[row] = r->t_sailing;
+    ((int64_t*)col(h, RT_T_UNLOADING))[row] = r->t_unloading;
+    ((int64_t*)col(h, RT_T_DONE))[row] = r->t_done;
+    ((int32_t*)col(h, RT_SHIP))[row] = r->ship;
+    // trips_rows = prefiks gotowych wierszy: czekamy na kapitanow z wczesniejsza rezerwacja
+    // (zapis kilkunastu slow, rejsy koncza sie co najmniej T2 od siebie - kolizja jest rzadka)
+    while (__atomic_load_n(&h->trips_rows, __ATOMIC_ACQUIRE) != row) sched_yield();
+    __atomic_store_n(&h->trips_rows, row + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int results_pax_write(results_writer_t* w, int32_t id, const pax_rec_t* r) {
+    results_header_t* h = w->hdr;
+    if (!h) return 0;
+    if (id < 0 || (uint32_t)id >= h->pax_cap) return -1;
+    ((int32_t*)col(h, RP_PID))[id] = r->pid;
+    ((int8_t*)col(h, RP_DIR))[id] = r->dir;
+    ((uint8_t*)col(h, RP_BIKE))[id] = r->bike;
+    ((int32_t*)col(h, RP_TRIP))[id] = r->trip;
+    ((int64_t*)col(h, RP_T_ARRIVE))[id] = r->t_arrive;
+    ((int64_t*)col(h, RP_T_BOARD))[id] = r->t_board;
+    ((int64_t*)col(h, RP_T_LEAVE))[id] = r->t_leave;
+    ((int8_t*)col(h, RP_SHIP))[id] = r->ship;
+    __atomic_store_n(&((uint8_t*)col(h, RP_VALID))[id], 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&h->pax_rows, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+int results_open(const char* path, results_view_t* v) {
+    memset(v, 0, sizeof(*v));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { perror("open(results)"); return -1; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(results_header_t)) {
+        fprintf(stderr, "results: %s too small\n", path);
+        close(fd);
+        return -1;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) { perror("mmap(results)"); return -1; }
+    results_header_t* h = (results_header_t*)p;
+    if (results_check(h, (size_t)st.st_size) != 0) {
+        munmap(p, (size_t)st.st_size);
+        return -1;
+    }
+
+    v->base = p;
+    v->size = (size_t)st.st_size;
+    v->trips = __atomic_load_n(&h->trips_rows, __ATOMIC_ACQUIRE);
+    v->pax_cap = h->pax_cap;
+    v->pax_rows = __atomic_load_n(&h->pax_rows, __ATOMIC_ACQUIRE);
+
+    v->trip_no = (const int32_t*)col(h, RT_TRIP);
+    v->trip_dir = (const int32_t*)col(h, RT_DIR);
+    v->trip_pax = (const int32_t*)col(h, RT_PAX);
+    v->trip_bikes = (const int32_t*)col(h, RT_BIKES);
+    v->trip_left_bridge = (const int32_t*)col(h, RT_LEFT_BRIDGE);
+    v->t_loading = (const int64_t*)col(h, RT_T_LOADING);
+    v->t_departing = (const int64_t*)col(h, RT_T_DEPARTING);
+    v->t_sailing = (const int64_t*)col(h, RT_T_SAILING);
+    v->t_unloading = (const int64_t*)col(h, RT_T_UNLOADING);
+    v->t_done = (const int64_t*)col(h, RT_T_DONE);
+    v->trip_ship = (const int32_t*)col(h, RT_SHIP);
+
+    v->pax_valid = (const uint8_t*)col(h, RP_VALID);
+    v->pax_pid = (const int32_t*)col(h, RP_PID);
+    v->pax_dir = (const int8_t*)col(h, RP_DIR);
+    v->pax_bike = (const uint8_t*)col(h, RP_BIKE);
+    v->pax_trip = (const int32_t*)col(h, RP_TRIP);
+    v->pax_t_arrive = (const int64_t*)col(h, RP_T_ARRIVE);
+    v->pax_t_board = (const int64_t*)col(h, RP_T_BOARD);
+    v->pax_t_leave = (const int64_t*)col(h, RP_T_LEAVE);
+    v->pax_ship = (const int8_t*)col(h, RP_SHIP);
+    return 0;
+}
+
+void results_close(results_view_t* v) {
+    if (v->base) munmap(v->base, v->size);
+    memset(v, 0, sizeof(*v));
+}
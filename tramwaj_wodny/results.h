@@ -0,0 +1,135 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+// Wyniki przebiegu w pliku kolumnowym (--results <path>), zamiast parsowania TRIP SUMMARY z logu.
+// Plik = naglowek + kolumny stalej szerokosci, kazda ciagla tablica o pojemnosci znanej z gory
+// (rejsy: F*R, pasazerowie: P). Launcher tworzy plik i przekazuje dzieciom deskryptor (--results-fd);
+// kapitanowie floty dopisuja wiersze rejsow (O(1), kolejnosc zakonczenia), pasazer zapisuje swoj
+// wiersz (= --id) przy wyjsciu.
+// Czytnik mapuje plik tylko do odczytu i dostaje gotowe wskazniki na kolumny (bez parsowania).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    enum { RESULTS_MAGIC = 0x53455254 };   // "TRES"
+    enum { RESULTS_VERSION = 3 };   // 3: kolumny statku (RT_SHIP/RP_SHIP); 2: czasy w ns (1: ms)
+
+    // Kolumny: najpierw tabela rejsow (RT_*), potem pasazerow (RP_*)
+    typedef enum {
+        RT_TRIP = 0,        // int32 numer rejsu
+        RT_DIR,             // int32 dir_t
+        RT_PAX,             // int32 pasazerowie na pokladzie
+        RT_BIKES,           // int32 rowery na pokladzie
+        RT_LEFT_BRIDGE,     // int32 zdjeci z mostka przy odplywie
+        RT_T_LOADING,       // int64 ns (now_ns_monotonic) poczatku fazy
+        RT_T_DEPARTING,
+        RT_T_SAILING,       // -1 gdy rejs przerwany (stop w LOADING)
+        RT_T_UNLOADING,
+        RT_T_DONE,          // koniec rozladunku
+        RT_SHIP,            // int32 statek floty
+        RP_VALID,           // uint8 1 = pasazer zapisal wiersz
+        RP_PID,             // int32
+        RP_DIR,             // int8 (-1 dowolny)
+        RP_BIKE,            // uint8
+        RP_TRIP,            // int32 rejs, ktorym plynal (-1 nie wszedl)
+        RP_T_ARRIVE,        // int64 ns start procesu
+        RP_T_BOARD,         // int64 ns wejscie na statek (-1)
+        RP_T_LEAVE,         // int64 ns zejscie na lad (-1)
+        RP_SHIP,            // int8 statek, ktorym plynal (-1 nie wszedl)
+        RES_COL_COUNT
+    } results_col_t;
+
+    typedef struct {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t trips_cap;
+        uint32_t trips_rows;        // zapisane wiersze rejsow (publikowane po zapisie kolumn)
+        uint32_t trips_reserved;    // wiersze zajete przez kapitanow (>= trips_rows)
+        uint32_t pax_cap;
+        uint32_t pax_rows;          // ilu pasazerow zapisalo swoj wiersz
+        uint32_t pad;
+        uint64_t total_size;
+        uint64_t col_off[RES_COL_COUNT];
+    } results_header_t;
+
+    typedef struct {
+        int32_t trip, dir, pax, bikes, left_bridge;
+        int32_t ship;
+        int64_t t_loading, t_departing, t_sailing, t_unloading, t_done;
+    } trip_rec_t;
+
+    typedef struct {
+        int32_t pid;
+        int8_t dir;
+        uint8_t bike;
+        int32_t trip;
+        int8_t ship;
+        int64_t t_arrive, t_board, t_leave;
+    } pax_rec_t;
+
+    // ======= Zapis =======
+    typedef struct {
+        results_header_t* hdr;      // NULL = wyniki wylaczone (wszystkie zapisy sa no-op)
+        size_t size;
+    } results_writer_t;
+
+    // Launcher: tworzy plik o pojemnosci trips_cap/pax_cap i zwraca deskryptor bez FD_CLOEXEC
+    // (dziedziczony przez dzieci); -1 blad
+    int results_create(const char* path, uint32_t trips_cap, uint32_t pax_cap);
+
+    // Dzieci: fd < 0 -> writer wylaczony; 0 ok, -1 blad (zly plik)
+    int results_attach(results_writer_t* w, int fd);
+    void results_detach(results_writer_t* w);
+
+    // Kapitan: dopisuje kolejny wiersz rejsu (pelna tabela -> -1); wielu kapitanow naraz:
+    // wiersz rezerwowany atomowo, publikowany w kolejnosci rezerwacji
+    int results_trip_append(results_writer_t* w, const trip_rec_t* r);
+
+    // Pasazer: wiersz o indeksie id (= slot w SHM)
+    int results_pax_write(results_writer_t* w, int32_t id, const pax_rec_t* r);
+
+    // ======= Odczyt =======
+    typedef struct {
+        void* base;
+        size_t size;
+        uint32_t trips;             // liczba zapisanych rejsow
+        uint32_t pax_cap;           // liczba wierszy pasazerow (P); wazne te z pax_valid[i] == 1
+        uint32_t pax_rows;
+
+        const int32_t* trip_no;
+        const int32_t* trip_dir;
+        const int32_t* trip_pax;
+        const int32_t* trip_bikes;
+        const int32_t* trip_left_bridge;
+        const int64_t* t_loading;
+        const int64_t* t_departing;
+        const int64_t* t_sailing;
+        const int64_t* t_unloading;
+        const int64_t* t_done;
+        const int32_t* trip_ship;
+
+        const uint8_t* pax_valid;
+        const int32_t* pax_pid;
+        const int8_t* pax_dir;
+        const uint8_t* pax_bike;
+        const int32_t* pax_trip;
+        const int64_t* pax_t_arrive;
+        const int64_t* pax_t_board;
+        const int64_t* pax_t_leave;
+        const int8_t* pax_ship;
+    } results_view_t;
+
+    // mmap tylko do odczytu + wskazniki na kolumny; 0 ok, -1 blad
+    int results_open(const char* path, results_view_t* v);
+    void results_close(results_view_t* v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RESULTS_H
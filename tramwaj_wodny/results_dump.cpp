@@ -0,0 +1,104 @@
+// Podglad pliku wynikow kolumnowych (--results): tabela rejsow + podsumowanie pasazerow.
+// Czyta kolumny bezposrednio z mapowania (results_open), bez parsowania tekstu.
+
+#include "results.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage:\n"
+        "  results_dump <file> [--passengers] [--csv]\n"
+        "  --passengers  wypisz tez wiersze pasazerow\n"
+        "  --csv         format CSV zamiast tabeli\n");
+}
+
+static int64_t dur(int64_t from, int64_t to) {
+    return (from >= 0 && to >= 0) ? to - from : -1;
+}
+
+// Kolumny czasu sa w ns; na wyjsciu ms z czescia ulamkowa (-1 = brak)
+static double ms(int64_t ns) {
+    return ns < 0 ? -1.0 : (double)ns / 1e6;
+}
+
+static void dump_trips(const results_view_t* v, int csv) {
+    if (csv) printf("ship,trip,dir,pax,bikes,left_bridge,load_ms,depart_ms,sail_ms,unload_ms\n");
+    else printf("%4s %6s %3s %5s %5s %6s %10s %10s %10s %10s\n",
+        "ship", "trip", "dir", "pax", "bikes", "left", "load_ms", "depart_ms", "sail_ms", "unload_ms");
+    for (uint32_t i = 0; i < v->trips; i++) {
+        const int64_t load = dur(v->t_loading[i], v->t_departing[i]);
+        const int64_t dep = dur(v->t_departing[i], v->t_sailing[i] >= 0 ? v->t_sailing[i] : v->t_unloading[i]);
+        const int64_t sail = dur(v->t_sailing[i], v->t_unloading[i]);
+        const int64_t unl = dur(v->t_unloading[i], v->t_done[i]);
+        printf(csv ? "%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f\n" : "%4d %6d %3d %5d %5d %6d %10.3f %10.3f %10.3f %10.3f\n",
+            v->trip_ship[i], v->trip_no[i], v->trip_dir[i], v->trip_pax[i], v->trip_bikes[i], v->trip_left_bridge[i],
+            ms(load), ms(dep), ms(sail), ms(unl));
+    }
+}
+
+static void dump_passengers(const results_view_t* v, int csv) {
+    if (csv) printf("id,pid,dir,bike,ship,trip,wait_ms,ride_ms\n");
+    else printf("%6s %8s %3s %4s %4s %6s %10s %10s\n", "id", "pid", "dir", "bike", "ship", "trip", "wait_ms", "ride_ms");
+    for (uint32_t i = 0; i < v->pax_cap; i++) {
+        if (!v->pax_valid[i]) continue;
+        printf(csv ? "%u,%d,%d,%d,%d,%d,%.3f,%.3f\n" : "%6u %8d %3d %4d %4d %6d %10.3f %10.3f\n",
+            i, v->pax_pid[i], (int)v->pax_dir[i], (int)v->pax_bike[i], (int)v->pax_ship[i], v->pax_trip[i],
+            ms(dur(v->pax_t_arrive[i], v->pax_t_board[i])),
+            ms(dur(v->pax_t_board[i], v->pax_t_leave[i])));
+    }
+}
+
+static void summary(const results_view_t* v) {
+    int64_t pax = 0, bikes = 0;
+    for (uint32_t i = 0; i < v->trips; i++) {
+        pax += v->trip_pax[i];
+        bikes += v->trip_bikes[i];
+    }
+
+    int64_t* wait = (int64_t*)malloc((size_t)(v->pax_cap ? v->pax_cap : 1) * sizeof(int64_t));
+    if (!wait) { perror("malloc"); return; }
+    int nw = 0, written = 0;
+    double sum = 0.0;
+    for (uint32_t i = 0; i < v->pax_cap; i++) {
+        if (!v->pax_valid[i]) continue;
+        written++;
+        if (v->pax_t_board[i] < 0) continue;
+        wait[nw] = v->pax_t_board[i] - v->pax_t_arrive[i];
+        sum += (double)wait[nw];
+        nw++;
+    }
+    printf("trips=%u pax=%lld bikes=%lld passengers_written=%d/%u boarded=%d",
+        v->trips, (long long)pax, (long long)bikes, written, v->pax_cap, nw);
+    if (nw > 0) {
+        qsort(wait, (size_t)nw, sizeof(int64_t), cmp_i64);
+        printf(" wait_mean_ms=%.3f wait_p50_ms=%.3f wait_p90_ms=%.3f",
+            sum / nw / 1e6, ms(wait[(nw - 1) / 2]), ms(wait[(nw * 9 - 1) / 10]));
+    }
+    printf("\n");
+    free(wait);
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    int show_pax = 0, csv = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--passengers") == 0) show_pax = 1;
+        else if (strcmp(argv[i], "--csv") == 0) csv = 1;
+        else if (strcmp(argv[i], "--help") == 0) { usage(); return 0; }
+        else if (!path && argv[i][0] != '-') path = argv[i];
+        else { fprintf(stderr, "Unknown arg: %s\n", argv[i]); usage(); return 2; }
+    }
+    if (!path) { usage(); return 2; }
+
+    results_view_t v;
+    if (results_open(path, &v) != 0) return 1;
+    dump_trips(&v, csv);
+    if (show_pax) dump_passengers(&v, csv);
+    if (!csv) summary(&v);
+    results_close(&v);
+    return 0;
+}
@@ -0,0 +1,266 @@
+#include "runner.h"
+#include "util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int64_t tv_ms(const struct timeval* tv) {
+    return (int64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000;
+}
+
+static void resolve_log_path(const run_spec_t* spec, char* out, size_t out_sz) {
+    if (spec->bin_dir && spec->log_path[0] != '/') {
+        snprintf(out, out_sz, "%s/%s", spec->bin_dir, spec->log_path);
+    }
+    else {
+        snprintf(out, out_sz, "%s", spec->log_path);
+    }
+}
+
+int runner_cpus_allowed(void) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) { perror("sched_getaffinity"); return 1; }
+    const int n = CPU_COUNT(&set);
+    return n > 0 ? n : 1;
+}
+
+pid_t runner_spawn(const run_spec_t* spec) {
+    if (!spec || !spec->log_path) return -1;
+
+    // argv: ./tramwaj <spec->argv...> --log <path> NULL
+    char* argvv[RUNNER_MAX_ARGS + 4];
+    int n = 0;
+    argvv[n++] = (char*)"./tramwaj";
+    for (int i = 0; spec->argv[i] && n < RUNNER_MAX_ARGS; i++) argvv[n++] = (char*)spec->argv[i];
+    argvv[n++] = (char*)"--log";
+    argvv[n++] = (char*)spec->log_path;
+    argvv[n] = NULL;
+
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork(tramwaj)"); return -1; }
+    if (pid == 0) {
+        if (spec->bin_dir && chdir(spec->bin_dir) != 0) { perror("chdir(bin_dir)"); _exit(127); }
+        if (spec->cpu_count > 0) {
+            // maska dziedziczona przez launcher i wszystkie jego dzieci (fork/execv);
+            // pierwsze cpu_count CPU z maski, ktora dostalismy (taskset/cgroup), a nie CPU 0..cpu_count-1
+            cpu_set_t allowed, set;
+            CPU_ZERO(&allowed);
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) { perror("sched_getaffinity"); _exit(127); }
+            CPU_ZERO(&set);
+            for (int c = 0, n = 0; c < CPU_SETSIZE && n < spec->cpu_count; c++) {
+                if (CPU_ISSET(c, &allowed)) { CPU_SET(c, &set); n++; }
+            }
+            if (sched_setaffinity(0, sizeof(set), &set) != 0) { perror("sched_setaffinity"); _exit(127); }
+        }
+        // dyspozytor czyta stdin - w pomiarach bez klawiatury (EOF)
+        int devnull = open("/dev/null", O_RDWR);
+        if (devnull >= 0) {
+            dup2(devnull, STDIN_FILENO);
+            if (spec->quiet) {
+                dup2(devnull, STDOUT_FILENO);
+                dup2(devnull, STDERR_FILENO);
+            }
+            if (devnull > STDERR_FILENO) close(devnull);
+        }
+        execv("./tramwaj", argvv);
+        perror("execv(./tramwaj)");
+        _exit(127);
+    }
+    return pid;
+}
+
+void runner_collect(const run_spec_t* spec, pid_t pid, int status, const struct rusage* ru,
+    int64_t wall_ms, run_result_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->first_board_ms = -1;
+    out->launcher_pid = pid;
+    out->wall_ms = wall_ms;
+    out->exit_status = status;
+
+    // rusage z wait4 obejmuje launcher + jego zebrane dzieci (captain/dispatcher/passenger)
+    out->cpu_user_ms = tv_ms(&ru->ru_utime);
+    out->cpu_sys_ms = tv_ms(&ru->ru_stime);
+    out->nvcsw = ru->ru_nvcsw;
+    out->nivcsw = ru->ru_nivcsw;
+    out->maxrss_kb = ru->ru_maxrss;
+
+    char log_path[512];
+    resolve_log_path(spec, log_path, sizeof(log_path));
+    (void)runner_parse_log(log_path, out);
+}
+
+int runner_run(const run_spec_t* spec, run_result_t* out) {
+    if (!spec || !out || !spec->log_path) return -1;
+    memset(out, 0, sizeof(*out));
+    out->first_board_ms = -1;
+
+    int64_t t0 = now_ms_monotonic();
+    pid_t pid = runner_spawn(spec);
+    if (pid < 0) return -1;
+
+    if (spec->kill_after_ms > 0) {
+        sleep_ms(spec->kill_after_ms);
+        if (kill(pid, SIGKILL) != 0) perror("kill(SIGKILL tramwaj)");
+    }
+
+    int status = 0;
+    struct rusage ru;
+    memset(&ru, 0, sizeof(ru));
+    for (;;) {
+        pid_t w = wait4(pid, &status, 0, &ru);
+        if (w == pid) break;
+        if (w < 0 && errno == EINTR) continue;
+        perror("wait4(tramwaj)");
+        return -1;
+    }
+    runner_collect(spec, pid, status, &ru, now_ms_monotonic() - t0, out);
+    return 0;
+}
+
+static int line_has(const char* line, const char* needle) {
+    return strstr(line, needle) != NULL;
+}
+
+// Zdarzenie pasazera do liczenia opoznienia wejscia (start / BOARDED)
+typedef struct {
+    int32_t pid;
+    int32_t kind;   // 0 start, 1 boarded
+    int64_t ts;
+} pass_ev_t;
+
+static int cmp_pass_ev(const void* a, const void* b) {
+    const pass_ev_t* x = (const pass_ev_t*)a;
+    const pass_ev_t* y = (const pass_ev_t*)b;
+    if (x->pid != y->pid) return (x->pid > y->pid) - (x->pid < y->pid);
+    return (x->kind > y->kind) - (x->kind < y->kind);
+}
+
+static int push_ev(pass_ev_t** evs, int* n, int* cap, int32_t pid, int32_t kind, int64_t ts) {
+    if (*n >= *cap) {
+        int nc = (*cap > 0) ? *cap * 2 : 1024;
+        pass_ev_t* p = (pass_ev_t*)realloc(*evs, (size_t)nc * sizeof(pass_ev_t));
+        if (!p) return -1;
+        *evs = p;
+        *cap = nc;
+    }
+    (*evs)[*n].pid = pid;
+    (*evs)[*n].kind = kind;
+    (*evs)[*n].ts = ts;
+    (*n)++;
+    return 0;
+}
+
+static void compute_board_latency(pass_ev_t* evs, int n, run_result_t* out) {
+    out->board_lat_mean_ms = -1.0;
+    out->board_lat_p50_ms = out->board_lat_p90_ms = -1;
+    if (n == 0) return;
+    qsort(evs, (size_t)n, sizeof(pass_ev_t), cmp_pass_ev);
+
+    int64_t* lat = (int64_t*)malloc((size_t)n * sizeof(int64_t));
+    if (!lat) return;
+    int nl = 0;
+    double sum = 0.0;
+    for (int i = 0; i + 1 < n; i++) {
+        if (evs[i].pid == evs[i + 1].pid && evs[i].kind == 0 && evs[i + 1].kind == 1) {
+            lat[nl] = evs[i + 1].ts - evs[i].ts;
+            sum += (double)lat[nl];
+            nl++;
+        }
+    }
+    if (nl > 0) {
+        qsort(lat, (size_t)nl, sizeof(int64_t), cmp_i64);
+        out->board_lat_mean_ms = sum / (double)nl;
+        out->board_lat_p50_ms = lat[(nl - 1) / 2];
+        out->board_lat_p90_ms = lat[(nl * 9 - 1) / 10];
+    }
+    free(lat);
+}
+
+int runner_parse_log(const char* path, run_result_t* out) {
+    if (!path || !out) return -1;
+    FILE* f = fopen(path, "r");
+    if (!f) { perror("fopen(log)"); return -1; }
+
+    out->first_log_ms = -1;
+    out->first_board_ms = -1;
+    out->trips = out->boarded = out->left_ship = out->passenger_exits = 0;
+    out->bike_trip_violations = 0;
+    out->evictions = 0;
+    out->util_sum = 0.0;
+    out->cpu_captain_ms = out->cpu_dispatcher_ms = out->cpu_passenger_ms = -1;
+    out->lock_contended_pct = out->lock_wait_ms = -1.0;
+
+    pass_ev_t* evs = NULL;
+    int nev = 0, cap = 0;
+
+    char line[2048];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] != '[') continue;
+        int64_t ts = (int64_t)strtoll(line + 1, NULL, 10);
+        if (out->first_log_ms < 0) out->first_log_ms = ts;
+        const char* pp = strstr(line, "pid=");
+        int32_t pid = pp ? (int32_t)strtol(pp + 4, NULL, 10) : 0;
+
+        if (line_has(line, "role=passenger start ")) {
+            (void)push_ev(&evs, &nev, &cap, pid, 0, ts);
+        }
+        else if (line_has(line, "BOARDED ship")) {
+            if (out->first_board_ms < 0) out->first_board_ms = ts;
+            out->boarded++;
+            (void)push_ev(&evs, &nev, &cap, pid, 1, ts);
+        }
+        else if (line_has(line, "LEFT ship and freed resources")) {
+            out->left_ship++;
+        }
+        else if (line_has(line, "role=passenger EXIT")) {
+            out->passenger_exits++;
+        }
+        else if (line_has(line, "left bridge due to evict") || line_has(line, "forced off bridge")) {
+            out->evictions++;
+        }
+        else if (line_has(line, "TRIP SUMMARY")) {
+            out->trips++;
+            if (!line_has(line, "bikes=0")) out->bike_trip_violations++;
+            const char* u = strstr(line, " util=");
+            if (u) out->util_sum += strtod(u + 6, NULL);
+        }
+        else if (line_has(line, "RUSAGE role=")) {
+            const char* cpu = strstr(line, "cpu_ms=");
+            if (!cpu) continue;
+            int64_t v = (int64_t)strtoll(cpu + 7, NULL, 10);
+            if (line_has(line, "RUSAGE role=captain ")) out->cpu_captain_ms = v;
+            else if (line_has(line, "RUSAGE role=dispatcher ")) out->cpu_dispatcher_ms = v;
+            else if (line_has(line, "RUSAGE role=passenger ")) out->cpu_passenger_ms = v;
+        }
+        else if (line_has(line, "LOCK impl=")) {
+            const char* c = strstr(line, " (");
+            const char* w = strstr(line, "wait_ms=");
+            if (c) out->lock_contended_pct = strtod(c + 2, NULL);
+            if (w) out->lock_wait_ms = strtod(w + 8, NULL);
+        }
+    }
+    fclose(f);
+
+    compute_board_latency(evs, nev, out);
+    free(evs);
+    return 0;
+}
+
+int runner_ipc_clean(pid_t launcher_pid) {
+    char path[256];
+    snprintf(path, sizeof(path), "/dev/shm/tramwaj_shm_%d", (int)launcher_pid);
+    if (access(path, F_OK) == 0) return 0;
+    // grupa procesow symulacji (pgid == pid launchera)
+    if (kill(-launcher_pid, 0) == 0 || errno != ESRCH) return 0;
+    return 1;
+}
@@ -0,0 +1,87 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+// Uruchamianie launchera (tramwaj) jako procesu potomnego i zbieranie metryk
+// z jednego przebiegu symulacji. Uzywane przez narzedzia pomiarowe (bench, scale, sweep).
+
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    enum { RUNNER_MAX_ARGS = 48 };
+
+    typedef struct {
+        const char* bin_dir;                 // katalog z binarkami (chdir przed execv), NULL = cwd
+        const char* log_path;                // plik logu symulacji (--log)
+        const char* argv[RUNNER_MAX_ARGS];   // argumenty tramwaj (bez argv[0] i bez --log), NULL-terminated
+        int kill_after_ms;                   // >0: SIGKILL launchera po tylu ms (scenariusz guardian)
+        int quiet;                           // 1: stdout/stderr dzieci -> /dev/null
+        int cpu_count;                       // >0: sched_setaffinity na pierwsze cpu_count CPU z maski procesu (dziedziczone przez cala grupe)
+    } run_spec_t;
+
+    typedef struct {
+        // Proces launchera (wait4 - obejmuje tez zebrane przez niego dzieci)
+        pid_t launcher_pid;
+        int exit_status;             // status z wait4
+        int64_t wall_ms;
+        int64_t cpu_user_ms;
+        int64_t cpu_sys_ms;
+        int64_t nvcsw;               // dobrowolne przelaczenia kontekstu
+        int64_t nivcsw;              // wymuszone przelaczenia kontekstu
+        int64_t maxrss_kb;
+
+        // Z logu symulacji
+        int64_t first_log_ms;        // znacznik pierwszego wpisu
+        int64_t first_board_ms;      // znacznik pierwszego "BOARDED ship" (-1 brak)
+        int32_t trips;               // liczba TRIP SUMMARY
+        int32_t boarded;             // liczba "BOARDED ship"
+        int32_t left_ship;           // liczba "LEFT ship and freed resources"
+        int32_t passenger_exits;     // liczba "role=passenger EXIT"
+        int32_t bike_trip_violations;// TRIP SUMMARY z bikes!=0 (wykorzystywane przez scenariusz K=1)
+        int32_t evictions;           // zejscia z mostka na CMD_EVICT + zdjecia sila po terminie
+        double util_sum;             // suma util= z TRIP SUMMARY (zapelnienie = util_sum / trips)
+
+        // Opoznienie wejscia: od "start" pasazera do "BOARDED ship" (ms, -1 brak)
+        double board_lat_mean_ms;
+        int64_t board_lat_p50_ms;
+        int64_t board_lat_p90_ms;
+
+        // Z podsumowania launchera "RUSAGE role=..." (-1 brak)
+        int64_t cpu_captain_ms;
+        int64_t cpu_dispatcher_ms;
+        int64_t cpu_passenger_ms;
+
+        // Z linii "LOCK impl=..." launchera: kontencja mutexu stanu (-1 brak)
+        double lock_contended_pct;
+        double lock_wait_ms;
+    } run_result_t;
+
+    // Uruchamia tramwaj, czeka na zakonczenie (wait4) i parsuje log.
+    // 0 ok, -1 blad uruchomienia
+    int runner_run(const run_spec_t* spec, run_result_t* out);
+
+    // Wersja nieblokujaca (wiele przebiegow naraz): fork+execv launchera, pid albo -1.
+    // Po wait4 wywolujacy przekazuje status/rusage/czas do runner_collect (rusage + log).
+    pid_t runner_spawn(const run_spec_t* spec);
+    void runner_collect(const run_spec_t* spec, pid_t pid, int status, const struct rusage* ru,
+        int64_t wall_ms, run_result_t* out);
+
+    // Liczba CPU w masce sched_getaffinity biezacego procesu (>= 1) - gorna granica cpu_count.
+    int runner_cpus_allowed(void);
+
+    // Parsowanie logu symulacji (wypelnia pola "z logu")
+    int runner_parse_log(const char* path, run_result_t* out);
+
+    // Czy w systemie zostaly po przebiegu obiekty IPC / procesy launchera.
+    // 1 = czysto, 0 = cos zostalo
+    int runner_ipc_clean(pid_t launcher_pid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RUNNER_H
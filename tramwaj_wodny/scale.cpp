@@ -0,0 +1,147 @@
+// Harness skalowalnosci: uruchamia ./tramwaj na siatce konfiguracji
+// (liczba pasazerow P x stosunek K/N x liczba CPU) i tabelaryzuje
+// przepustowosc, opoznienie wejscia na statek oraz efektywnosc CPU.
+// Maska CPU (sched_setaffinity) ustawiana jest na launcherze przed execv,
+// wiec dziedziczy ja cala grupa procesow symulacji. Os CPU siega najwyzej
+// do liczby CPU w masce harnessu (taskset/cgroup), a nie do CPU online.
+
+#include "common.h"
+#include "runner.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+enum { MAX_LIST = 16 };
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage:\n"
+        "  scale [--P <list>] [--kn <list>] [--cpus <list>] [--N <int>] [--M <int>] [--T1 <ms>] [--T2 <ms>]\n"
+        "        [--R <int>] [--bike-prob <0..1>] [--bin-dir <dir>] [--csv <file>] [--verbose]\n"
+        "Lists are comma separated, e.g. --P 100,1000,5000,10000 --kn 0.1,0.3 --cpus 1,2,4\n");
+}
+
+// Ten sam warunek co proc_limit_ok() w launcherze (P + captain + dispatcher + zapas)
+static int nproc_allows(int P) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NPROC, &rl) != 0) return 1;
+    if (rl.rlim_cur == RLIM_INFINITY) return 1;
+    return (unsigned long)(P + 2) + 20 <= (unsigned long)rl.rlim_cur;
+}
+
+int main(int argc, char** argv) {
+    int32_t Ps[MAX_LIST] = { 100, 1000, 5000, 10000 };
+    int nP = 4;
+    double kns[MAX_LIST] = { 0.1, 0.3 };
+    int nkn = 2;
+    int32_t cpus[MAX_LIST];
+    int ncpus = 0;
+
+    int32_t N = 100, M = 10, T1 = 1000, T2 = 500, R = 3;
+    double bike_prob = 0.2;
+    const char* bin_dir = NULL;
+    const char* csv_path = "scale.csv";
+    int verbose = 0;
+
+    const int32_t allowed = (int32_t)runner_cpus_allowed();
+    cpus[ncpus++] = 1;
+    if (allowed > 1) cpus[ncpus++] = allowed;
+
+    for (int i = 1; i < argc; i++) {
+        const char* k = argv[i];
+        int has_val = (i + 1) < argc;
+        int bad = 0;
+        if (strcmp(k, "--P") == 0 && has_val) bad = (nP = parse_i32_list(argv[++i], Ps, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--kn") == 0 && has_val) bad = (nkn = parse_double_list(argv[++i], kns, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--cpus") == 0 && has_val) bad = (ncpus = parse_i32_list(argv[++i], cpus, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--N") == 0 && has_val) bad = parse_i32(argv[++i], &N) != 0;
+        else if (strcmp(k, "--M") == 0 && has_val) bad = parse_i32(argv[++i], &M) != 0;
+        else if (strcmp(k, "--T1") == 0 && has_val) bad = parse_i32(argv[++i], &T1) != 0;
+        else if (strcmp(k, "--T2") == 0 && has_val) bad = parse_i32(argv[++i], &T2) != 0;
+        else if (strcmp(k, "--R") == 0 && has_val) bad = parse_i32(argv[++i], &R) != 0;
+        else if (strcmp(k, "--bike-prob") == 0 && has_val) bad = parse_double(argv[++i], &bike_prob) != 0;
+        else if (strcmp(k, "--bin-dir") == 0 && has_val) bin_dir = argv[++i];
+        else if (strcmp(k, "--csv") == 0 && has_val) csv_path = argv[++i];
+        else if (strcmp(k, "--verbose") == 0) verbose = 1;
+        else if (strcmp(k, "--help") == 0) { usage(); return 0; }
+        else { fprintf(stderr, "Unknown arg: %s\n", k); usage(); return 2; }
+        if (bad) { fprintf(stderr, "Invalid value for %s\n", k); usage(); return 2; }
+    }
+
+    FILE* csv = fopen(csv_path, "w");
+    if (!csv) { perror("fopen(csv)"); return 1; }
+    fprintf(csv, "P,N,K,cpus,status,wall_ms,boarded,pax_per_s,lat_mean_ms,lat_p50_ms,lat_p90_ms,cpu_ms,cpu_eff,pax_per_cpu_s\n");
+
+    printf("%6s %5s %5s %4s %9s %8s %9s %9s %8s %8s %9s %7s %11s\n",
+        "P", "N", "K", "cpus", "wall_ms", "boarded", "pax/s", "lat_mean", "lat_p50", "lat_p90", "cpu_ms", "cpu_eff", "pax/cpu_s");
+
+    for (int ip = 0; ip < nP; ip++) {
+        for (int ik = 0; ik < nkn; ik++) {
+            for (int ic = 0; ic < ncpus; ic++) {
+                int32_t P = Ps[ip];
+                int32_t K = (int32_t)(kns[ik] * (double)N + 0.5);
+                if (K < 1) K = 1;
+                if (K >= N) K = N - 1;
+                int32_t c = cpus[ic];
+
+                if (P > MAX_P || !nproc_allows(P) || c < 1 || c > allowed) {
+                    printf("%6d %5d %5d %4d  skipped (MAX_P / RLIMIT_NPROC / cpus)\n", P, N, K, c);
+                    fprintf(csv, "%d,%d,%d,%d,skipped,,,,,,,,,\n", P, N, K, c);
+                    continue;
+                }
+
+                char sN[16], sM[16], sK[16], sT1[16], sT2[16], sR[16], sP[16], sB[32];
+                snprintf(sN, sizeof(sN), "%d", N);
+                snprintf(sM, sizeof(sM), "%d", M);
+                snprintf(sK, sizeof(sK), "%d", K);
+                snprintf(sT1, sizeof(sT1), "%d", T1);
+                snprintf(sT2, sizeof(sT2), "%d", T2);
+                snprintf(sR, sizeof(sR), "%d", R);
+                snprintf(sP, sizeof(sP), "%d", P);
+                snprintf(sB, sizeof(sB), "%g", bike_prob);
+
+                char log_path[128];
+                snprintf(log_path, sizeof(log_path), "scale_P%d_K%d_c%d.log", P, K, c);
+
+                run_spec_t spec;
+                memset(&spec, 0, sizeof(spec));
+                const char* args[] = { "--N", sN, "--M", sM, "--K", sK, "--T1", sT1, "--T2", sT2,
+                    "--R", sR, "--P", sP, "--bike-prob", sB, NULL };
+                for (int a = 0; args[a]; a++) spec.argv[a] = args[a];
+                spec.bin_dir = bin_dir;
+                spec.log_path = log_path;
+                spec.quiet = verbose ? 0 : 1;
+                spec.cpu_count = c;
+
+                run_result_t rr;
+                if (runner_run(&spec, &rr) != 0) {
+                    printf("%6d %5d %5d %4d  failed\n", P, N, K, c);
+                    fprintf(csv, "%d,%d,%d,%d,failed,,,,,,,,,\n", P, N, K, c);
+                    continue;
+                }
+
+                double wall_s = (double)rr.wall_ms / 1000.0;
+                int64_t cpu_ms = rr.cpu_user_ms + rr.cpu_sys_ms;
+                double pax_s = wall_s > 0.0 ? (double)rr.boarded / wall_s : 0.0;
+                double eff = (rr.wall_ms > 0) ? (double)cpu_ms / ((double)rr.wall_ms * (double)c) : 0.0;
+                double pax_cpu = cpu_ms > 0 ? (double)rr.boarded * 1000.0 / (double)cpu_ms : 0.0;
+
+                printf("%6d %5d %5d %4d %9lld %8d %9.2f %9.1f %8lld %8lld %9lld %7.2f %11.2f\n",
+                    P, N, K, c, (long long)rr.wall_ms, rr.boarded, pax_s, rr.board_lat_mean_ms,
+                    (long long)rr.board_lat_p50_ms, (long long)rr.board_lat_p90_ms, (long long)cpu_ms, eff, pax_cpu);
+                fflush(stdout);
+                fprintf(csv, "%d,%d,%d,%d,ok,%lld,%d,%.3f,%.3f,%lld,%lld,%lld,%.4f,%.3f\n",
+                    P, N, K, c, (long long)rr.wall_ms, rr.boarded, pax_s, rr.board_lat_mean_ms,
+                    (long long)rr.board_lat_p50_ms, (long long)rr.board_lat_p90_ms, (long long)cpu_ms, eff, pax_cpu);
+                fflush(csv);
+            }
+        }
+    }
+
+    fclose(csv);
+    return 0;
+}
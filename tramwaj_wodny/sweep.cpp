@@ -0,0 +1,288 @@
+// Przeglad parametrow (Monte-Carlo) do planowania przepustowosci: siatka
+// N x M x K x T1 x T2 x P x bike-prob, kazda konfiguracja powtarzana --reps razy.
+// Przebiegi sa od siebie niezalezne (IPC nazwane PID-em launchera), wiec naraz chodzi
+// do --jobs launcherow (domyslnie liczba CPU); kolejny startuje, gdy ktorys sie skonczy.
+// Powtorzenie r dostaje ziarno --seed + r (to samo dla kazdej konfiguracji, wiec
+// konfiguracje porownywane sa na tych samych ciagach pasazerow).
+// Wynik: dla kazdej konfiguracji srednia i 95% przedzial ufnosci (t-Studenta)
+// przepustowosci (pasazerowie/s), zapelnienia statku (util z TRIP SUMMARY) i liczby ewakuacji.
+
+#include "common.h"
+#include "runner.h"
+#include "util.h"
+
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum { MAX_LIST = 16, MAX_CONFIGS = 4096, MAX_JOBS = 256 };
+
+static volatile sig_atomic_t g_stop = 0;
+static void on_term(int) { g_stop = 1; }
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage:\n"
+        "  sweep [--N <list>] [--M <list>] [--K <list>] [--T1 <list>] [--T2 <list>] [--P <list>]\n"
+        "        [--bike-prob <list>] [--R <int>] [--reps <int>] [--jobs <int>] [--seed <u64>]\n"
+        "        [--bin-dir <dir>] [--csv <file>] [--keep-logs] [--verbose]\n"
+        "Lists are comma separated, e.g. --N 50,100 --K 5,10 --bike-prob 0,0.3 --reps 10\n");
+}
+
+// Kwantyl t-Studenta 0.975 dla df = 1..30, dalej przyblizenie normalne
+static double t975(int df) {
+    static const double t[30] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    if (df < 1) return 0.0;
+    return df <= 30 ? t[df - 1] : 1.960;
+}
+
+// Srednia i polowa szerokosci 95% CI (0 przy jednej probce)
+static void mean_ci(const double* v, int n, double* mean, double* half) {
+    *mean = *half = 0.0;
+    if (n <= 0) return;
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += v[i];
+    *mean = sum / n;
+    if (n < 2) return;
+    double ss = 0.0;
+    for (int i = 0; i < n; i++) ss += (v[i] - *mean) * (v[i] - *mean);
+    *half = t975(n - 1) * sqrt(ss / (n - 1)) / sqrt((double)n);
+}
+
+typedef struct {
+    int32_t N, M, K, T1, T2, P;
+    double bike;
+    int ok, failed;
+    double* thr;        // [reps] pasazerowie na sekunde
+    double* fill;       // [reps] srednie util rejsu
+    double* evict;      // [reps] ewakuacje z mostka
+} sweep_cfg_t;
+
+typedef struct {
+    pid_t pid;          // 0 = wolne miejsce
+    int cfg, rep;
+    int64_t t0;
+    run_spec_t spec;
+    char log_path[128];
+    char sv[9][32];     // napisy argumentow (spec.argv wskazuje tutaj)
+} job_t;
+
+// Ten sam warunek co proc_limit_ok() w launcherze, dla jobs przebiegow naraz
+static int nproc_jobs_limit(int jobs, int maxP) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NPROC, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY) return jobs;
+    while (jobs > 1 && (unsigned long)jobs * (unsigned long)(maxP + 3) + 20 > (unsigned long)rl.rlim_cur) jobs--;
+    return jobs;
+}
+
+static void job_start(job_t* j, const sweep_cfg_t* c, int cfg, int rep, uint64_t seed,
+    int32_t R, const char* bin_dir, int quiet) {
+    memset(j, 0, sizeof(*j));
+    j->cfg = cfg;
+    j->rep = rep;
+    snprintf(j->sv[0], 32, "%d", c->N);
+    snprintf(j->sv[1], 32, "%d", c->M);
+    snprintf(j->sv[2], 32, "%d", c->K);
+    snprintf(j->sv[3], 32, "%d", c->T1);
+    snprintf(j->sv[4], 32, "%d", c->T2);
+    snprintf(j->sv[5], 32, "%d", R);
+    snprintf(j->sv[6], 32, "%d", c->P);
+    snprintf(j->sv[7], 32, "%g", c->bike);
+    snprintf(j->sv[8], 32, "%llu", (unsigned long long)(seed + (uint64_t)rep));
+    snprintf(j->log_path, sizeof(j->log_path), "sweep_c%d_r%d.log", cfg, rep);
+
+    const char* args[] = { "--N", j->sv[0], "--M", j->sv[1], "--K", j->sv[2], "--T1", j->sv[3],
+        "--T2", j->sv[4], "--R", j->sv[5], "--P", j->sv[6], "--bike-prob", j->sv[7], "--seed", j->sv[8], NULL };
+    for (int a = 0; args[a]; a++) j->spec.argv[a] = args[a];
+    j->spec.bin_dir = bin_dir;
+    j->spec.log_path = j->log_path;
+    j->spec.quiet = quiet;
+
+    j->t0 = now_ms_monotonic();
+    j->pid = runner_spawn(&j->spec);
+    if (j->pid < 0) j->pid = 0;
+}
+
+int main(int argc, char** argv) {
+    int32_t Ns[MAX_LIST] = { 100 }, Ms[MAX_LIST] = { 10 }, Ks[MAX_LIST] = { 10 };
+    int32_t T1s[MAX_LIST] = { 500 }, T2s[MAX_LIST] = { 300 }, Ps[MAX_LIST] = { 500 };
+    double bikes[MAX_LIST] = { 0.2 };
+    int nN = 1, nM = 1, nK = 1, nT1 = 1, nT2 = 1, nP = 1, nB = 1;
+    int32_t R = 3, reps = 5, jobs = 0;
+    uint64_t seed = 1;
+    const char* bin_dir = NULL;
+    const char* csv_path = "sweep.csv";
+    int keep_logs = 0, verbose = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* k = argv[i];
+        int has_val = (i + 1) < argc;
+        int bad = 0;
+        if (strcmp(k, "--N") == 0 && has_val) bad = (nN = parse_i32_list(argv[++i], Ns, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--M") == 0 && has_val) bad = (nM = parse_i32_list(argv[++i], Ms, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--K") == 0 && has_val) bad = (nK = parse_i32_list(argv[++i], Ks, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--T1") == 0 && has_val) bad = (nT1 = parse_i32_list(argv[++i], T1s, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--T2") == 0 && has_val) bad = (nT2 = parse_i32_list(argv[++i], T2s, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--P") == 0 && has_val) bad = (nP = parse_i32_list(argv[++i], Ps, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--bike-prob") == 0 && has_val) bad = (nB = parse_double_list(argv[++i], bikes, MAX_LIST)) <= 0;
+        else if (strcmp(k, "--R") == 0 && has_val) bad = parse_i32(argv[++i], &R) != 0 || R <= 0;
+        else if (strcmp(k, "--reps") == 0 && has_val) bad = parse_i32(argv[++i], &reps) != 0 || reps <= 0;
+        else if (strcmp(k, "--jobs") == 0 && has_val) bad = parse_i32(argv[++i], &jobs) != 0 || jobs <= 0;
+        else if (strcmp(k, "--seed") == 0 && has_val) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(k, "--bin-dir") == 0 && has_val) bin_dir = argv[++i];
+        else if (strcmp(k, "--csv") == 0 && has_val) csv_path = argv[++i];
+        else if (strcmp(k, "--keep-logs") == 0) keep_logs = 1;
+        else if (strcmp(k, "--verbose") == 0) verbose = 1;
+        else if (strcmp(k, "--help") == 0) { usage(); return 0; }
+        else { fprintf(stderr, "Unknown arg: %s\n", k); usage(); return 2; }
+        if (bad) { fprintf(stderr, "Invalid value for %s\n", k); usage(); return 2; }
+    }
+
+    // Siatka konfiguracji (pomijamy te, ktorych launcher i tak by nie przyjal)
+    sweep_cfg_t* cfgs = (sweep_cfg_t*)calloc(MAX_CONFIGS, sizeof(sweep_cfg_t));
+    if (!cfgs) die_perror("calloc(cfgs)");
+    int ncfg = 0, skipped = 0, maxP = 0;
+    for (int a = 0; a < nN; a++) for (int b = 0; b < nM; b++) for (int c = 0; c < nK; c++)
+    for (int d = 0; d < nT1; d++) for (int e = 0; e < nT2; e++) for (int f = 0; f < nP; f++)
+    for (int g = 0; g < nB; g++) {
+        sweep_cfg_t x;
+        memset(&x, 0, sizeof(x));
+        x.N = Ns[a]; x.M = Ms[b]; x.K = Ks[c]; x.T1 = T1s[d]; x.T2 = T2s[e]; x.P = Ps[f]; x.bike = bikes[g];
+        if (x.N <= 0 || x.M < 0 || x.M >= x.N || x.K <= 0 || x.K >= x.N || x.K > MAX_K ||
+            x.T1 <= 0 || x.T2 <= 0 || x.P < 0 || x.P > MAX_P || x.bike < 0.0 || x.bike > 1.0) {
+            skipped++;
+            continue;
+        }
+        if (ncfg >= MAX_CONFIGS) { fprintf(stderr, "sweep: more than %d configurations\n", MAX_CONFIGS); return 2; }
+        if (x.P > maxP) maxP = x.P;
+        cfgs[ncfg++] = x;
+    }
+    if (ncfg == 0) { fprintf(stderr, "sweep: no valid configuration (skipped %d)\n", skipped); return 2; }
+
+    double* samples = (double*)calloc((size_t)ncfg * (size_t)reps * 3, sizeof(double));
+    if (!samples) die_perror("calloc(samples)");
+    for (int i = 0; i < ncfg; i++) {
+        cfgs[i].thr = samples + (size_t)i * (size_t)reps * 3;
+        cfgs[i].fill = cfgs[i].thr + reps;
+        cfgs[i].evict = cfgs[i].fill + reps;
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online < 1) online = 1;
+    if (jobs <= 0) jobs = (int32_t)online;
+    if (jobs > MAX_JOBS) jobs = MAX_JOBS;
+    const int32_t want_jobs = jobs;
+    jobs = nproc_jobs_limit(jobs, maxP);
+    if (jobs < want_jobs) fprintf(stderr, "sweep: RLIMIT_NPROC allows %d parallel runs (asked %d)\n", jobs, want_jobs);
+
+    const int total = ncfg * reps;
+    fprintf(stderr, "sweep: %d configurations x %d reps = %d runs, %d parallel (%ld CPUs), skipped %d\n",
+        ncfg, reps, total, jobs, online, skipped);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_term;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    job_t* slots = (job_t*)calloc((size_t)jobs, sizeof(job_t));
+    if (!slots) die_perror("calloc(jobs)");
+
+    // Planowanie: kolejne (konfiguracja, powtorzenie) w wolne miejsca, wait4 na dowolnym launcherze
+    const int64_t t_start = now_ms_monotonic();
+    int next = 0, running = 0, done = 0, stopping = 0;
+    while (next < total || running > 0) {
+        while (!g_stop && running < jobs && next < total) {
+            int free_slot = 0;
+            while (slots[free_slot].pid != 0) free_slot++;
+            const int cfg = next / reps, rep = next % reps;
+            job_start(&slots[free_slot], &cfgs[cfg], cfg, rep, seed, R, bin_dir, verbose ? 0 : 1);
+            next++;
+            if (slots[free_slot].pid == 0) { cfgs[cfg].failed++; done++; continue; }
+            running++;
+        }
+        if (g_stop && !stopping) {
+            // launcher na SIGTERM sprzata swoje dzieci i IPC
+            stopping = 1;
+            next = total;
+            for (int i = 0; i < jobs; i++) if (slots[i].pid > 0) kill(slots[i].pid, SIGTERM);
+        }
+        if (running == 0) break;
+
+        int status = 0;
+        struct rusage ru;
+        memset(&ru, 0, sizeof(ru));
+        pid_t w = wait4(-1, &status, 0, &ru);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            perror("wait4");
+            break;
+        }
+        job_t* j = NULL;
+        for (int i = 0; i < jobs; i++) if (slots[i].pid == w) { j = &slots[i]; break; }
+        if (!j) continue;
+
+        run_result_t rr;
+        runner_collect(&j->spec, w, status, &ru, now_ms_monotonic() - j->t0, &rr);
+        sweep_cfg_t* c = &cfgs[j->cfg];
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && rr.trips > 0) {
+            const double wall_s = (double)rr.wall_ms / 1000.0;
+            c->thr[c->ok] = wall_s > 0.0 ? (double)rr.boarded / wall_s : 0.0;
+            c->fill[c->ok] = rr.util_sum / (double)rr.trips;
+            c->evict[c->ok] = (double)rr.evictions;
+            c->ok++;
+        }
+        else {
+            c->failed++;
+        }
+        if (!keep_logs) {
+            char path[512];
+            if (bin_dir && j->log_path[0] != '/') snprintf(path, sizeof(path), "%s/%s", bin_dir, j->log_path);
+            else snprintf(path, sizeof(path), "%s", j->log_path);
+            (void)unlink(path);
+        }
+        j->pid = 0;
+        running--;
+        done++;
+        if (verbose) fprintf(stderr, "sweep: [%d/%d] cfg=%d rep=%d wall_ms=%lld boarded=%d\n",
+            done, total, j->cfg, j->rep, (long long)rr.wall_ms, rr.boarded);
+    }
+    const int64_t sweep_ms = now_ms_monotonic() - t_start;
+
+    FILE* csv = fopen(csv_path, "w");
+    if (!csv) perror("fopen(csv)");
+    if (csv) fprintf(csv, "N,M,K,T1,T2,P,bike_prob,runs_ok,runs_failed,thr_mean,thr_ci95,fill_mean,fill_ci95,evict_mean,evict_ci95\n");
+
+    printf("%5s %4s %4s %6s %6s %6s %5s %5s %18s %14s %14s\n",
+        "N", "M", "K", "T1", "T2", "P", "bike", "ok", "pax/s (95% CI)", "fill (95% CI)", "evict (95% CI)");
+    for (int i = 0; i < ncfg; i++) {
+        const sweep_cfg_t* c = &cfgs[i];
+        double tm, th, fm, fh, em, eh;
+        mean_ci(c->thr, c->ok, &tm, &th);
+        mean_ci(c->fill, c->ok, &fm, &fh);
+        mean_ci(c->evict, c->ok, &em, &eh);
+        printf("%5d %4d %4d %6d %6d %6d %5.2f %2d/%-2d %9.1f +- %5.1f %6.2f +- %4.2f %6.1f +- %4.1f\n",
+            c->N, c->M, c->K, c->T1, c->T2, c->P, c->bike, c->ok, c->ok + c->failed,
+            tm, th, fm, fh, em, eh);
+        if (csv) fprintf(csv, "%d,%d,%d,%d,%d,%d,%g,%d,%d,%.3f,%.3f,%.4f,%.4f,%.3f,%.3f\n",
+            c->N, c->M, c->K, c->T1, c->T2, c->P, c->bike, c->ok, c->failed, tm, th, fm, fh, em, eh);
+    }
+    if (csv) fclose(csv);
+    printf("sweep: %d runs in %lld ms (%d parallel)%s\n", done, (long long)sweep_ms, jobs,
+        g_stop ? " - interrupted" : "");
+
+    free(slots);
+    free(samples);
+    free(cfgs);
+    return g_stop ? 1 : 0;
+}
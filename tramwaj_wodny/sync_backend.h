@@ -0,0 +1,139 @@
+#ifndef SYNC_BACKEND_H
+#define SYNC_BACKEND_H
+
+// Warstwa synchronizacji pod ipc.h, wybierana przy kompilacji (CMake TRAMWAJ_SYNC_BACKEND):
+//   posix (domyslnie) - robust pthread_mutex_t i sem_t (pshared) w SHM, czekanie na slowie: pthread_cond_t;
+//                       skrzynka: kolejka SysV (sync_msgq.cpp)
+//   sysv              - zbior semaforow SysV: mutex = semafor binarny z SEM_UNDO, licznik = semafor,
+//                       czekanie na slowie: semtimedop na semaforze kubelka; skrzynka: kolejka SysV
+//   futex             - slowa w SHM: mutex spin-then-park (futex_lock_*), licznik = slowo + FUTEX_WAIT,
+//                       czekanie na slowie: FUTEX_WAIT(_BITSET); skrzynka w SHM (polecenie w slocie pasazera,
+//                       ring ACK w stanie statku), bez kolejki SysV
+// Kazdy backend to jeden plik sync_<nazwa>.cpp z tymi samymi funkcjami; typy ponizej leza w SHM (common.h).
+// POSIX i SysV nie maja czekania na adresie: slowa (phase_seq, captain_wake, sloty, szyna zdarzen) sa
+// rozrzucone po SYNC_WAIT_BUCKETS kubelkach wg offsetu w SHM; budzenie budzi caly kubelek, a czekajacy
+// i tak sprawdza swoje slowo (jak po FUTEX_WAIT). Pula workerow tramwajd (poza SHM) zostaje na futex.h.
+
+#include <stdint.h>
+
+#if defined(TRAMWAJ_SYNC_SYSV)
+#elif defined(TRAMWAJ_SYNC_FUTEX)
+#else
+#ifndef TRAMWAJ_SYNC_POSIX
+#define TRAMWAJ_SYNC_POSIX
+#endif
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // ======= Typy osadzone w SHM =======
+    enum { SYNC_WAIT_BUCKETS = 256 };    // kubelki czekania na slowie (posix/sysv), potega 2
+
+#if defined(TRAMWAJ_SYNC_SYSV)
+    enum { SYNC_SYSV_NSEMS = 64 };       // 2 muteksy + MAX_F * (2 + MAX_G) licznikow
+    typedef struct {
+        int32_t semid;                   // zbior semaforow (semget w ipc_create, IPC_RMID w ipc_destroy)
+        int32_t waitid;                  // zbior kubelkow czekania: 2 * SYNC_WAIT_BUCKETS (zamek, zetony)
+        uint64_t used;                   // zajete indeksy zbioru semid
+    } sync_domain_t;
+    typedef struct { int32_t semid, idx; } sync_mutex_t;
+    typedef struct { int32_t semid, idx; } sync_count_t;
+    typedef struct {
+        int32_t semid;                   // = sync_domain_t.waitid
+        uint32_t waiters[SYNC_WAIT_BUCKETS];   // pod zamkiem kubelka; budzacy zeruje i daje tyle zetonow
+        uint32_t gen[SYNC_WAIT_BUCKETS];       // numer budzenia: spoznione zetony po timeoucie
+    } sync_waitq_t;
+#elif defined(TRAMWAJ_SYNC_FUTEX)
+    typedef struct { int32_t unused; } sync_domain_t;
+    typedef struct { uint32_t word; } sync_mutex_t;                 // futex_lock_*: 0 wolny, PID wlasciciela
+    typedef struct { uint32_t value, waiters; } sync_count_t;      // waiters: ilu spi na value == 0
+    typedef struct { int32_t unused; } sync_waitq_t;               // jadro: kolejka futeksow
+#else
+    typedef struct { int32_t unused; } sync_domain_t;
+    typedef pthread_mutex_t sync_mutex_t;   // PTHREAD_PROCESS_SHARED + PTHREAD_MUTEX_ROBUST
+    typedef sem_t sync_count_t;             // sem_init(pshared=1)
+    typedef struct {
+        pthread_mutex_t m;                  // robust, pshared
+        pthread_cond_t cv;                  // pshared, CLOCK_MONOTONIC
+        uint32_t waiters;                   // budzacy pomija pusty kubelek
+    } sync_wait_bucket_t;
+    typedef struct { sync_wait_bucket_t b[SYNC_WAIT_BUCKETS]; } sync_waitq_t;
+#endif
+
+    // Skrzynka: polecenie kapitana w slocie adresata, ACK-i w stanie statku (tylko backend futex);
+    // SYNC_MBOX_MSGQ = 1: skrzynka na kolejce SysV (ipc_create robi msgget, dzieci dostaja --msqid)
+#if defined(TRAMWAJ_SYNC_FUTEX)
+#define SYNC_MBOX_MSGQ 0
+    enum { SYNC_MBOX_CAP = 32 };            // ACK-i w drodze do jednego kapitana (potega 2, >= MAX_G)
+    typedef struct {
+        uint32_t cmd;                       // 0 = pusto, inaczej cmd_t (zapis release po trip_no)
+        int32_t trip_no;
+    } sync_mbox_slot_t;
+    typedef struct {
+        uint32_t seq;                       // numer pozycji (ring MPSC z numerami jak u Vyukova)
+        int32_t pid;
+        int32_t trip_no;
+    } sync_mbox_cell_t;
+    typedef struct {
+        uint32_t head, tail;                // head: pasazerowie (CAS), tail: tylko kapitan statku
+        sync_mbox_cell_t cell[SYNC_MBOX_CAP];
+    } sync_mbox_ship_t;
+#else
+#define SYNC_MBOX_MSGQ 1
+    typedef struct { int32_t unused; } sync_mbox_slot_t;   // komunikaty ida kolejka SysV (msqid)
+    typedef struct { int32_t unused; } sync_mbox_ship_t;
+#endif
+
+    // Koszt oczekiwania na mutex (statystyki LOCK)
+    typedef struct {
+        uint32_t spins;
+        uint32_t parks;
+    } sync_lock_cost_t;
+
+    const char* sync_backend_name(void);   // "posix" | "sysv" | "futex"
+    const char* sync_mutex_impl(void);     // linia LOCK: "mutex" | "semop" | "futex"
+
+    // ======= Domena (obiekty poza SHM) =======
+    // Tworzy launcher/demon przed inicjalizacja muteksow i licznikow; 0 ok, -1 blad
+    int sync_domain_create(sync_domain_t* d);
+    void sync_domain_destroy(sync_domain_t* d);
+
+    // ======= Mutex procesowy =======
+    // Smierc wlasciciela nie blokuje zamka (EOWNERDEAD / SEM_UNDO / przejecie po kill(pid, 0));
+    // odzyskanie stanu wlasciciela robi wolajacy (state_lock: shm_state_t.state_owner)
+    int sync_mutex_init(sync_domain_t* d, sync_mutex_t* m);
+    int sync_mutex_trylock(sync_mutex_t* m);                        // 0 wziety, -1 zajety
+    int sync_mutex_lock(sync_mutex_t* m, sync_lock_cost_t* cost);  // 0 ok, -1 blad
+    void sync_mutex_unlock(sync_mutex_t* m);
+
+    // ======= Zasob liczony (miejsca, rowery, jednostki trapu) =======
+    int sync_count_init(sync_domain_t* d, sync_count_t* c, unsigned value);
+    void sync_count_destroy(sync_domain_t* d, sync_count_t* c);
+    int sync_count_trywait(sync_count_t* c);   // 0 zajeta jednostka, -1 brak (takze EINTR)
+    int sync_count_wait(sync_count_t* c);      // 0 ok, -1 z errno == EINTR (sygnal)
+    void sync_count_post(sync_count_t* c);     // blad -> die_perror
+    int sync_count_value(sync_count_t* c);     // biezaca wartosc (migawka)
+
+    // ======= Czekanie na slowie (licznik budzen w SHM) =======
+    // key = offset slowa w SHM (mapowania roznych procesow maja rozne adresy). bits: maska adresatow
+    // (futex: FUTEX_*_BITSET, posix/sysv: ignorowana - budzony caly kubelek), SYNC_BITS_ALL = kazdy.
+    // Budzacy najpierw zmienia slowo, potem wola sync_notify; czekajacy po powrocie sprawdza slowo sam.
+    enum { SYNC_WAKE_ALL = 0x7fffffff };
+#define SYNC_BITS_ALL 0xffffffffu
+    static inline uint32_t sync_wait_bucket(uint32_t key) {   // hash Fibonacciego offsetu slowa
+        return ((key >> 2) * 2654435761u) >> 24 & (SYNC_WAIT_BUCKETS - 1);
+    }
+    int sync_waitq_init(sync_domain_t* d, sync_waitq_t* q);   // tworca, po sync_domain_create; 0 ok, -1 blad
+    // Spij dopoki *word == expected (maks. timeout_ms; <0 bez limitu). 0 = obudzony / slowo inne, -1 = timeout/EINTR
+    int sync_wait(sync_waitq_t* q, uint32_t key, uint32_t* word, uint32_t expected, uint32_t bits, int timeout_ms);
+    void sync_notify(sync_waitq_t* q, uint32_t key, uint32_t* word, int n, uint32_t bits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYNC_BACKEND_H
@@ -0,0 +1,179 @@
+#include "sync_backend.h"
+#include "futex.h"
+#include "ipc.h"
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+// Backend futex: wszystko to slowa w SHM, bez obiektow jadra poza kolejka futeksow.
+// Mutex = futex_lock_* (spin-then-park, przejecie zamka martwego wlasciciela),
+// licznik = wartosc + liczba spiacych (post budzi tylko gdy ktos spi),
+// skrzynka = polecenie w slocie adresata + ring ACK-ow w stanie statku.
+
+const char* sync_backend_name(void) { return "futex"; }
+const char* sync_mutex_impl(void) { return "futex"; }
+
+int sync_domain_create(sync_domain_t* d) {
+    d->unused = 0;
+    return 0;
+}
+
+void sync_domain_destroy(sync_domain_t*) {}
+
+// ======= Mutex =======
+int sync_mutex_init(sync_domain_t*, sync_mutex_t* m) {
+    m->word = 0;
+    return 0;
+}
+
+int sync_mutex_trylock(sync_mutex_t* m) { return futex_lock_try(&m->word); }
+
+int sync_mutex_lock(sync_mutex_t* m, sync_lock_cost_t* cost) {
+    uint32_t spins = 0, parks = 0;
+    if (futex_lock_try(&m->word) != 0) futex_lock_wait(&m->word, &spins, &parks);
+    if (cost) { cost->spins += spins; cost->parks += parks; }
+    return 0;
+}
+
+void sync_mutex_unlock(sync_mutex_t* m) { futex_unlock(&m->word); }
+
+// ======= Licznik =======
+int sync_count_init(sync_domain_t*, sync_count_t* c, unsigned value) {
+    c->value = value;
+    c->waiters = 0;
+    return 0;
+}
+
+void sync_count_destroy(sync_domain_t*, sync_count_t*) {}
+
+int sync_count_trywait(sync_count_t* c) {
+    uint32_t v = __atomic_load_n(&c->value, __ATOMIC_RELAXED);
+    while (v > 0) {
+        if (__atomic_compare_exchange_n(&c->value, &v, v - 1, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return 0;
+    }
+    return -1;
+}
+
+// waiters++ przed FUTEX_WAIT, a post: value++ przed odczytem waiters (oba seq_cst) -
+// post albo zobaczy spiacego, albo spiacy zobaczy value != 0 i nie zasnie
+int sync_count_wait(sync_count_t* c) {
+    for (;;) {
+        if (sync_count_trywait(c) == 0) return 0;
+        __atomic_fetch_add(&c->waiters, 1, __ATOMIC_SEQ_CST);
+        const int r = futex_wait(&c->value, 0, -1);
+        const int err = errno;
+        __atomic_fetch_sub(&c->waiters, 1, __ATOMIC_SEQ_CST);
+        if (r != 0 && err == EINTR) { errno = EINTR; return -1; }
+    }
+}
+
+void sync_count_post(sync_count_t* c) {
+    __atomic_fetch_add(&c->value, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&c->waiters, __ATOMIC_SEQ_CST) > 0) (void)futex_wake(&c->value, 1);
+}
+
+int sync_count_value(sync_count_t* c) { return (int)__atomic_load_n(&c->value, __ATOMIC_RELAXED); }
+
+// ======= Czekanie na slowie =======
+// Jadro samo trzyma kolejke na adresie: kubelki i klucz nie sa potrzebne
+int sync_waitq_init(sync_domain_t*, sync_waitq_t* q) {
+    q->unused = 0;
+    return 0;
+}
+
+int sync_wait(sync_waitq_t*, uint32_t, uint32_t* word, uint32_t expected, uint32_t bits, int timeout_ms) {
+    if (bits == SYNC_BITS_ALL) return futex_wait(word, expected, timeout_ms);
+    return futex_wait_bits(word, expected, bits, timeout_ms);
+}
+
+void sync_notify(sync_waitq_t*, uint32_t, uint32_t* word, int n, uint32_t bits) {
+    if (bits == SYNC_BITS_ALL) (void)futex_wake(word, n);
+    else (void)futex_wake_bits(word, n, bits);
+}
+
+// ======= Skrzynka kapitan <-> pasazer =======
+// Polecenie: jedno na slot (kapitan wysyla CMD_EVICT do pasazera z konca trapu i czeka na ACK).
+// ACK: ring MPSC statku - pasazerowie rezerwuja pozycje CAS-em na head, kapitan czyta od tail;
+// seq komorki mowi, czy jest wolna (== pozycja), czy opublikowana (== pozycja + 1).
+static const uint32_t MBOX_MASK = SYNC_MBOX_CAP - 1;
+
+int mbox_send_cmd(ipc_handles_t* h, int32_t slot, const msg_cmd_t* m) {
+    passenger_slot_t* sl = slot_get(h->shm, slot);
+    if (!sl) { errno = EINVAL; perror("mbox_send_cmd"); return -1; }
+    __atomic_store_n(&sl->mbox.trip_no, m->trip_no, __ATOMIC_RELAXED);
+    __atomic_store_n(&sl->mbox.cmd, (uint32_t)m->cmd, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int mbox_recv_cmd(ipc_handles_t* h, int32_t slot, pid_t pid, msg_cmd_t* out) {
+    passenger_slot_t* sl = slot_get(h->shm, slot);
+    if (!sl || __atomic_load_n(&sl->mbox.cmd, __ATOMIC_RELAXED) == 0) return 0;
+    const uint32_t cmd = __atomic_exchange_n(&sl->mbox.cmd, 0, __ATOMIC_ACQUIRE);
+    if (cmd == 0) return 0;
+    out->mtype = (long)pid;
+    out->cmd = (cmd_t)cmd;
+    out->trip_no = __atomic_load_n(&sl->mbox.trip_no, __ATOMIC_RELAXED);
+    return 1;
+}
+
+void mbox_drop_cmd(ipc_handles_t* h, int32_t slot, pid_t) {
+    passenger_slot_t* sl = slot_get(h->shm, slot);
+    if (sl) __atomic_store_n(&sl->mbox.cmd, 0, __ATOMIC_RELEASE);
+}
+
+int mbox_send_ack(ipc_handles_t* h, int32_t ship, const msg_ack_t* m) {
+    ship_state_t* sh = ship_get(h->shm, ship);
+    if (!sh) { errno = EINVAL; perror("mbox_send_ack"); return -1; }
+    sync_mbox_ship_t* q = &sh->mbox;
+    uint32_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    sync_mbox_cell_t* cell;
+    for (;;) {
+        cell = &q->cell[pos & MBOX_MASK];
+        const int32_t dif = (int32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        }
+        else if (dif < 0) {
+            // pelny ring: kapitan i tak zdejmie nas po evict_timeout_ms (captain_force_evict)
+            errno = EAGAIN;
+            perror("mbox_send_ack(full)");
+            return -1;
+        }
+        else {
+            pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+        }
+    }
+    cell->pid = m->pid;
+    cell->trip_no = m->trip_no;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int mbox_recv_ack(ipc_handles_t* h, int32_t ship, msg_ack_t* out) {
+    ship_state_t* sh = ship_get(h->shm, ship);
+    if (!sh) return 0;
+    sync_mbox_ship_t* q = &sh->mbox;
+    const uint32_t pos = q->tail;   // jedyny czytelnik: kapitan statku
+    sync_mbox_cell_t* cell = &q->cell[pos & MBOX_MASK];
+    if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1) return 0;
+    out->mtype = 1;
+    out->pid = cell->pid;
+    out->trip_no = cell->trip_no;
+    __atomic_store_n(&cell->seq, pos + SYNC_MBOX_CAP, __ATOMIC_RELEASE);
+    q->tail = pos + 1;
+    return 1;
+}
+
+void mbox_reset(ipc_handles_t* h) {
+    for (int i = 0; i < MAX_F; i++) {
+        sync_mbox_ship_t* q = &h->shm->ships[i].mbox;
+        q->head = q->tail = 0;
+        for (uint32_t j = 0; j < SYNC_MBOX_CAP; j++) q->cell[j].seq = j;
+    }
+    for (uint32_t i = 0; i < h->shm->layout.slots_cap; i++) {
+        passenger_slot_t* sl = slot_get(h->shm, (int32_t)i);
+        sl->mbox.cmd = 0;
+        sl->mbox.trip_no = 0;
+    }
+}
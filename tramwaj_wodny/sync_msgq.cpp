@@ -0,0 +1,44 @@
+#include "ipc.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+
+// Skrzynka kapitan <-> pasazer na kolejce SysV (backendy posix i sysv).
+// Polecenie: mtype = PID pasazera; ACK: mtype = MBOX_ACK_MTYPE + statek, zeby kapitan
+// floty odbieral tylko potwierdzenia wlasnych ewakuacji (PID-y < 2^22, wiec zakresy sie nie stykaja).
+static const long MBOX_ACK_MTYPE = 1L << 30;
+
+int mbox_send_cmd(ipc_handles_t* h, int32_t, const msg_cmd_t* m) {
+    if (msgsnd(h->msqid, m, sizeof(*m) - sizeof(long), 0) != 0) { perror("msgsnd(CMD)"); return -1; }
+    return 0;
+}
+
+int mbox_recv_cmd(ipc_handles_t* h, int32_t, pid_t pid, msg_cmd_t* out) {
+    return msgrcv(h->msqid, out, sizeof(*out) - sizeof(long), (long)pid, IPC_NOWAIT) >= 0 ? 1 : 0;
+}
+
+void mbox_drop_cmd(ipc_handles_t* h, int32_t slot, pid_t pid) {
+    msg_cmd_t stale;
+    while (mbox_recv_cmd(h, slot, pid, &stale)) {}
+}
+
+int mbox_send_ack(ipc_handles_t* h, int32_t ship, const msg_ack_t* m) {
+    msg_ack_t ack = *m;
+    ack.mtype = MBOX_ACK_MTYPE + ship;
+    if (msgsnd(h->msqid, &ack, sizeof(ack) - sizeof(long), 0) != 0) { perror("msgsnd(ACK)"); return -1; }
+    return 0;
+}
+
+int mbox_recv_ack(ipc_handles_t* h, int32_t ship, msg_ack_t* out) {
+    if (msgrcv(h->msqid, out, sizeof(*out) - sizeof(long), MBOX_ACK_MTYPE + ship, IPC_NOWAIT) >= 0) return 1;
+    if (errno != ENOMSG && errno != EINTR) perror("msgrcv(ACK)");
+    return 0;
+}
+
+void mbox_reset(ipc_handles_t* h) {
+    // niedoreczone CMD_EVICT/ACK z poprzedniego przebiegu
+    msg_ack_t junk;
+    while (msgrcv(h->msqid, &junk, sizeof(junk) - sizeof(long), 0, IPC_NOWAIT | MSG_NOERROR) >= 0) {}
+}
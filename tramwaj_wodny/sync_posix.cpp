@@ -0,0 +1,144 @@
+#include "sync_backend.h"
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+
+// Backend POSIX: robust pthread_mutex_t i sem_t (pshared) osadzone w SHM,
+// czekanie na slowie: kubelki pthread_mutex_t + pthread_cond_t (pshared) w SHM
+
+const char* sync_backend_name(void) { return "posix"; }
+const char* sync_mutex_impl(void) { return "mutex"; }
+
+int sync_domain_create(sync_domain_t* d) {
+    d->unused = 0;
+    return 0;
+}
+
+void sync_domain_destroy(sync_domain_t*) {}
+
+// ======= Mutex =======
+// PTHREAD_MUTEX_ROBUST: smierc wlasciciela -> EOWNERDEAD u nastepnego, a nie zakleszczenie
+int sync_mutex_init(sync_domain_t*, sync_mutex_t* m) {
+    pthread_mutexattr_t at;
+    if (pthread_mutexattr_init(&at) != 0) return -1;
+    int rc = pthread_mutexattr_setpshared(&at, PTHREAD_PROCESS_SHARED);
+    if (rc == 0) rc = pthread_mutexattr_setrobust(&at, PTHREAD_MUTEX_ROBUST);
+    if (rc == 0) rc = pthread_mutex_init(m, &at);
+    pthread_mutexattr_destroy(&at);
+    if (rc != 0) { errno = rc; perror("pthread_mutex_init(robust)"); return -1; }
+    return 0;
+}
+
+// EOWNERDEAD: zamek jest nasz, przywracamy go (stan chronionych danych odzyskuje wolajacy)
+static int mutex_taken(sync_mutex_t* m, int rc) {
+    if (rc == EOWNERDEAD) {
+        rc = pthread_mutex_consistent(m);
+        if (rc != 0) { pthread_mutex_unlock(m); errno = rc; perror("pthread_mutex_consistent"); return -1; }
+    }
+    return rc;
+}
+
+int sync_mutex_trylock(sync_mutex_t* m) {
+    int rc = pthread_mutex_trylock(m);
+    if (rc == EBUSY) return -1;
+    if (mutex_taken(m, rc) != 0) return -1;
+    return 0;
+}
+
+int sync_mutex_lock(sync_mutex_t* m, sync_lock_cost_t* cost) {
+    int rc = mutex_taken(m, pthread_mutex_lock(m));
+    if (rc < 0) return -1;
+    if (rc != 0) { errno = rc; perror("pthread_mutex_lock"); return -1; }
+    if (cost) cost->parks++;
+    return 0;
+}
+
+void sync_mutex_unlock(sync_mutex_t* m) {
+    int rc = pthread_mutex_unlock(m);
+    if (rc != 0) { errno = rc; die_perror("pthread_mutex_unlock"); }
+}
+
+// ======= Licznik =======
+int sync_count_init(sync_domain_t*, sync_count_t* c, unsigned value) {
+    if (sem_init(c, 1, value) != 0) { perror("sem_init(pshared)"); return -1; }
+    return 0;
+}
+
+void sync_count_destroy(sync_domain_t*, sync_count_t* c) { sem_destroy(c); }
+
+int sync_count_trywait(sync_count_t* c) {
+    // EAGAIN/EINTR -> "nie udalo sie"
+    return sem_trywait(c) == 0 ? 0 : -1;
+}
+
+int sync_count_wait(sync_count_t* c) {
+    while (sem_wait(c) != 0) {
+        if (errno == EINTR) return -1;
+        die_perror("sem_wait");
+    }
+    return 0;
+}
+
+void sync_count_post(sync_count_t* c) {
+    if (sem_post(c) != 0) die_perror("sem_post");
+}
+
+int sync_count_value(sync_count_t* c) {
+    int v = 0;
+    if (sem_getvalue(c, &v) != 0) return 0;
+    return v;
+}
+
+// ======= Czekanie na slowie =======
+int sync_waitq_init(sync_domain_t* d, sync_waitq_t* q) {
+    pthread_condattr_t ca;
+    if (pthread_condattr_init(&ca) != 0) return -1;
+    int rc = pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+    if (rc == 0) rc = pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    for (int i = 0; rc == 0 && i < SYNC_WAIT_BUCKETS; i++) {
+        sync_wait_bucket_t* b = &q->b[i];
+        b->waiters = 0;
+        if (sync_mutex_init(d, &b->m) != 0) { rc = -1; break; }
+        rc = pthread_cond_init(&b->cv, &ca);
+    }
+    pthread_condattr_destroy(&ca);
+    if (rc > 0) { errno = rc; perror("pthread_cond_init(pshared)"); }
+    return rc == 0 ? 0 : -1;
+}
+
+// waiters++ i odczyt slowa pod zamkiem kubelka (seq_cst), a budzacy: zmiana slowa przed odczytem waiters -
+// budzacy albo zobaczy czekajacego i wezmie zamek (czekajacy juz spi w cond_wait), albo czekajacy zobaczy nowe slowo
+int sync_wait(sync_waitq_t* q, uint32_t key, uint32_t* word, uint32_t expected, uint32_t, int timeout_ms) {
+    sync_wait_bucket_t* b = &q->b[sync_wait_bucket(key)];
+    struct timespec ts;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += timeout_ms / 1000;
+        ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+    }
+    if (sync_mutex_lock(&b->m, NULL) != 0) return -1;
+    __atomic_fetch_add(&b->waiters, 1, __ATOMIC_SEQ_CST);
+    int rc = 0;
+    if (__atomic_load_n(word, __ATOMIC_SEQ_CST) == expected) {
+        rc = timeout_ms >= 0 ? pthread_cond_timedwait(&b->cv, &b->m, &ts) : pthread_cond_wait(&b->cv, &b->m);
+        if (rc == EOWNERDEAD) rc = pthread_mutex_consistent(&b->m);
+    }
+    __atomic_fetch_sub(&b->waiters, 1, __ATOMIC_SEQ_CST);
+    sync_mutex_unlock(&b->m);
+    if (rc == ETIMEDOUT) return -1;
+    if (rc != 0) { errno = rc; perror("pthread_cond_wait"); return -1; }
+    return 0;
+}
+
+// Kubelek dziela rozne slowa, wiec zawsze broadcast (n i bits bez znaczenia)
+void sync_notify(sync_waitq_t* q, uint32_t key, uint32_t*, int, uint32_t) {
+    sync_wait_bucket_t* b = &q->b[sync_wait_bucket(key)];
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&b->waiters, __ATOMIC_SEQ_CST) == 0) return;
+    if (sync_mutex_lock(&b->m, NULL) != 0) return;
+    (void)pthread_cond_broadcast(&b->cv);
+    sync_mutex_unlock(&b->m);
+}
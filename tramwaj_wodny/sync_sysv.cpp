@@ -0,0 +1,207 @@
+#include "sync_backend.h"
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <time.h>
+
+// Backend SysV: zbior SYNC_SYSV_NSEMS semaforow na przebieg (semget w sync_domain_create).
+// Mutex = semafor binarny z SEM_UNDO (jadro oddaje zamek po smierci wlasciciela),
+// licznik = zwykly semafor (bez SEM_UNDO: jednostki oddaje ksiega slotu, nie jadro).
+// Czekanie na slowie: drugi zbior, na kubelek para (zamek z SEM_UNDO, zetony budzenia).
+
+const char* sync_backend_name(void) { return "sysv"; }
+const char* sync_mutex_impl(void) { return "semop"; }
+
+enum { SYSV_SEMVMX = 32767 };   // maksymalna wartosc semafora SysV
+
+// glibc nie deklaruje unii dla semctl(SETVAL)
+union sysv_semun {
+    int val;
+    struct semid_ds* buf;
+    unsigned short* array;
+};
+
+int sync_domain_create(sync_domain_t* d) {
+    d->waitid = -1;
+    d->semid = semget(IPC_PRIVATE, SYNC_SYSV_NSEMS, IPC_CREAT | IPC_EXCL | 0600);
+    if (d->semid < 0) { perror("semget"); return -1; }
+    d->used = 0;
+    d->waitid = semget(IPC_PRIVATE, 2 * SYNC_WAIT_BUCKETS, IPC_CREAT | IPC_EXCL | 0600);
+    if (d->waitid < 0) { perror("semget(wait)"); return -1; }
+    return 0;
+}
+
+void sync_domain_destroy(sync_domain_t* d) {
+    if (d->waitid >= 0 && semctl(d->waitid, 0, IPC_RMID) != 0) perror("semctl(IPC_RMID, wait)");
+    d->waitid = -1;
+    if (d->semid < 0) return;
+    if (semctl(d->semid, 0, IPC_RMID) != 0) perror("semctl(IPC_RMID)");
+    d->semid = -1;
+}
+
+// Przydzial indeksu w zbiorze (tylko tworca: launcher/demon, bez wspolbieznosci)
+static int sysv_alloc(sync_domain_t* d, unsigned value) {
+    if (value > SYSV_SEMVMX) {
+        fprintf(stderr, "sync(sysv): value %u over SEMVMX %d\n", value, (int)SYSV_SEMVMX);
+        return -1;
+    }
+    for (int i = 0; i < SYNC_SYSV_NSEMS; i++) {
+        if (d->used & (1ull << i)) continue;
+        union sysv_semun arg;
+        arg.val = (int)value;
+        if (semctl(d->semid, i, SETVAL, arg) != 0) { perror("semctl(SETVAL)"); return -1; }
+        d->used |= 1ull << i;
+        return i;
+    }
+    fprintf(stderr, "sync(sysv): semaphore set full (%d)\n", (int)SYNC_SYSV_NSEMS);
+    return -1;
+}
+
+static int sysv_op(int semid, int idx, short delta, short flg) {
+    struct sembuf op;
+    op.sem_num = (unsigned short)idx;
+    op.sem_op = delta;
+    op.sem_flg = flg;
+    return semop(semid, &op, 1);
+}
+
+// ======= Mutex =======
+int sync_mutex_init(sync_domain_t* d, sync_mutex_t* m) {
+    const int idx = sysv_alloc(d, 1);
+    if (idx < 0) return -1;
+    m->semid = d->semid;
+    m->idx = idx;
+    return 0;
+}
+
+int sync_mutex_trylock(sync_mutex_t* m) {
+    return sysv_op(m->semid, m->idx, -1, SEM_UNDO | IPC_NOWAIT) == 0 ? 0 : -1;
+}
+
+int sync_mutex_lock(sync_mutex_t* m, sync_lock_cost_t* cost) {
+    // jak pthread_mutex_lock: sygnal nie przerywa czekania na zamek
+    while (sysv_op(m->semid, m->idx, -1, SEM_UNDO) != 0) {
+        if (errno != EINTR) { perror("semop(lock)"); return -1; }
+    }
+    if (cost) cost->parks++;
+    return 0;
+}
+
+void sync_mutex_unlock(sync_mutex_t* m) {
+    if (sysv_op(m->semid, m->idx, 1, SEM_UNDO) != 0) die_perror("semop(unlock)");
+}
+
+// ======= Licznik =======
+int sync_count_init(sync_domain_t* d, sync_count_t* c, unsigned value) {
+    const int idx = sysv_alloc(d, value);
+    if (idx < 0) return -1;
+    c->semid = d->semid;
+    c->idx = idx;
+    return 0;
+}
+
+void sync_count_destroy(sync_domain_t* d, sync_count_t* c) {
+    if (c->idx >= 0 && c->idx < SYNC_SYSV_NSEMS) d->used &= ~(1ull << c->idx);
+    c->idx = -1;
+}
+
+int sync_count_trywait(sync_count_t* c) {
+    return sysv_op(c->semid, c->idx, -1, IPC_NOWAIT) == 0 ? 0 : -1;
+}
+
+int sync_count_wait(sync_count_t* c) {
+    while (sysv_op(c->semid, c->idx, -1, 0) != 0) {
+        if (errno == EINTR) return -1;
+        die_perror("semop(wait)");
+    }
+    return 0;
+}
+
+void sync_count_post(sync_count_t* c) {
+    if (sysv_op(c->semid, c->idx, 1, 0) != 0) die_perror("semop(post)");
+}
+
+int sync_count_value(sync_count_t* c) {
+    const int v = semctl(c->semid, c->idx, GETVAL);
+    return v < 0 ? 0 : v;
+}
+
+// ======= Czekanie na slowie =======
+// Kubelek i: semafor 2i = zamek (1 wolny), 2i + 1 = zetony. Czekajacy pod zamkiem sprawdza slowo i zapisuje sie
+// (waiters++), po zwolnieniu zamka spi na zetonie. Budzacy pod zamkiem zabiera waiters, podbija gen i daje tyle
+// zetonow. Czekajacy po timeoucie: gen bez zmian -> wypisuje sie sam, inaczej zeton jest jego (zdejmuje go).
+int sync_waitq_init(sync_domain_t* d, sync_waitq_t* q) {
+    unsigned short init[2 * SYNC_WAIT_BUCKETS];
+    for (int i = 0; i < SYNC_WAIT_BUCKETS; i++) {
+        init[2 * i] = 1;
+        init[2 * i + 1] = 0;
+        q->waiters[i] = 0;
+        q->gen[i] = 0;
+    }
+    union sysv_semun arg;
+    arg.array = init;
+    if (semctl(d->waitid, 0, SETALL, arg) != 0) { perror("semctl(SETALL, wait)"); return -1; }
+    q->semid = d->waitid;
+    return 0;
+}
+
+static void wait_lock(sync_waitq_t* q, uint32_t b) {
+    while (sysv_op(q->semid, (int)(2 * b), -1, SEM_UNDO) != 0) {
+        if (errno != EINTR) die_perror("semop(wait lock)");
+    }
+}
+
+static void wait_unlock(sync_waitq_t* q, uint32_t b) {
+    if (sysv_op(q->semid, (int)(2 * b), 1, SEM_UNDO) != 0) die_perror("semop(wait unlock)");
+}
+
+int sync_wait(sync_waitq_t* q, uint32_t key, uint32_t* word, uint32_t expected, uint32_t, int timeout_ms) {
+    const uint32_t b = sync_wait_bucket(key);
+    wait_lock(q, b);
+    if (__atomic_load_n(word, __ATOMIC_SEQ_CST) != expected) {
+        wait_unlock(q, b);
+        return 0;
+    }
+    const uint32_t gen = q->gen[b];
+    __atomic_fetch_add(&q->waiters[b], 1, __ATOMIC_SEQ_CST);
+    wait_unlock(q, b);
+
+    struct sembuf op;
+    op.sem_num = (unsigned short)(2 * b + 1);
+    op.sem_op = -1;
+    op.sem_flg = 0;
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+    if (semtimedop(q->semid, &op, 1, timeout_ms >= 0 ? &ts : NULL) == 0) return 0;
+    const int err = errno;
+    if (err != EAGAIN && err != EINTR) perror("semtimedop(wait)");
+
+    wait_lock(q, b);
+    const int counted = q->gen[b] == gen;
+    if (counted) __atomic_fetch_sub(&q->waiters[b], 1, __ATOMIC_SEQ_CST);
+    wait_unlock(q, b);
+    // budzacy juz nas policzyl: zeton jest nasz - zdejmujemy go, zeby nie obudzil innego. Jesli jeszcze
+    // nie doszedl, obudzi pozniej kogos z kubelka falszywie (czekajacy i tak sprawdza swoje slowo)
+    if (!counted) (void)sysv_op(q->semid, (int)(2 * b + 1), -1, IPC_NOWAIT);
+    errno = err;
+    return -1;
+}
+
+// Kubelek dziela rozne slowa, wiec budzeni sa wszyscy zapisani (n i bits bez znaczenia)
+void sync_notify(sync_waitq_t* q, uint32_t key, uint32_t*, int, uint32_t) {
+    const uint32_t b = sync_wait_bucket(key);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->waiters[b], __ATOMIC_SEQ_CST) == 0) return;
+    wait_lock(q, b);
+    const uint32_t n = q->waiters[b];
+    q->waiters[b] = 0;
+    q->gen[b]++;
+    wait_unlock(q, b);
+    if (n > 0 && sysv_op(q->semid, (int)(2 * b + 1), (short)(n < SYSV_SEMVMX ? n : SYSV_SEMVMX), 0) != 0) {
+        perror("semop(notify)");
+    }
+}
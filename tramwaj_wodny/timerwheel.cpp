@@ -0,0 +1,134 @@
+#include "timerwheel.h"
+
+#include <string.h>
+
+static const uint64_t TW_MASK = TW_SLOTS - 1;
+static const uint64_t TW_RANGE = (uint64_t)1 << (TW_BITS * TW_LEVELS);   // zasieg kola w tickach
+
+void tw_init(tw_wheel_t* w, uint64_t now) {
+    memset(w, 0, sizeof(*w));
+    w->now = now;
+    for (int l = 0; l < TW_LEVELS; l++) {
+        for (int s = 0; s < TW_SLOTS; s++) {
+            tw_timer_t* h = &w->heads[l][s];
+            h->next = h->prev = h;
+        }
+    }
+}
+
+void tw_timer_init(tw_timer_t* t, int32_t id, int32_t tag) {
+    t->next = t->prev = NULL;
+    t->expires = 0;
+    t->id = id;
+    t->tag = tag;
+    t->bucket = -1;
+}
+
+int tw_armed(const tw_timer_t* t) {
+    return t->next != NULL;
+}
+
+// Kubelek wg odleglosci od now: poziom l trzyma odleglosci [64^l, 64^(l+1)).
+// min_delta 0 tylko przy kaskadzie: biezacy kubelek poziomu 0 jest oprozniany zaraz po niej.
+static void tw_place(tw_wheel_t* w, tw_timer_t* t, uint64_t min_delta) {
+    uint64_t exp = t->expires >= w->now + min_delta ? t->expires : w->now + min_delta;   // zalegly
+    if (exp - w->now >= TW_RANGE) exp = w->now + TW_RANGE - 1;      // poza zasiegiem: kaskada przelozy go ponownie
+    const uint64_t delta = exp - w->now;
+    int level = 0;
+    while (level < TW_LEVELS - 1 && delta >= ((uint64_t)1 << (TW_BITS * (level + 1)))) level++;
+    const int slot = (int)((exp >> (TW_BITS * level)) & TW_MASK);
+
+    tw_timer_t* h = &w->heads[level][slot];
+    t->next = h;
+    t->prev = h->prev;
+    h->prev->next = t;
+    h->prev = t;
+    t->bucket = level * TW_SLOTS + slot;
+    w->occupied[level] |= 1ULL << slot;
+}
+
+static void tw_unlink(tw_wheel_t* w, tw_timer_t* t) {
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+    const int level = t->bucket / TW_SLOTS, slot = t->bucket % TW_SLOTS;
+    const tw_timer_t* h = &w->heads[level][slot];
+    if (h->next == h) w->occupied[level] &= ~(1ULL << slot);
+    t->bucket = -1;
+}
+
+void tw_add(tw_wheel_t* w, tw_timer_t* t, uint64_t expires) {
+    if (tw_armed(t)) tw_unlink(w, t);
+    else w->count++;
+    t->expires = expires;
+    tw_place(w, t, 1);
+}
+
+void tw_cancel(tw_wheel_t* w, tw_timer_t* t) {
+    if (!tw_armed(t)) return;
+    tw_unlink(w, t);
+    w->count--;
+}
+
+// Kubelek wyzszego poziomu: kazdy timer trafia blizej (zostal mu juz krotszy dystans)
+static void tw_cascade(tw_wheel_t* w, int level, int slot) {
+    tw_timer_t* h = &w->heads[level][slot];
+    if (h->next == h) return;
+    tw_timer_t* t = h->next;
+    tw_timer_t* const last = h->prev;
+    h->next = h->prev = h;
+    w->occupied[level] &= ~(1ULL << slot);
+    for (;;) {
+        tw_timer_t* const nx = t->next;
+        const int done = (t == last);
+        tw_place(w, t, 0);
+        if (done) break;
+        t = nx;
+    }
+}
+
+int tw_advance(tw_wheel_t* w, uint64_t now, tw_expire_fn fn, void* arg) {
+    int fired = 0;
+    while (w->now < now) {
+        if (w->count == 0) {   // puste kolo: nie ma czego kaskadowac
+            w->now = now;
+            break;
+        }
+        w->now++;
+        for (int l = 1; l < TW_LEVELS; l++) {
+            if ((w->now & (((uint64_t)1 << (TW_BITS * l)) - 1)) != 0) break;
+            tw_cascade(w, l, (int)((w->now >> (TW_BITS * l)) & TW_MASK));
+        }
+        tw_timer_t* h = &w->heads[0][w->now & TW_MASK];
+        while (h->next != h) {
+            tw_timer_t* t = h->next;
+            tw_unlink(w, t);
+            w->count--;
+            fired++;
+            if (fn) fn(t, arg);
+        }
+    }
+    return fired;
+}
+
+int64_t tw_next(const tw_wheel_t* w) {
+    if (w->count == 0) return -1;
+    const int cur = (int)(w->now & TW_MASK);
+    int64_t best = INT64_MAX;
+
+    // poziom 0 trzyma odleglosci 1..63: pierwszy niepusty kubelek za biezacym
+    const uint64_t occ = w->occupied[0];
+    if (occ) {
+        const int sh = (cur + 1) & (int)TW_MASK;
+        const uint64_t rot = sh ? ((occ >> sh) | (occ << (64 - sh))) : occ;
+        best = (int64_t)__builtin_ctzll(rot) + 1;
+    }
+    // wyzsze poziomy: nic nie wygasnie przed najblizsza kaskada
+    for (int l = 1; l < TW_LEVELS; l++) {
+        if (!w->occupied[l]) continue;
+        const int64_t to_cascade = TW_SLOTS - cur;
+        if (to_cascade < best) best = to_cascade;
+        break;
+    }
+    return best;
+}
@@ -0,0 +1,57 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+// Hierarchiczne kolo czasowe (jak timery jadra): TW_LEVELS poziomow po TW_SLOTS kubelkow,
+// poziom l ma rozdzielczosc TW_SLOTS^l tickow. Dodanie i anulowanie O(1) (lista dwukierunkowa
+// z wezlem w timerze, bez alokacji); timer wyzszego poziomu schodzi nizej (kaskada) najwyzej
+// TW_LEVELS-1 razy, wiec wygaszanie jest O(1) zamortyzowane na timer.
+// Tick jest abstrakcyjny: kapitan uzywa kola w ms (cierpliwosc pasazerow) i kol w odplywach
+// (limit opuszczonych rejsow). Kolo jest lokalne dla procesu (nie w SHM), jeden watek.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    enum { TW_BITS = 6, TW_SLOTS = 1 << TW_BITS, TW_LEVELS = 4 };
+
+    typedef struct tw_timer {
+        struct tw_timer* next;   // NULL = nieuzbrojony
+        struct tw_timer* prev;
+        uint64_t expires;        // tick wygasniecia
+        int32_t id;              // dane uzytkownika (np. slot pasazera)
+        int32_t tag;
+        int32_t bucket;          // poziom * TW_SLOTS + kubelek (wewnetrzne)
+    } tw_timer_t;
+
+    typedef struct {
+        uint64_t now;                               // biezacy tick
+        tw_timer_t heads[TW_LEVELS][TW_SLOTS];      // glowy list (wartownicy)
+        uint64_t occupied[TW_LEVELS];               // bitmapa niepustych kubelkow
+        int32_t count;                              // uzbrojone timery
+    } tw_wheel_t;
+
+    typedef void (*tw_expire_fn)(tw_timer_t* t, void* arg);
+
+    void tw_init(tw_wheel_t* w, uint64_t now);
+    void tw_timer_init(tw_timer_t* t, int32_t id, int32_t tag);
+    int tw_armed(const tw_timer_t* t);
+
+    // Uzbrojenie na tick expires (<= now: wygasa przy najblizszym tw_advance); uzbrojony = przestawienie
+    void tw_add(tw_wheel_t* w, tw_timer_t* t, uint64_t expires);
+    void tw_cancel(tw_wheel_t* w, tw_timer_t* t);
+
+    // Przesuwa kolo do now i wola fn dla kazdego wygaslego (fn moze uzbroic timer ponownie).
+    // Zwraca liczbe wygaslych.
+    int tw_advance(tw_wheel_t* w, uint64_t now, tw_expire_fn fn, void* arg);
+
+    // Za ile tickow od w->now moze cos wygasnac (dolne oszacowanie, >= 1); -1 = puste kolo.
+    // Przy timerach na wyzszych poziomach najwyzej do najblizszej kaskady (TW_SLOTS tickow).
+    int64_t tw_next(const tw_wheel_t* w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMERWHEEL_H
@@ -3,6 +3,9 @@
 #include "cli.h"
 #include "util.h"
 #include "logging.h"
+#include "procstats.h"
+#include "results.h"
+#include "workload.h"
 
 #include <errno.h>
 #include <fcntl.h>
@@ -40,6 +43,18 @@ static void spawn_exec(const char* path, char* const argvv[], pid_t* out_pid) {
     if (out_pid) *out_pid = pid;
 }
 
+// Dopisuje "<opt> <val>" w miejsce pierwszego NULL (tablica musi miec zapas dwoch pozycji + NULL)
+static void argv_add(char** argvv, const char* opt, char* val) {
+    int i = 0;
+    while (argvv[i]) i++;
+    argvv[i] = (char*)opt;
+    argvv[i + 1] = val;
+}
+
+static void argv_add_results(char** argvv, int results_fd, char* fd_buf) {
+    if (results_fd >= 0) argv_add(argvv, "--results-fd", fd_buf);
+}
+
 static int proc_limit_ok(int want_children) {
     struct rlimit rl;
     if (getrlimit(RLIMIT_NPROC, &rl) != 0) {
@@ -54,12 +69,40 @@ static int proc_limit_ok(int want_children) {
     return 1;
 }
 
+static void reclaim_passenger(ipc_handles_t* ipc, logger_t* lg, const pid_t* pids, int P,
+    pid_t dead, int status) {
+    int id = -1;
+    for (int i = 0; pids && i < P; i++) {
+        if (pids[i] == dead) { id = i; break; }
+    }
+    if (id < 0 || state_lock(ipc) != 0) return;
+    passenger_slot_t* sl = slot_get(ipc->shm, id);
+    int on_bridge = sl->ring_idx >= 0;
+    int units = sl->held_units, seat = sl->held_seat, bike = sl->held_bike, onboard = sl->onboard;
+    int any = slot_reclaim_locked(ipc->shm, id);
+    if (any) ipc->shm->reclaimed_slots++;
+    state_unlock(ipc);
+
+    if (any) {
+        logf(lg, "launcher", "RECLAIM passenger pid=%d slot=%d sig=%d bridge_node=%d units=%d seat=%d bike=%d onboard=%d",
+            (int)dead, id, WIFSIGNALED(status) ? WTERMSIG(status) : 0, on_bridge, units, seat, bike, onboard);
+    }
+}
+
 int main(int argc, char** argv) {
     cli_args_t args;
     int pr = cli_parse_launcher(argc, argv, &args);
     if (pr == 1) return 0;
     if (pr != 0) { cli_print_usage_tramwaj(); return 2; }
 
+    // Jawna lista pasazerow z pliku wyznacza P (przed walidacja)
+    workload_t wl;
+    memset(&wl, 0, sizeof(wl));
+    if (args.workload_path[0]) {
+        if (workload_load(args.workload_path, &wl) != 0) return 2;
+        if (wl.count > 0) args.P = wl.count;
+    }
+
     char err[128];
     if (cli_validate_launcher(&args, err, (int)sizeof(err)) != 0) {
         fprintf(stderr, "Invalid args: %s\n", err);
@@ -69,8 +112,9 @@ int main(int argc, char** argv) {
     // Minimalne prawa dostepu do IPC
     umask(0077);
 
-    // Limit procesow: launcher + captain + dispatcher + P
-    int want_children = 2 + args.P;
+    // Limit procesow: launcher + F kapitanow + dispatcher + P (+ checker)
+    const int F = args.fleet.F;
+    int want_children = 1 + F + args.P + (args.check_hz > 0 ? 1 : 0);
     if (!proc_limit_ok(want_children)) {
         fprintf(stderr, "Refusing to spawn %d children: RLIMIT_NPROC too low\n", want_children);
         return 2;
@@ -83,38 +127,15 @@ int main(int argc, char** argv) {
     // Unikalne nazwy IPC zalezne od PID launchera
     pid_t launcher_pid = getpid();
     char shm_name[128];
-    char sem_prefix[128];
     snprintf(shm_name, sizeof(shm_name), "/tramwaj_shm_%d", (int)launcher_pid);
-    snprintf(sem_prefix, sizeof(sem_prefix), "/tramwaj_%d", (int)launcher_pid);
 
     // Stan poczatkowy SHM
     shm_state_t init;
-    memset(&init, 0, sizeof(init));
-    init.N = args.N;
-    init.M = args.M;
-    init.K = args.K;
-    init.T1_ms = args.T1_ms;
-    init.T2_ms = args.T2_ms;
-    init.R = args.R;
-    init.P = args.P;
-
-    init.phase = PHASE_LOADING;
-    init.direction = DIR_KRAKOW_TO_TYNIEC;
-    init.boarding_open = 1;
-    init.trip_no = 0;
-    init.shutdown = 0;
-    init.onboard_passengers = 0;
-    init.onboard_bikes = 0;
-
-    init.bridge.dir = BRIDGE_DIR_NONE;
-    init.bridge.load_units = 0;
-    init.bridge.count = 0;
-    init.bridge.head = 0;
-    init.bridge.tail = 0;
+    cli_fill_state(&args, &init);
 
     ipc_handles_t ipc;
     int msqid = -1;
-    if (ipc_create(&ipc, shm_name, sem_prefix, &init, &msqid) != 0) {
+    if (ipc_create(&ipc, shm_name, &init, &msqid) != 0) {
         fprintf(stderr, "Failed to create IPC\n");
         return 1;
     }
@@ -138,7 +159,7 @@ int main(int argc, char** argv) {
         usleep(300 * 1000);
         kill(-sim_pgid, SIGKILL);
         usleep(200 * 1000);
-        ipc_destroy(shm_name, sem_prefix, msqid);
+        ipc_destroy(shm_name, msqid);
         _exit(0);
     }
 
@@ -146,95 +167,185 @@ int main(int argc, char** argv) {
 
     (void)unlink(args.log_path);
     logger_t lg;
-    if (logger_open(&lg, args.log_path, ipc.sem_log) != 0) {
+    if (logger_open(&lg, args.log_path, ipc.mtx_log) != 0) {
         fprintf(stderr, "Failed to open log\n");
         ipc_close(&ipc);
         close(guard_pipe[1]);
         return 1;
     }
-    logf(&lg, "launcher", "IPC created shm=%s sem_prefix=%s msqid=%d", shm_name, sem_prefix, msqid);
+    logf(&lg, "launcher", "IPC created shm=%s size=%zu msqid=%d clock=%s sync=%s", shm_name, ipc.shm_size, msqid,
+        clock_source_str(), sync_backend_name());
+
+    // Dzieci dziedzicza deskryptory SHM i logu przez execv: jedno mmap, bez shm_open/open po nazwie
+    int shm_fd = ipc_share_fd(&ipc);
+    if (shm_fd < 0) die_perror("ipc_share_fd");
+
+    // Plik wynikow kolumnowych: deskryptor dziedziczony przez kapitana i pasazerow
+    int results_fd = -1;
+    char results_fd_buf[16];
+    if (args.results_path[0]) {
+        results_fd = results_create(args.results_path, (uint32_t)(F * args.R), (uint32_t)args.P);
+        if (results_fd < 0) die_perror("results_create");
+        logf(&lg, "launcher", "results file %s (trips=%d passengers=%d)", args.results_path, F * args.R, args.P);
+    }
+    snprintf(results_fd_buf, sizeof(results_fd_buf), "%d", results_fd);
 
-    // Spawn captain
-    char msqid_buf[32];
+    // Spawn captains (jeden na statek floty)
+    char msqid_buf[32], shm_fd_buf[16], log_fd_buf[16];
     snprintf(msqid_buf, sizeof(msqid_buf), "%d", msqid);
+    snprintf(shm_fd_buf, sizeof(shm_fd_buf), "%d", shm_fd);
+    snprintf(log_fd_buf, sizeof(log_fd_buf), "%d", lg.fd);
+
+    pid_t captain_pids[MAX_F];
+    for (int i = 0; i < F; i++) {
+        char ship_buf[8];
+        snprintf(ship_buf, sizeof(ship_buf), "%d", i);
+        char* captain_argv[] = {
+          (char*)"./captain",
+          (char*)"--shm", shm_name,
+          (char*)"--shm-fd", shm_fd_buf,
+          (char*)"--msqid", msqid_buf,
+          (char*)"--log", args.log_path,
+          (char*)"--log-fd", log_fd_buf,
+          (char*)"--ship", ship_buf,
+          NULL, NULL, NULL
+        };
+        argv_add_results(captain_argv, results_fd, results_fd_buf);
 
-    char* captain_argv[] = {
-      (char*)"./captain",
-      (char*)"--shm", shm_name,
-      (char*)"--sem-prefix", sem_prefix,
-      (char*)"--msqid", msqid_buf,
-      (char*)"--log", args.log_path,
-      NULL
-    };
-
-    pid_t captain_pid = -1;
-    spawn_exec("./captain", captain_argv, &captain_pid);
-    logf(&lg, "launcher", "spawned captain pid=%d", (int)captain_pid);
+        captain_pids[i] = -1;
+        spawn_exec("./captain", captain_argv, &captain_pids[i]);
+        logf(&lg, "launcher", "spawned captain ship=%d pid=%d N=%d M=%d offset_ms=%d", i, (int)captain_pids[i],
+            (int)ipc.shm->ships[i].N, (int)ipc.shm->ships[i].M, (int)ipc.shm->ships[i].offset_ms);
 
-    // Zapisz PID kapitana w SHM
-    while (sem_wait(ipc.sem_state) != 0) { if (errno == EINTR) continue; die_perror("sem_wait"); }
-    ipc.shm->captain_pid = captain_pid;
-    if (sem_post(ipc.sem_state) != 0) die_perror("sem_post");
+        // Zapisz PID kapitana w SHM
+        if (state_lock(&ipc) != 0) die_perror("state_lock");
+        ipc.shm->ships[i].captain_pid = captain_pids[i];
+        state_unlock(&ipc);
+    }
 
     // Spawn dispatcher
     char* dispatcher_argv[] = {
       (char*)"./dispatcher",
       (char*)"--shm", shm_name,
-      (char*)"--sem-prefix", sem_prefix,
+      (char*)"--shm-fd", shm_fd_buf,
       (char*)"--msqid", msqid_buf,
       (char*)"--log", args.log_path,
-      NULL
+      (char*)"--log-fd", log_fd_buf,
+      NULL, NULL, NULL, NULL, NULL, NULL, NULL
     };
+    if (args.dispatch_policy[0]) argv_add(dispatcher_argv, "--policy", args.dispatch_policy);
+    if (args.control_path[0]) argv_add(dispatcher_argv, "--control", args.control_path);
+    if (args.control_script[0]) argv_add(dispatcher_argv, "--script", args.control_script);
     pid_t dispatcher_pid = -1;
     spawn_exec("./dispatcher", dispatcher_argv, &dispatcher_pid);
     logf(&lg, "launcher", "spawned dispatcher pid=%d", (int)dispatcher_pid);
 
+    // Spawn checker (opcjonalny kontroler niezmiennikow z budzetem CPU)
+    pid_t checker_pid = -1;
+    if (args.check_hz > 0) {
+        char hz_buf[16], pct_buf[16];
+        snprintf(hz_buf, sizeof(hz_buf), "%d", (int)args.check_hz);
+        snprintf(pct_buf, sizeof(pct_buf), "%d", (int)args.check_cpu_pct);
+        char* checker_argv[] = {
+          (char*)"./checker",
+          (char*)"--shm", shm_name,
+          (char*)"--shm-fd", shm_fd_buf,
+          (char*)"--msqid", msqid_buf,
+          (char*)"--log", args.log_path,
+          (char*)"--log-fd", log_fd_buf,
+          (char*)"--hz", hz_buf,
+          (char*)"--cpu-pct", pct_buf,
+          NULL
+        };
+        spawn_exec("./checker", checker_argv, &checker_pid);
+        logf(&lg, "launcher", "spawned checker pid=%d hz=%d cpu_pct=%d", (int)checker_pid,
+            (int)args.check_hz, (int)args.check_cpu_pct);
+    }
+
     // Spawn passengers
-    // Pasazerowie losuja kierunek (0/1) i rower wg bike_prob
-    srand((unsigned)launcher_pid);
+    // Kierunek (0/1) i rower z obciazenia: jawna lista z --workload albo generacja z ziarna
+    // (--seed > seed z pliku > PID launchera); ziarno idzie do logu, wiec kazdy przebieg da sie powtorzyc
+    const char* wl_source = "file";
+    if (wl.count == 0) {
+        uint64_t seed = args.has_seed ? args.seed : (wl.has_seed ? wl.seed : (uint64_t)launcher_pid);
+        if (workload_generate(&wl, seed, args.P, args.bike_prob) != 0) die_perror("workload_generate");
+        wl_source = "seed";
+    }
+    logf(&lg, "launcher", "workload source=%s seed=%llu passengers=%d", wl_source,
+        (unsigned long long)wl.seed, wl.count);
 
     pid_t* passenger_pids = (pid_t*)calloc((size_t)args.P, sizeof(pid_t));
     if (!passenger_pids && args.P > 0) die_perror("calloc");
 
+    const int64_t spawn_t0 = now_ms_monotonic();
+    int spawned = 0;
     for (int i = 0; i < args.P; i++) {
         if (g_shutdown) break;
 
-        int dir = rand() % 2;
-        double r01 = (double)rand() / (double)RAND_MAX;
-        int bike = (r01 < args.bike_prob) ? 1 : 0;
+        // odtworzenie momentu przyjscia (offset od pierwszego pasazera), w krokach, zeby nie gubic shutdown
+        workload_pax_t* wp = &wl.pax[i];
+        for (;;) {
+            int64_t left = spawn_t0 + wp->offset_ms - now_ms_monotonic();
+            if (left <= 0 || g_shutdown) break;
+            sleep_ms(left > 50 ? 50 : (int)left);
+        }
+        if (g_shutdown) break;
+        // nagranie zapisuje faktyczny moment startu
+        wp->offset_ms = (int32_t)(now_ms_monotonic() - spawn_t0);
 
-        char dir_buf[8], bike_buf[8];
+        int dir = wp->dir;
+        int bike = wp->bike;
+
+        char dir_buf[8], bike_buf[8], id_buf[16];
         snprintf(dir_buf, sizeof(dir_buf), "%d", dir);
         snprintf(bike_buf, sizeof(bike_buf), "%d", bike);
+        snprintf(id_buf, sizeof(id_buf), "%d", i);
 
         char* pass_argv[] = {
           (char*)"./passenger",
           (char*)"--shm", shm_name,
-          (char*)"--sem-prefix", sem_prefix,
+          (char*)"--shm-fd", shm_fd_buf,
           (char*)"--msqid", msqid_buf,
           (char*)"--log", args.log_path,
+          (char*)"--log-fd", log_fd_buf,
           (char*)"--dir", dir_buf,
           (char*)"--bike", bike_buf,
-          NULL
+          (char*)"--id", id_buf,
+          NULL, NULL, NULL
         };
+        argv_add_results(pass_argv, results_fd, results_fd_buf);
 
         pid_t pp = -1;
         spawn_exec("./passenger", pass_argv, &pp);
         passenger_pids[i] = pp;
+        spawned++;
     }
 
+    if (args.record_workload_path[0]) {
+        wl.count = spawned;
+        if (workload_save(args.record_workload_path, &wl) == 0) {
+            logf(&lg, "launcher", "workload recorded to %s (passengers=%d)", args.record_workload_path, spawned);
+        }
+    }
+    workload_free(&wl);
+
+    // Rozliczanie zasobow dzieci (wait4 + rusage)
+    procstats_t ps;
+    if (procstats_init(&ps, want_children) != 0) die_perror("procstats_init");
+
     // glowna petla czekania
     int alive = want_children;
     while (alive > 0) {
         if (g_shutdown) {
             logf(&lg, "launcher", "shutdown requested, signalling children...");
 
-            if (captain_pid > 1) {
-                if (kill(captain_pid, SIGTERM) != 0) perror("kill(SIGTERM captain)");
+            for (int i = 0; i < F; i++) {
+                if (captain_pids[i] > 1 && kill(captain_pids[i], SIGTERM) != 0) perror("kill(SIGTERM captain)");
             }
             if (dispatcher_pid > 1) {
                 if (kill(dispatcher_pid, SIGTERM) != 0) perror("kill(SIGTERM dispatcher)");
             }
+            if (checker_pid > 1 && kill(checker_pid, SIGTERM) != 0) perror("kill(SIGTERM checker)");
             for (int i = 0; i < args.P; i++) {
                 if (passenger_pids && passenger_pids[i] > 1) {
                     if (kill(passenger_pids[i], SIGTERM) != 0) perror("kill(SIGTERM passenger)");
@@ -243,12 +354,13 @@ int main(int argc, char** argv) {
 
             sleep_ms(500);
 
-            if (captain_pid > 1) {
-                if (kill(captain_pid, SIGKILL) != 0) perror("kill(SIGKILL captain)");
+            for (int i = 0; i < F; i++) {
+                if (captain_pids[i] > 1 && kill(captain_pids[i], SIGKILL) != 0) perror("kill(SIGKILL captain)");
             }
             if (dispatcher_pid > 1) {
                 if (kill(dispatcher_pid, SIGKILL) != 0) perror("kill(SIGKILL dispatcher)");
             }
+            if (checker_pid > 1 && kill(checker_pid, SIGKILL) != 0) perror("kill(SIGKILL checker)");
             for (int i = 0; i < args.P; i++) {
                 if (passenger_pids && passenger_pids[i] > 1) {
                     if (kill(passenger_pids[i], SIGKILL) != 0) perror("kill(SIGKILL passenger)");
@@ -259,20 +371,48 @@ int main(int argc, char** argv) {
         }
 
         int status = 0;
-        pid_t w = waitpid(-1, &status, 0);
+        struct rusage ru;
+        pid_t w = wait4(-1, &status, 0, &ru);
         if (w < 0) {
             if (errno == EINTR) continue;
-            perror("waitpid");
+            perror("wait4");
             break;
         }
+        proc_role_t role = ROLE_PASSENGER;
+        if (w == dispatcher_pid) role = ROLE_DISPATCHER;
+        if (w == checker_pid) role = ROLE_CHECKER;
+        for (int i = 0; i < F; i++) {
+            if (w == captain_pids[i]) role = ROLE_CAPTAIN;
+        }
+        procstats_add(&ps, w, role, &ru);
         alive--;
+
+        // Pasazer zginal (sygnal / blad): odzyskaj z ksiegi w SHM to, czego nie zdazyl oddac
+        if (role == ROLE_PASSENGER && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+            reclaim_passenger(&ipc, &lg, passenger_pids, args.P, w, status);
+        }
     }
 
+    if (state_lock(&ipc) == 0) {
+        logf(&lg, "launcher", "ROBUST lock_recoveries=%d reclaimed_slots=%d",
+            ipc.shm->lock_recoveries, ipc.shm->reclaimed_slots);
+        const lock_stats_t* ls = &ipc.shm->sync.state_stats;
+        logf(&lg, "launcher", "LOCK impl=%s acquisitions=%llu contended=%llu (%.2f%%) spins=%llu parks=%llu wait_ms=%.2f",
+            state_lock_impl(), (unsigned long long)ls->acquisitions, (unsigned long long)ls->contended,
+            ls->acquisitions ? 100.0 * (double)ls->contended / (double)ls->acquisitions : 0.0,
+            (unsigned long long)ls->spins, (unsigned long long)ls->parks, (double)ls->wait_ns / 1e6);
+        state_unlock(&ipc);
+    }
+
+    procstats_report(&ps, &lg, 5);
+    procstats_free(&ps);
+
     logf(&lg, "launcher (tramwaj)", "children finished, cleaning up IPC");
     logger_close(&lg);
 
     ipc_close(&ipc);
-    ipc_destroy(shm_name, sem_prefix, msqid);
+    ipc_destroy(shm_name, msqid);
+    if (results_fd >= 0) close(results_fd);
     free(passenger_pids);
     if (guard_pipe[1] >= 0) {
         char bye = 0;
@@ -0,0 +1,653 @@
+// Demon symulacji do serii przebiegow (np. przegladow parametrow).
+// Zamiast tworzyc IPC i P procesow od zera przy kazdym ./tramwaj, demon raz tworzy SHM
+// (pojemnosc --max-P/--max-K) i kolejke komunikatow oraz trzyma pule workerow pasazerow
+// (fork bez execv, juz podlaczonych do SHM i logu). Konfiguracje przebiegow przychodza
+// gniazdem UNIX jako linie z opcjami ./tramwaj; miedzy przebiegami stan SHM jest zerowany
+// w miejscu (ipc_reset), a przebieg strumieniuje wyniki tym samym gniazdem.
+//
+// Protokol (linie tekstu):
+//   -> run <opcje jak ./tramwaj>      <- ok run=... | trip ... (po kazdym rejsie) | done ... | error <opis>
+//   -> stop                           <- ok stop (demon konczy prace)
+// Worker i obsluguje slot pasazera i (jeden worker = jeden slot, wiec komunikaty CMD_EVICT
+// adresowane PID-em nie trafia do innego pasazera tego samego przebiegu).
+
+#include "common.h"
+#include "cli.h"
+#include "events.h"
+#include "futex.h"
+#include "ipc.h"
+#include "logging.h"
+#include "passenger.h"
+#include "util.h"
+#include "workload.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum { LINE_MAX_LEN = 4096, RUN_MAX_ARGS = 64 };
+
+static volatile sig_atomic_t g_shutdown = 0;
+static volatile sig_atomic_t g_worker_quit = 0;
+
+static void on_term(int) { g_shutdown = 1; }
+
+static void on_worker_term(int) {
+    g_worker_quit = 1;
+    passenger_request_exit();
+}
+
+static void set_handlers(void (*fn)(int)) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = fn;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;   // bez SA_RESTART: poll/accept wracaja z EINTR
+    if (sigaction(SIGINT, &sa, NULL) != 0) die_perror("sigaction(SIGINT)");
+    if (sigaction(SIGTERM, &sa, NULL) != 0) die_perror("sigaction(SIGTERM)");
+    if (sigaction(SIGHUP, &sa, NULL) != 0) die_perror("sigaction(SIGHUP)");
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "Usage:\n"
+        "  tramwajd [--socket <path>] [--max-P <int>] [--max-K <int>] [--max-F <int>] [--max-G <int>]\n"
+        "           [--pool <int>] [--log <path>]\n"
+        "  tramwajd [--socket <path>] --run <tramwaj options...>   (klient: jeden przebieg)\n"
+        "  tramwajd [--socket <path>] --stop                       (klient: zatrzymaj demona)\n"
+        "Example:\n"
+        "  ./tramwajd --max-P 2000 --max-K 50 &\n"
+        "  ./tramwajd --run --N 10 --M 2 --K 4 --T1 300 --T2 200 --R 2 --P 20 --bike-prob 0.3 --seed 1\n");
+}
+
+// ======= Pula workerow (MAP_SHARED|MAP_ANONYMOUS, dziedziczona przez fork) =======
+typedef enum {
+    W_IDLE = 0,
+    W_JOB = 1,      // demon wpisal zadanie
+    W_BUSY = 2,     // worker wykonuje passenger_run
+    W_QUIT = 3
+} worker_state_t;
+
+typedef struct {
+    uint32_t wake;      // futex: demon -> worker (zadanie / koniec)
+    int32_t state;      // worker_state_t
+    int32_t dir;
+    int32_t bike;
+    pid_t pid;          // 0 = brak procesu (jeszcze nie uruchomiony albo zginal)
+} worker_t;
+
+typedef struct {
+    uint32_t done_wake;   // futex: worker -> demon (zadanie skonczone)
+    int32_t busy;         // zadania w toku (JOB + BUSY)
+    int32_t boarded;      // wejscia na statek w biezacym przebiegu
+    int32_t cap;
+} pool_hdr_t;
+
+typedef struct {
+    char sock_path[108];
+    char log_path[256];
+    int32_t max_P, max_K, max_F, max_G, pool_init;
+
+    char shm_name[128];
+    ipc_handles_t ipc;
+    int msqid;
+    int shm_fd;
+    logger_t lg;
+
+    pool_hdr_t* pool;
+    worker_t* workers;
+    size_t pool_size;
+
+    int listen_fd;
+    int client_fd;
+    int client_gone;
+    int runs;
+} daemon_t;
+
+// Statystyki przebiegu zbierane z szyny zdarzen
+typedef struct {
+    int64_t t0;
+    int trips, left, evicted, exits;
+    int trip_dir[MAX_F];   // kierunek biezacego rejsu statku (z EV_TRIP_START)
+} run_stats_t;
+
+static int pool_create(daemon_t* d) {
+    const size_t hdr = (sizeof(pool_hdr_t) + 63) & ~(size_t)63;
+    d->pool_size = hdr + (size_t)d->max_P * sizeof(worker_t);
+    void* p = mmap(NULL, d->pool_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) { perror("mmap(pool)"); return -1; }
+    d->pool = (pool_hdr_t*)p;
+    d->workers = (worker_t*)((char*)p + hdr);
+    d->pool->cap = d->max_P;
+    return 0;
+}
+
+static void worker_main(daemon_t* d, int idx) {
+    set_handlers(on_worker_term);
+    signal(SIGPIPE, SIG_DFL);
+    worker_t* w = &d->workers[idx];
+    results_writer_t nores;                 // wyniki ida gniazdem (szyna zdarzen), nie do pliku
+    memset(&nores, 0, sizeof(nores));
+
+    while (!g_worker_quit) {
+        const uint32_t seq = __atomic_load_n(&w->wake, __ATOMIC_ACQUIRE);
+        const int st = __atomic_load_n(&w->state, __ATOMIC_ACQUIRE);
+        if (st == W_QUIT) break;
+        if (st != W_JOB) {
+            (void)futex_wait(&w->wake, seq, -1);
+            continue;
+        }
+        __atomic_store_n(&w->state, W_BUSY, __ATOMIC_RELEASE);
+        const int b = passenger_run(&d->ipc, &d->lg, &nores, idx, w->dir, w->bike);
+        if (b > 0) __atomic_fetch_add(&d->pool->boarded, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&w->state, W_IDLE, __ATOMIC_RELEASE);
+        __atomic_fetch_sub(&d->pool->busy, 1, __ATOMIC_ACQ_REL);
+        __atomic_fetch_add(&d->pool->done_wake, 1, __ATOMIC_RELEASE);
+        (void)futex_wake(&d->pool->done_wake, 1);
+    }
+    _exit(0);
+}
+
+static int worker_spawn(daemon_t* d, int idx) {
+    worker_t* w = &d->workers[idx];
+    w->state = W_IDLE;
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork(worker)"); return -1; }
+    if (pid == 0) {
+        if (d->listen_fd >= 0) close(d->listen_fd);
+        if (d->client_fd >= 0) close(d->client_fd);
+        worker_main(d, idx);
+    }
+    w->pid = pid;
+    return 0;
+}
+
+// Pula pokrywa sloty 0..n-1 (dobiera brakujace i zastepuje martwe workery)
+static int pool_ensure(daemon_t* d, int n) {
+    int spawned = 0;
+    for (int i = 0; i < n; i++) {
+        if (d->workers[i].pid > 0) continue;
+        if (worker_spawn(d, i) != 0) return -1;
+        spawned++;
+    }
+    if (spawned > 0) logf(&d->lg, "tramwajd", "pool: spawned %d workers (slots 0..%d)", spawned, n - 1);
+    return spawned;
+}
+
+static void pool_post(daemon_t* d, int idx, int dir, int bike) {
+    worker_t* w = &d->workers[idx];
+    w->dir = dir;
+    w->bike = bike;
+    __atomic_fetch_add(&d->pool->busy, 1, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&w->state, W_JOB, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&w->wake, 1, __ATOMIC_RELEASE);
+    (void)futex_wake(&w->wake, 1);
+}
+
+// Zbiera zakonczone dzieci (zakonczony kapitan: -1 w captains[]);
+// smierc workera w trakcie zadania = odzyskanie slotu z ksiegi
+static void reap_children(daemon_t* d, pid_t* captains, int n_captains) {
+    for (;;) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid <= 0) return;
+        int was_captain = 0;
+        for (int c = 0; c < n_captains; c++) {
+            if (captains[c] == pid) { captains[c] = -1; was_captain = 1; }
+        }
+        if (was_captain) continue;
+        for (int i = 0; i < d->max_P; i++) {
+            worker_t* w = &d->workers[i];
+            if (w->pid != pid) continue;
+            w->pid = 0;
+            const int st = __atomic_load_n(&w->state, __ATOMIC_ACQUIRE);
+            if (st == W_JOB || st == W_BUSY) {
+                int any = 0;
+                if (state_lock(&d->ipc) == 0) {
+                    any = slot_reclaim_locked(d->ipc.shm, i);
+                    if (any) d->ipc.shm->reclaimed_slots++;
+                    state_unlock(&d->ipc);
+                }
+                __atomic_store_n(&w->state, W_IDLE, __ATOMIC_RELEASE);
+                __atomic_fetch_sub(&d->pool->busy, 1, __ATOMIC_ACQ_REL);
+                logf(&d->lg, "tramwajd", "RECLAIM worker pid=%d slot=%d sig=%d reclaimed=%d",
+                    (int)pid, i, WIFSIGNALED(status) ? WTERMSIG(status) : 0, any);
+            }
+            break;
+        }
+    }
+}
+
+static void pool_stop(daemon_t* d) {
+    for (int i = 0; i < d->max_P; i++) {
+        worker_t* w = &d->workers[i];
+        if (w->pid <= 0) continue;
+        __atomic_store_n(&w->state, W_QUIT, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&w->wake, 1, __ATOMIC_RELEASE);
+        (void)futex_wake(&w->wake, 1);
+    }
+    for (int i = 0; i < d->max_P; i++) {
+        worker_t* w = &d->workers[i];
+        if (w->pid <= 0) continue;
+        int status;
+        while (waitpid(w->pid, &status, 0) < 0 && errno == EINTR) {}
+        w->pid = 0;
+    }
+}
+
+// ======= Odpowiedzi do klienta =======
+static void reply(daemon_t* d, const char* fmt, ...) {
+    if (d->client_gone || d->client_fd < 0) return;
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf) - 1, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (n > (int)sizeof(buf) - 2) n = (int)sizeof(buf) - 2;
+    buf[n++] = '\n';
+    for (int off = 0; off < n;) {
+        ssize_t w = send(d->client_fd, buf + off, (size_t)(n - off), MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) { d->client_gone = 1; return; }
+        off += (int)w;
+    }
+}
+
+static void stream_events(daemon_t* d, ev_cursor_t* cur, run_stats_t* rs) {
+    event_t e;
+    while (ev_next(d->ipc.shm, cur, &e)) {
+        switch (e.type) {
+        case EV_TRIP_START:
+            if (e.ship >= 0 && e.ship < MAX_F) rs->trip_dir[e.ship] = e.a;
+            break;
+        case EV_TRIP_END:
+            rs->trips++;
+            reply(d, "trip ship=%d trip=%d dir=%d pax=%d bikes=%d t_ms=%lld",
+                e.ship, e.trip, (e.ship >= 0 && e.ship < MAX_F) ? rs->trip_dir[e.ship] : -1, e.a, e.b,
+                (long long)(e.t_ns / 1000000 - rs->t0));
+            break;
+        case EV_LEAVE_SHIP: rs->left++; break;
+        case EV_EVICTED:
+        case EV_EVICT_FORCED: rs->evicted++; break;
+        case EV_PASSENGER_EXIT: rs->exits++; break;
+        default: break;
+        }
+    }
+}
+
+// Przerwanie przebiegu (klient rozlaczony / SIGTERM demona): jak shutdown w launcherze
+static void run_abort(daemon_t* d, const pid_t* captains, int n_captains) {
+    if (state_lock(&d->ipc) == 0) {
+        d->ipc.shm->shutdown = 1;
+        state_unlock(&d->ipc);
+    }
+    phase_publish(d->ipc.shm);
+    for (int c = 0; c < n_captains; c++) {
+        if (captains[c] > 1) kill(captains[c], SIGTERM);
+    }
+}
+
+static int captains_alive(const pid_t* captains, int n_captains) {
+    int n = 0;
+    for (int c = 0; c < n_captains; c++) n += captains[c] > 0;
+    return n;
+}
+
+static pid_t spawn_captain(daemon_t* d, int ship) {
+    char msqid_buf[32], shm_fd_buf[16], log_fd_buf[16], ship_buf[8];
+    snprintf(ship_buf, sizeof(ship_buf), "%d", ship);
+    snprintf(msqid_buf, sizeof(msqid_buf), "%d", d->msqid);
+    snprintf(shm_fd_buf, sizeof(shm_fd_buf), "%d", d->shm_fd);
+    snprintf(log_fd_buf, sizeof(log_fd_buf), "%d", d->lg.fd);
+    char* captain_argv[] = {
+      (char*)"./captain",
+      (char*)"--shm", d->shm_name,
+      (char*)"--shm-fd", shm_fd_buf,
+      (char*)"--msqid", msqid_buf,
+      (char*)"--log", d->log_path,
+      (char*)"--log-fd", log_fd_buf,
+      (char*)"--ship", ship_buf,
+      NULL
+    };
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork(captain)"); return -1; }
+    if (pid == 0) {
+        execv("./captain", captain_argv);
+        die_perror("execv(captain)");
+    }
+    return pid;
+}
+
+// Jedna linia "run ..." -> przebieg na cieplym IPC; 0 ok, -1 blad (zgloszony klientowi)
+static int daemon_run(daemon_t* d, char* opts) {
+    char* argvv[RUN_MAX_ARGS + 1];
+    int argc = 0;
+    argvv[argc++] = (char*)"run";
+    for (char* tok = strtok(opts, " \t\r"); tok; tok = strtok(NULL, " \t\r")) {
+        if (argc >= RUN_MAX_ARGS) { reply(d, "error too many arguments"); return -1; }
+        argvv[argc++] = tok;
+    }
+    argvv[argc] = NULL;
+
+    cli_args_t args;
+    if (cli_parse_launcher(argc, argvv, &args) != 0) { reply(d, "error bad options"); return -1; }
+    if (args.results_path[0]) { reply(d, "error --results not supported (results are streamed)"); return -1; }
+    if (args.check_hz > 0) { reply(d, "error --checker not supported (use ./tramwaj)"); return -1; }
+
+    workload_t wl;
+    memset(&wl, 0, sizeof(wl));
+    if (args.workload_path[0]) {
+        if (workload_load(args.workload_path, &wl) != 0) { reply(d, "error bad workload file"); return -1; }
+        if (wl.count > 0) args.P = wl.count;
+    }
+
+    char err[128];
+    if (cli_validate_launcher(&args, err, (int)sizeof(err)) != 0) {
+        reply(d, "error %s", err);
+        workload_free(&wl);
+        return -1;
+    }
+    if (args.P > d->max_P || args.K > d->max_K || args.fleet.F > d->max_F || args.gangways > d->max_G) {
+        reply(d, "error P/K/F/G over daemon capacity (max-P=%d max-K=%d max-F=%d max-G=%d)",
+            d->max_P, d->max_K, d->max_F, d->max_G);
+        workload_free(&wl);
+        return -1;
+    }
+
+    const int run_no = ++d->runs;
+    const int64_t t0 = now_ms_monotonic();
+    if (wl.count == 0) {
+        uint64_t seed = args.has_seed ? args.seed
+            : (wl.has_seed ? wl.seed : (uint64_t)getpid() * 1000003ULL + (uint64_t)run_no);
+        if (workload_generate(&wl, seed, args.P, args.bike_prob) != 0) {
+            reply(d, "error workload_generate");
+            return -1;
+        }
+    }
+
+    // Cieply start: ten sam SHM i kolejka, stan od zera; workery tylko dobierane, gdy P rosnie
+    shm_state_t cfg;
+    cli_fill_state(&args, &cfg);
+    reap_children(d, NULL, 0);
+    if (ipc_reset(&d->ipc, &cfg) != 0 || pool_ensure(d, args.P) < 0) {
+        reply(d, "error ipc_reset/pool");
+        workload_free(&wl);
+        return -1;
+    }
+    __atomic_store_n(&d->pool->boarded, 0, __ATOMIC_RELAXED);
+
+    ev_cursor_t cur;
+    ev_subscribe(d->ipc.shm, &cur, 0);
+    run_stats_t rs;
+    memset(&rs, 0, sizeof(rs));
+    rs.t0 = t0;
+
+    const int F = args.fleet.F;
+    pid_t captains[MAX_F];
+    for (int c = 0; c < F; c++) {
+        captains[c] = spawn_captain(d, c);
+        if (captains[c] < 0) {
+            reply(d, "error fork captain");
+            run_abort(d, captains, c);
+            workload_free(&wl);
+            return -1;
+        }
+        if (state_lock(&d->ipc) == 0) {
+            d->ipc.shm->ships[c].captain_pid = captains[c];
+            state_unlock(&d->ipc);
+        }
+    }
+    const int64_t setup_ms = now_ms_monotonic() - t0;
+    logf(&d->lg, "tramwajd", "run %d start F=%d N=%d M=%d K=%d T1=%d T2=%d R=%d P=%d seed=%llu captain=%d setup_ms=%lld",
+        run_no, F, args.N, args.M, args.K, args.T1_ms, args.T2_ms, args.R, args.P,
+        (unsigned long long)wl.seed, (int)captains[0], (long long)setup_ms);
+    reply(d, "ok run=%d P=%d seed=%llu setup_ms=%lld", run_no, args.P, (unsigned long long)wl.seed, (long long)setup_ms);
+
+    // Przyjscia wg offsetow obciazenia (jak w launcherze), w miedzyczasie strumien rejsow
+    int aborted = 0;
+    const int64_t post_t0 = now_ms_monotonic();
+    for (int i = 0; i < args.P; i++) {
+        for (;;) {
+            stream_events(d, &cur, &rs);
+            if ((g_shutdown || d->client_gone) && !aborted) { run_abort(d, captains, F); aborted = 1; }
+            int64_t left = post_t0 + wl.pax[i].offset_ms - now_ms_monotonic();
+            if (left <= 0 || aborted) break;
+            sleep_ms(left > 50 ? 50 : (int)left);
+        }
+        if (aborted) break;
+        pool_post(d, i, wl.pax[i].dir, wl.pax[i].bike);
+    }
+    if (args.record_workload_path[0] && !aborted) (void)workload_save(args.record_workload_path, &wl);
+    workload_free(&wl);
+
+    // Koniec przebiegu: wszyscy kapitanowie zakonczyli i zaden worker nie ma zadania
+    for (;;) {
+        reap_children(d, captains, F);
+        const uint32_t dseq = __atomic_load_n(&d->pool->done_wake, __ATOMIC_ACQUIRE);
+        stream_events(d, &cur, &rs);
+        if ((g_shutdown || d->client_gone) && !aborted) { run_abort(d, captains, F); aborted = 1; }
+        const int sailing = captains_alive(captains, F);
+        if (!sailing && __atomic_load_n(&d->pool->busy, __ATOMIC_ACQUIRE) == 0) break;
+        if (!sailing) (void)futex_wait(&d->pool->done_wake, dseq, 50);
+        else (void)ev_wait(d->ipc.shm, &cur, 50);
+    }
+    stream_events(d, &cur, &rs);
+
+    const int64_t wall_ms = now_ms_monotonic() - t0;
+    const int boarded = __atomic_load_n(&d->pool->boarded, __ATOMIC_RELAXED);
+    logf(&d->lg, "tramwajd", "run %d done wall_ms=%lld trips=%d boarded=%d left=%d evicted=%d exits=%d/%d aborted=%d lost=%llu",
+        run_no, (long long)wall_ms, rs.trips, boarded, rs.left, rs.evicted, rs.exits, args.P, aborted,
+        (unsigned long long)cur.lost);
+    reply(d, "done run=%d wall_ms=%lld setup_ms=%lld trips=%d boarded=%d left=%d evicted=%d exits=%d/%d pax_per_s=%.1f lost=%llu%s",
+        run_no, (long long)wall_ms, (long long)setup_ms, rs.trips, boarded, rs.left, rs.evicted, rs.exits, args.P,
+        wall_ms > 0 ? (double)boarded * 1000.0 / (double)wall_ms : 0.0,
+        (unsigned long long)cur.lost, aborted ? " aborted=1" : "");
+    return aborted ? -1 : 0;
+}
+
+// Obsluga jednego polaczenia (komendy po kolei); 1 = "stop"
+static int serve_client(daemon_t* d) {
+    char buf[LINE_MAX_LEN];
+    size_t len = 0;
+    for (;;) {
+        char* nl = (char*)memchr(buf, '\n', len);
+        if (!nl) {
+            if (len == sizeof(buf)) { reply(d, "error line too long"); return 0; }
+            ssize_t n = recv(d->client_fd, buf + len, sizeof(buf) - len, 0);
+            if (n < 0 && errno == EINTR) {
+                if (g_shutdown) return 0;
+                continue;
+            }
+            if (n <= 0) return 0;
+            len += (size_t)n;
+            continue;
+        }
+        *nl = '\0';
+        char* line = buf;
+        if (strcmp(line, "stop") == 0) { reply(d, "ok stop"); return 1; }
+        if (strncmp(line, "run", 3) == 0 && (line[3] == ' ' || line[3] == '\0')) (void)daemon_run(d, line + 3);
+        else reply(d, "error unknown command (run|stop)");
+        if (d->client_gone || g_shutdown) return 0;
+
+        const size_t used = (size_t)(nl + 1 - buf);
+        memmove(buf, nl + 1, len - used);
+        len -= used;
+    }
+}
+
+static int daemon_listen(const char* path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) { perror("socket"); return -1; }
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", path);
+    (void)unlink(path);   // gniazdo po poprzednim demonie
+    if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || listen(fd, 4) != 0) {
+        perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int daemon_main(daemon_t* d) {
+    umask(0077);
+    set_handlers(on_term);
+    signal(SIGPIPE, SIG_IGN);
+
+    // IPC o pojemnosci max-K/max-P/max-F/max-G; N/M/K/F/G konkretnego przebiegu ustawia ipc_reset
+    snprintf(d->shm_name, sizeof(d->shm_name), "/tramwajd_shm_%d", (int)getpid());
+    shm_state_t init;
+    memset(&init, 0, sizeof(init));
+    init.K = d->max_K;
+    init.P = d->max_P;
+    init.F = d->max_F;
+    init.G = d->max_G;
+    if (ipc_create(&d->ipc, d->shm_name, &init, &d->msqid) != 0) {
+        fprintf(stderr, "Failed to create IPC\n");
+        return 1;
+    }
+    d->shm_fd = ipc_share_fd(&d->ipc);
+    if (d->shm_fd < 0) die_perror("ipc_share_fd");
+
+    (void)unlink(d->log_path);
+    if (logger_open(&d->lg, d->log_path, d->ipc.mtx_log) != 0) {
+        fprintf(stderr, "Failed to open log\n");
+        ipc_destroy(d->shm_name, d->msqid);
+        return 1;
+    }
+    if (pool_create(d) != 0) die_perror("pool_create");
+
+    d->client_fd = -1;
+    d->listen_fd = daemon_listen(d->sock_path);
+    if (d->listen_fd < 0) {
+        logger_close(&d->lg);
+        ipc_close(&d->ipc);
+        ipc_destroy(d->shm_name, d->msqid);
+        return 1;
+    }
+    if (pool_ensure(d, d->pool_init) < 0) g_shutdown = 1;
+    logf(&d->lg, "tramwajd", "listening on %s shm=%s size=%zu max-P=%d max-K=%d max-F=%d max-G=%d pool=%d sync=%s",
+        d->sock_path, d->shm_name, d->ipc.shm_size, d->max_P, d->max_K, d->max_F, d->max_G, d->pool_init,
+        sync_backend_name());
+    fprintf(stderr, "tramwajd: listening on %s (max-P=%d max-K=%d max-F=%d max-G=%d pool=%d)\n",
+        d->sock_path, d->max_P, d->max_K, d->max_F, d->max_G, d->pool_init);
+
+    while (!g_shutdown) {
+        struct pollfd pfd;
+        pfd.fd = d->listen_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int pr = poll(&pfd, 1, 1000);
+        reap_children(d, NULL, 0);
+        if (pr <= 0) continue;
+
+        d->client_fd = accept4(d->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (d->client_fd < 0) continue;
+        d->client_gone = 0;
+        const int stop = serve_client(d);
+        close(d->client_fd);
+        d->client_fd = -1;
+        if (stop) break;
+    }
+
+    logf(&d->lg, "tramwajd", "stopping after %d runs", d->runs);
+    close(d->listen_fd);
+    (void)unlink(d->sock_path);
+    pool_stop(d);
+    munmap(d->pool, d->pool_size);
+    logger_close(&d->lg);
+    ipc_close(&d->ipc);
+    ipc_destroy(d->shm_name, d->msqid);
+    return 0;
+}
+
+// ======= Klient =======
+static int client_main(const char* sock_path, const char* line) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) { perror("socket"); return 1; }
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", sock_path);
+    if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) { perror("connect"); close(fd); return 1; }
+
+    const size_t n = strlen(line);
+    if (send(fd, line, n, MSG_NOSIGNAL) != (ssize_t)n) { perror("send"); close(fd); return 1; }
+
+    // Odpowiedzi na stdout, az do linii konczacej (done / error / ok stop)
+    FILE* in = fdopen(fd, "r");
+    if (!in) { perror("fdopen"); close(fd); return 1; }
+    char buf[LINE_MAX_LEN];
+    int rc = 1;
+    while (fgets(buf, sizeof(buf), in)) {
+        fputs(buf, stdout);
+        if (strncmp(buf, "done ", 5) == 0) { rc = strstr(buf, "aborted=1") ? 1 : 0; break; }
+        if (strncmp(buf, "error", 5) == 0) break;
+        if (strncmp(buf, "ok stop", 7) == 0) { rc = 0; break; }
+    }
+    fclose(in);
+    return rc;
+}
+
+int main(int argc, char** argv) {
+    daemon_t d;
+    memset(&d, 0, sizeof(d));
+    snprintf(d.sock_path, sizeof(d.sock_path), "tramwajd.sock");
+    snprintf(d.log_path, sizeof(d.log_path), "tramwajd.log");
+    d.max_P = 1000;
+    d.max_K = 100;
+    d.max_F = MAX_F;
+    d.max_G = MAX_G;
+    d.pool_init = -1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* k = argv[i];
+        int has_val = (i + 1) < argc;
+        int bad = 0;
+        if (strcmp(k, "--socket") == 0 && has_val) snprintf(d.sock_path, sizeof(d.sock_path), "%s", argv[++i]);
+        else if (strcmp(k, "--log") == 0 && has_val) snprintf(d.log_path, sizeof(d.log_path), "%s", argv[++i]);
+        else if (strcmp(k, "--max-P") == 0 && has_val) bad = parse_i32(argv[++i], &d.max_P) != 0;
+        else if (strcmp(k, "--max-K") == 0 && has_val) bad = parse_i32(argv[++i], &d.max_K) != 0;
+        else if (strcmp(k, "--max-F") == 0 && has_val) bad = parse_i32(argv[++i], &d.max_F) != 0;
+        else if (strcmp(k, "--max-G") == 0 && has_val) bad = parse_i32(argv[++i], &d.max_G) != 0;
+        else if (strcmp(k, "--pool") == 0 && has_val) bad = parse_i32(argv[++i], &d.pool_init) != 0;
+        else if (strcmp(k, "--stop") == 0) return client_main(d.sock_path, "stop\n");
+        else if (strcmp(k, "--run") == 0) {
+            // reszta argumentow to opcje przebiegu (jak ./tramwaj)
+            char line[LINE_MAX_LEN];
+            size_t off = (size_t)snprintf(line, sizeof(line), "run");
+            for (int j = i + 1; j < argc && off < sizeof(line); j++)
+                off += (size_t)snprintf(line + off, sizeof(line) - off, " %s", argv[j]);
+            if (off + 2 > sizeof(line)) { fprintf(stderr, "tramwajd: --run line too long\n"); return 2; }
+            line[off++] = '\n';
+            line[off] = '\0';
+            return client_main(d.sock_path, line);
+        }
+        else if (strcmp(k, "--help") == 0) { usage(); return 0; }
+        else bad = 1;
+        if (bad) { fprintf(stderr, "Bad arg: %s\n", k); usage(); return 2; }
+    }
+
+    if (d.max_P < 1 || d.max_P > MAX_P || d.max_K < 1 || d.max_K > MAX_K ||
+        d.max_F < 1 || d.max_F > MAX_F || d.max_G < 1 || d.max_G > MAX_G) {
+        fprintf(stderr, "Invalid args: max-P must be in [1..%d], max-K in [1..%d], max-F in [1..%d], max-G in [1..%d]\n",
+            MAX_P, MAX_K, MAX_F, MAX_G);
+        return 2;
+    }
+    if (d.pool_init < 0 || d.pool_init > d.max_P) d.pool_init = d.max_P;
+    return daemon_main(&d);
+}
@@ -1,20 +1,136 @@
 #include "util.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#if defined(TRAMWAJ_TSC_CLOCK) && defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define USE_TSC 1
+#endif
+
 void die_perror(const char* what) {
     perror(what);                  // wypisuje: opis na stderr
     exit(1);                       // konczy proces kodem 1
 }
 
-int64_t now_ms_monotonic(void) {
+static int64_t mono_ns(void) {
     struct timespec ts;                                                         // struktura na czas
     if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) die_perror("clock_gettime");  // czas monotoniczny: nie cofa sie przy zmianie zegara systemowego
-    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;                    // konwersja na milisekundy
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;                        // glibc: vDSO, bez wejscia do jadra
+}
+
+#ifdef USE_TSC
+// ns = ns0 + (rdtsc - tsc0) * mult >> 32; state: 0 przed inicjalizacja, 1 TSC, -1 powrot do vDSO
+typedef struct {
+    uint64_t tsc0;
+    int64_t ns0;
+    uint64_t mult;
+    int state;
+} tsc_calib_t;
+
+static tsc_calib_t g_tsc;
+
+static const char* const TSC_ENV = "TRAMWAJ_TSC_CALIB";
+
+static int tsc_invariant(void) {
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000007, &a, &b, &c, &d)) return 0;
+    return (int)((d >> 8) & 1);   // Invariant TSC: stala czestotliwosc, zsynchronizowany miedzy rdzeniami
+}
+
+// Para (rdtsc, CLOCK_MONOTONIC) z najwezszego z kilku okien mono-rdtsc-mono: srodek okna
+static void tsc_pair(uint64_t* tsc, int64_t* ns) {
+    int64_t best = INT64_MAX;
+    for (int i = 0; i < 3; i++) {
+        const int64_t a = mono_ns();
+        const uint64_t t = __rdtsc();
+        const int64_t b = mono_ns();
+        if (b - a < best) {
+            best = b - a;
+            *tsc = t;
+            *ns = a + (b - a) / 2;
+        }
+    }
+}
+
+static void tsc_init(void) {
+    g_tsc.state = -1;
+    const char* env = getenv(TSC_ENV);
+    if (env) {   // kalibracja rodzica: ta sama funkcja czasu w calym drzewie procesow
+        if (sscanf(env, "%" SCNu64 ":%" SCNd64 ":%" SCNu64, &g_tsc.tsc0, &g_tsc.ns0, &g_tsc.mult) == 3 && g_tsc.mult > 0) {
+            g_tsc.state = 1;
+        }
+        return;
+    }
+    if (!tsc_invariant()) return;
+
+    // TSC_SAMPLES odcinkow po TSC_SAMPLE_MS wzgledem CLOCK_MONOTONIC (raz na drzewo procesow), mnoznik = mediana.
+    // Rozrzut powyzej TSC_MAX_SPREAD_PPM (np. migracja VM, wywlaszczenie w trakcie odczytu) -> zostaje vDSO
+    enum { TSC_SAMPLES = 5, TSC_SAMPLE_MS = 4, TSC_MAX_SPREAD_PPM = 1000 };
+    uint64_t mult[TSC_SAMPLES];
+    uint64_t t0;
+    int64_t n0;
+    tsc_pair(&t0, &n0);
+    for (int i = 0; i < TSC_SAMPLES; i++) {
+        struct timespec req = { 0, TSC_SAMPLE_MS * 1000000L };
+        while (nanosleep(&req, &req) != 0 && errno == EINTR) {}
+        uint64_t t1;
+        int64_t n1;
+        tsc_pair(&t1, &n1);
+        if (t1 <= t0 || n1 <= n0) return;
+        mult[i] = (uint64_t)((((unsigned __int128)(n1 - n0)) << 32) / (t1 - t0));
+        t0 = t1;
+        n0 = n1;
+    }
+    for (int i = 1; i < TSC_SAMPLES; i++) {   // sortowanie przez wstawianie (5 elementow)
+        const uint64_t v = mult[i];
+        int j = i;
+        for (; j > 0 && mult[j - 1] > v; j--) mult[j] = mult[j - 1];
+        mult[j] = v;
+    }
+    if (mult[0] == 0 || (mult[TSC_SAMPLES - 1] - mult[0]) * 1000000ull / mult[0] > TSC_MAX_SPREAD_PPM) return;
+
+    g_tsc.mult = mult[TSC_SAMPLES / 2];
+    g_tsc.tsc0 = t0;
+    g_tsc.ns0 = n0;
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%" PRIu64 ":%" PRId64 ":%" PRIu64, g_tsc.tsc0, g_tsc.ns0, g_tsc.mult);
+    (void)setenv(TSC_ENV, buf, 1);
+    g_tsc.state = 1;
+}
+#endif
+
+int64_t now_ns_monotonic(void) {
+#ifdef USE_TSC
+    if (g_tsc.state == 0) tsc_init();
+    if (g_tsc.state > 0) {
+        const uint64_t d = __rdtsc() - g_tsc.tsc0;
+        return g_tsc.ns0 + (int64_t)(((unsigned __int128)d * g_tsc.mult) >> 32);
+    }
+#endif
+    return mono_ns();
+}
+
+const char* clock_source_str(void) {
+#ifdef USE_TSC
+    if (g_tsc.state == 0) tsc_init();
+    if (g_tsc.state > 0) return "tsc";
+#endif
+    return "vdso";
+}
+
+int64_t now_ms_monotonic(void) {
+    return now_ns_monotonic() / 1000000;                                        // konwersja na milisekundy
+}
+
+int64_t now_us_monotonic(void) {
+    return now_ns_monotonic() / 1000;
 }
 
 int parse_i32(const char* s, int32_t* out) {
@@ -40,6 +156,35 @@ int parse_double(const char* s, double* out) {
     return 0;                                       // sukces
 }
 
+int parse_i32_list(const char* s, int32_t* out, int max) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", s);
+    int n = 0;
+    char* save = NULL;
+    for (char* tok = strtok_r(buf, ",", &save); tok && n < max; tok = strtok_r(NULL, ",", &save)) {
+        if (parse_i32(tok, &out[n]) != 0) return -1;
+        n++;
+    }
+    return n;
+}
+
+int parse_double_list(const char* s, double* out, int max) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", s);
+    int n = 0;
+    char* save = NULL;
+    for (char* tok = strtok_r(buf, ",", &save); tok && n < max; tok = strtok_r(NULL, ",", &save)) {
+        if (parse_double(tok, &out[n]) != 0) return -1;
+        n++;
+    }
+    return n;
+}
+
+int cmp_i64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
 void sleep_ms(int ms) {
     if (ms <= 0) return;
     struct timespec ts;
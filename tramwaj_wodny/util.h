@@ -11,8 +11,15 @@ extern "C" {
     // Blad syscall -> perror + exit(1)
     void die_perror(const char* what);
 
-    // Timestamp ms (monotoniczny)
+    // Zegar monotoniczny w ns: CLOCK_MONOTONIC przez vDSO albo (-DTRAMWAJ_TSC_CLOCK=ON) kalibrowany TSC.
+    // Kalibracje robi pierwszy proces i dziedzicza ja dzieci (zmienna TRAMWAJ_TSC_CALIB),
+    // wiec czasy z roznych procesow jednego przebiegu sa porownywalne.
+    int64_t now_ns_monotonic(void);
+    const char* clock_source_str(void);   // "vdso" | "tsc"
+
+    // Ta sama skala w ms / us (timeouty, opoznienia)
     int64_t now_ms_monotonic(void);
+    int64_t now_us_monotonic(void);
 
     // Bezpieczne parsowanie liczby calkowitej
     // zwraca 0 ok, -1 blad
@@ -21,6 +28,13 @@ extern "C" {
     // Bezpieczne parsowanie double
     int parse_double(const char* s, double* out);
 
+    // Lista po przecinkach (maks. max elementow, reszta ignorowana); liczba elementow albo -1 blad
+    int parse_i32_list(const char* s, int32_t* out, int max);
+    int parse_double_list(const char* s, double* out, int max);
+
+    // Komparator qsort dla int64_t (rosnaco)
+    int cmp_i64(const void* a, const void* b);
+
     // Sleep ms (nanosleep)
     void sleep_ms(int ms);
 
@@ -0,0 +1,117 @@
+#include "workload.h"
+#include "common.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t prng_next(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+double prng_unit(uint64_t* state) {
+    return (double)(prng_next(state) >> 11) * (1.0 / 9007199254740992.0);   // 53 bity
+}
+
+static int workload_push(workload_t* w, int* cap, const workload_pax_t* p) {
+    if (w->count >= MAX_P) return -1;
+    if (w->count >= *cap) {
+        int nc = *cap > 0 ? *cap * 2 : 256;
+        workload_pax_t* np = (workload_pax_t*)realloc(w->pax, (size_t)nc * sizeof(workload_pax_t));
+        if (!np) return -1;
+        w->pax = np;
+        *cap = nc;
+    }
+    w->pax[w->count++] = *p;
+    return 0;
+}
+
+int workload_load(const char* path, workload_t* w) {
+    memset(w, 0, sizeof(*w));
+    FILE* f = fopen(path, "r");
+    if (!f) { perror("fopen(workload)"); return -1; }
+
+    int cap = 0, lineno = 0, rc = 0;
+    int32_t last_off = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char* s = line;
+        while (*s == ' ' || *s == '\t') s++;
+        if (*s == '#' || *s == '\n' || *s == '\0') continue;
+
+        unsigned long long seed;
+        int off, dir, bike;
+        if (sscanf(s, "seed %llu", &seed) == 1) {
+            w->seed = (uint64_t)seed;
+            w->has_seed = 1;
+        }
+        // offsety musza byc niemalejace: launcher spawnuje po kolei
+        else if (sscanf(s, "p %d %d %d", &off, &dir, &bike) == 3 &&
+            off >= 0 && off >= last_off && (dir == 0 || dir == 1) && (bike == 0 || bike == 1)) {
+            workload_pax_t p;
+            p.offset_ms = off;
+            p.dir = (int8_t)dir;
+            p.bike = (uint8_t)bike;
+            if (workload_push(w, &cap, &p) != 0) {
+                fprintf(stderr, "workload %s:%d: too many passengers (MAX_P=%d)\n", path, lineno, (int)MAX_P);
+                rc = -1;
+                break;
+            }
+            last_off = off;
+        }
+        else {
+            fprintf(stderr, "workload %s:%d: bad line: %s", path, lineno, s);
+            rc = -1;
+            break;
+        }
+    }
+    fclose(f);
+    if (rc == 0 && !w->has_seed && w->count == 0) {
+        fprintf(stderr, "workload %s: neither seed nor passengers\n", path);
+        rc = -1;
+    }
+    if (rc != 0) workload_free(w);
+    return rc;
+}
+
+int workload_generate(workload_t* w, uint64_t seed, int32_t P, double bike_prob) {
+    free(w->pax);
+    w->pax = NULL;
+    w->seed = seed;
+    w->has_seed = 1;
+    w->count = 0;
+    if (P <= 0) return 0;
+    w->pax = (workload_pax_t*)calloc((size_t)P, sizeof(workload_pax_t));
+    if (!w->pax) { perror("calloc(workload)"); return -1; }
+    uint64_t st = seed;
+    for (int32_t i = 0; i < P; i++) {
+        w->pax[i].offset_ms = 0;
+        w->pax[i].dir = (int8_t)(prng_next(&st) & 1);
+        w->pax[i].bike = (uint8_t)(prng_unit(&st) < bike_prob ? 1 : 0);
+    }
+    w->count = P;
+    return 0;
+}
+
+int workload_save(const char* path, const workload_t* w) {
+    FILE* f = fopen(path, "w");
+    if (!f) { perror("fopen(record-workload)"); return -1; }
+    fprintf(f, "# tramwaj workload: p <offset_ms> <dir> <bike>\n");
+    if (w->has_seed) fprintf(f, "# generated from seed %" PRIu64 "\n", w->seed);
+    for (int32_t i = 0; i < w->count; i++) {
+        fprintf(f, "p %d %d %d\n", w->pax[i].offset_ms, (int)w->pax[i].dir, (int)w->pax[i].bike);
+    }
+    if (fclose(f) != 0) { perror("fclose(record-workload)"); return -1; }
+    return 0;
+}
+
+void workload_free(workload_t* w) {
+    free(w->pax);
+    memset(w, 0, sizeof(*w));
+}
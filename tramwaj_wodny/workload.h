@@ -0,0 +1,49 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+// Obciazenie (lista pasazerow) launchera: deterministyczne z ziarna albo jawna lista z pliku.
+// Format pliku (tekst, linie; '#' = komentarz):
+//   seed <u64>                        - generuj P pasazerow z ziarna (P i bike-prob z CLI)
+//   p <offset_ms> <dir 0|1> <bike 0|1> - jawny pasazer: start offset_ms od poczatku spawnowania
+// Jawna lista ma pierwszenstwo przed ziarnem; --record-workload zapisuje jawna liste z przebiegu
+// (faktyczne offsety fork), wiec odtworzenie daje ten sam wejsciowy ruch co nagranie.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    typedef struct {
+        int32_t offset_ms;   // start wzgledem pierwszego pasazera
+        int8_t dir;
+        uint8_t bike;
+    } workload_pax_t;
+
+    typedef struct {
+        uint64_t seed;
+        int32_t has_seed;
+        int32_t count;           // liczba pasazerow (0 = tylko ziarno)
+        workload_pax_t* pax;
+    } workload_t;
+
+    // PRNG splitmix64 (ten sam ciag na kazdej platformie, w przeciwienstwie do rand())
+    uint64_t prng_next(uint64_t* state);
+    double prng_unit(uint64_t* state);   // [0, 1)
+
+    // Wczytanie pliku; 0 ok, -1 blad (komunikat na stderr)
+    int workload_load(const char* path, workload_t* w);
+
+    // Lista P pasazerow z ziarna (offset 0 = spawn bez opoznien); 0 ok, -1 blad
+    int workload_generate(workload_t* w, uint64_t seed, int32_t P, double bike_prob);
+
+    // Zapis jawnej listy (+ ziarno jako komentarz informacyjny); 0 ok, -1 blad
+    int workload_save(const char* path, const workload_t* w);
+
+    void workload_free(workload_t* w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WORKLOAD_H